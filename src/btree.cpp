@@ -6,8 +6,12 @@
  */
 
 #include <bits/algorithmfwd.h>
+#include <algorithm>
+#include <vector>
+#include <cstddef>
 #include <math.h>
 #include "btree.h"
+#include "node_search.h"
 #include "filescan.h"
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
@@ -19,12 +23,1360 @@
 #include "exceptions/end_of_file_exception.h"
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
+#include <exception>
+#include <thread>
+#include <mutex>
 
 
 //#define DEBUG
 using namespace std;
 namespace badgerdb {
 
+// -----------------------------------------------------------------------------
+// Node access
+// -----------------------------------------------------------------------------
+    /*
+     * The tree algorithms of BTreeIndex are templated on the key type and only reach the keys and values
+     * of a node through the functions below. INTEGER and DOUBLE nodes keep the keys in fixed size arrays,
+     * STRING nodes are slotted pages, see btree.h.
+     */
+
+    template<class T>
+    inline int nodeLowerBound(const LeafNode<T> *node, const T &key) {
+        return keyLowerBound(node->keys(), node->header.keyCount, key);
+    }
+
+    /*
+     * Search of a non-leaf, by binary search over the keys of a NONLEAF_SORTED node, else through its line directory.
+     * Once the line holding the bound is known, the line of child page numbers the descent reads next is prefetched
+     * while the keys of the line are compared.
+     */
+    template<bool Upper, class T>
+    inline int nonLeafBound(const NonLeafNode<T> *node, const T &key) {
+        int count = node->header.keyCount;
+        if ((node->header.format & NONLEAF_LINE_DIRECTORY) == 0) {
+            return Upper ? keyUpperBound(node->keys(), count, key) : keyLowerBound(node->keys(), count, key);
+        }
+        const int B = KeyLines<T>::KEYS_PER_LINE;
+        int line = searchLineDirectory<Upper>(node->lineMax(), node->groupMax(), count, key);
+        if (line * B >= count) {
+            return count;
+        }
+        __builtin_prefetch(&node->pageNos()[line * B]);
+        return line * B + countInLine<Upper>(&node->keys()[line * B], min(B, count - line * B), key);
+    }
+
+    template<class T>
+    inline int nodeLowerBound(const NonLeafNode<T> *node, const T &key) {
+        return nonLeafBound<false>(node, key);
+    }
+
+    template<class T>
+    inline int nodeUpperBound(const LeafNode<T> *node, const T &key) {
+        return keyUpperBound(node->keys(), node->header.keyCount, key);
+    }
+
+    template<class T>
+    inline int nodeUpperBound(const NonLeafNode<T> *node, const T &key) {
+        return nonLeafBound<true>(node, key);
+    }
+
+    //Bring the line directory of a non-leaf, if it has one, up to date after its keys from position i on changed
+    template<class T>
+    inline void updateDirectory(NonLeafNode<T> *node, int i) {
+        if ((node->header.format & NONLEAF_LINE_DIRECTORY) != 0) {
+            updateLineDirectory(node->keys(), node->header.keyCount, node->lineMax(), node->groupMax(),
+                                i / KeyLines<T>::KEYS_PER_LINE);
+        }
+    }
+
+    template<class T>
+    inline T keyAt(const LeafNode<T> *node, int i) {
+        return node->keys()[i];
+    }
+
+    template<class T>
+    inline T keyAt(const NonLeafNode<T> *node, int i) {
+        return node->keys()[i];
+    }
+
+    //Negative, zero or positive if key i of the leaf is less than, equal to or greater than key
+    template<class T>
+    inline int compareKeyAt(const LeafNode<T> *node, int i, const T &key) {
+        const T *keys = node->keys();
+        return keys[i] < key ? -1 : (key < keys[i] ? 1 : 0);
+    }
+
+    template<class T>
+    inline RecordId ridAt(const LeafNode<T> *node, int i) {
+        return node->rids()[i];
+    }
+
+    //Included attributes of entry i of a leaf, header.payloadSize bytes
+    template<class T>
+    inline const char *payloadAt(const LeafNode<T> *node, int i) {
+        return node->payloads() + i * node->header.payloadSize;
+    }
+
+    //Copy count rids, and keys and payloads if they are not NULL, of a leaf starting at position i
+    template<class T>
+    inline void copyEntries(const LeafNode<T> *node, int i, int count, RecordId *rids, void *keys, char *payloads) {
+        const LeafRecordId *leafRids = node->rids();
+        for (int j = 0; j < count; j++) {
+            rids[j] = leafRids[i + j];
+        }
+        if (keys != NULL) {
+            memcpy(keys, &node->keys()[i], count * sizeof(T));
+        }
+        if (payloads != NULL && node->header.payloadSize > 0) {
+            memcpy(payloads, payloadAt(node, i), count * node->header.payloadSize);
+        }
+    }
+
+    //Have the CPU load the cache lines of the keys and rids of leaf entries [i, i + count), at most 4 lines of each
+    template<class T>
+    inline void prefetchEntries(const LeafNode<T> *node, int i, int count) {
+        const char *keys = (const char *) &node->keys()[i];
+        const char *rids = (const char *) &node->rids()[i];
+        int keyBytes = min(count * (int) sizeof(T), 4 * CACHE_LINE_SIZE);
+        int ridBytes = min(count * (int) sizeof(LeafRecordId), 4 * CACHE_LINE_SIZE);
+        for (int offset = 0; offset < keyBytes; offset += CACHE_LINE_SIZE) {
+            __builtin_prefetch(keys + offset);
+        }
+        for (int offset = 0; offset < ridBytes; offset += CACHE_LINE_SIZE) {
+            __builtin_prefetch(rids + offset);
+        }
+    }
+
+    template<class T>
+    inline PageId childAt(const NonLeafNode<T> *node, int i) {
+        return node->pageNos()[i];
+    }
+
+    template<class T>
+    inline void setChild(NonLeafNode<T> *node, int i, PageId pageNo) {
+        node->pageNos()[i] = pageNo;
+    }
+
+    //True if the non-leaf keeps the number of entries under each child, the counts are 0 and not stored otherwise
+    template<class N>
+    inline bool hasCounts(const N *node) {
+        return (node->header.format & NONLEAF_COUNTS) != 0;
+    }
+
+    //Number of entries in the subtree of child i
+    template<class T>
+    inline int countAt(const NonLeafNode<T> *node, int i) {
+        return hasCounts(node) ? node->counts()[i] : 0;
+    }
+
+    template<class T>
+    inline void setCount(NonLeafNode<T> *node, int i, int entryCount) {
+        if (hasCounts(node)) {
+            node->counts()[i] = entryCount;
+        }
+    }
+
+    //True if key can be added to the node without splitting it, in a leaf with the given rid
+    template<class T>
+    inline bool hasRoomFor(const LeafNode<T> *node, const T &, const RecordId &) {
+        return node->header.keyCount < node->capacity();
+    }
+
+    template<class T>
+    inline bool hasRoomFor(const NonLeafNode<T> *node, const T &) {
+        return node->header.keyCount < node->layout().size;
+    }
+
+    //True if the node can take one more key, whatever key a split below pushes up
+    template<class T>
+    inline bool hasRoomForAnyKey(const NonLeafNode<T> *node) {
+        return node->header.keyCount < node->layout().size;
+    }
+
+    template<class T>
+    inline void initNode(LeafNode<T> *node, int format, int payloadSize) {
+        node->header.nodeType = LEAF_NODE;
+        node->header.format = format;
+        node->header.payloadSize = payloadSize;
+        node->header.keyCount = 0;
+        node->rightSibPageNo = UINT32_MAX;
+        node->leftSibPageNo = UINT32_MAX;
+    }
+
+    template<class T>
+    inline void initNode(NonLeafNode<T> *node, int format) {
+        node->header.nodeType = NON_LEAF_NODE;
+        node->header.format = format;
+        node->header.payloadSize = 0;
+        node->header.keyCount = 0;
+        node->level = 1;
+    }
+
+    /**
+     * insertAt: Insert the key at position i of a node that has room for it, shifting the keys after it
+     * @param node -> leaf or nonLeaf node
+     * @param i -> position of the new key
+     * @param key -> the key to be inserted
+     * @param value -> rid of the key in a leaf, page number of the child right of the key in a non-leaf
+     * @param payload -> in a leaf, header.payloadSize bytes of included attributes of the entry
+     * @param entryCount -> in a non-leaf, number of entries in the subtree of that child
+     */
+    template<class T>
+    inline void insertAt(LeafNode<T> *node, int i, const T &key, const RecordId &value, const char *payload) {
+        int count = node->header.keyCount;
+        int payloadSize = node->header.payloadSize;
+        T *keys = node->keys();
+        LeafRecordId *rids = node->rids();
+        memmove(&keys[i + 1], &keys[i], (count - i) * sizeof(T));
+        memmove(&rids[i + 1], &rids[i], (count - i) * sizeof(LeafRecordId));
+        keys[i] = key;
+        rids[i] = value;
+        if (payloadSize > 0) {
+            char *payloads = node->payloads();
+            memmove(payloads + (i + 1) * payloadSize, payloads + i * payloadSize, (count - i) * payloadSize);
+            memcpy(payloads + i * payloadSize, payload, payloadSize);
+        }
+        node->header.keyCount++;
+    }
+
+    template<class T>
+    inline void insertAt(NonLeafNode<T> *node, int i, const T &key, const PageId &value, int entryCount) {
+        int count = node->header.keyCount;
+        T *keys = node->keys();
+        PageId *pageNos = node->pageNos();
+        memmove(&keys[i + 1], &keys[i], (count - i) * sizeof(T));
+        memmove(&pageNos[i + 2], &pageNos[i + 1], (count - i) * sizeof(PageId));
+        if (hasCounts(node)) {
+            int *counts = node->counts();
+            memmove(&counts[i + 2], &counts[i + 1], (count - i) * sizeof(int));
+            counts[i + 1] = entryCount;
+        }
+        keys[i] = key;
+        pageNos[i + 1] = value;
+        node->header.keyCount++;
+        updateDirectory(node, i);
+    }
+
+    //Drop the keys from position count on
+    template<class T>
+    inline void truncateNode(LeafNode<T> *node, int count) {
+        node->header.keyCount = count;
+    }
+
+    template<class T>
+    inline void truncateNode(NonLeafNode<T> *node, int count) {
+        node->header.keyCount = count;
+        updateDirectory(node, count);
+    }
+
+    //Remove the key at position i, with its rid in a leaf or with the child right of it in a non-leaf
+    template<class T>
+    inline void removeAt(LeafNode<T> *node, int i) {
+        int count = node->header.keyCount;
+        int payloadSize = node->header.payloadSize;
+        T *keys = node->keys();
+        LeafRecordId *rids = node->rids();
+        memmove(&keys[i], &keys[i + 1], (count - i - 1) * sizeof(T));
+        memmove(&rids[i], &rids[i + 1], (count - i - 1) * sizeof(LeafRecordId));
+        if (payloadSize > 0) {
+            char *payloads = node->payloads();
+            memmove(payloads + i * payloadSize, payloads + (i + 1) * payloadSize, (count - i - 1) * payloadSize);
+        }
+        node->header.keyCount--;
+    }
+
+    template<class T>
+    inline void removeAt(NonLeafNode<T> *node, int i) {
+        int count = node->header.keyCount;
+        T *keys = node->keys();
+        PageId *pageNos = node->pageNos();
+        memmove(&keys[i], &keys[i + 1], (count - i - 1) * sizeof(T));
+        memmove(&pageNos[i + 1], &pageNos[i + 2], (count - i - 1) * sizeof(PageId));
+        if (hasCounts(node)) {
+            int *counts = node->counts();
+            memmove(&counts[i + 1], &counts[i + 2], (count - i - 1) * sizeof(int));
+        }
+        node->header.keyCount--;
+        updateDirectory(node, i);
+    }
+
+    //True if key i of the non-leaf can be replaced by key without splitting the node
+    template<class T>
+    inline bool hasRoomToReplace(const NonLeafNode<T> *, int, const T &) {
+        return true;
+    }
+
+    //Below the minimum fill a node, except the root, borrows from or merges with a sibling
+    template<class T>
+    inline bool isUnderfull(const LeafNode<T> *node) {
+        return node->header.keyCount < node->capacity() / 2;
+    }
+
+    template<class T>
+    inline bool isUnderfull(const NonLeafNode<T> *node) {
+        return node->header.keyCount < node->layout().size / 2;
+    }
+
+    //True if the keys of two sibling nodes fit in one, in a non-leaf together with the separator between them
+    template<class T>
+    inline bool canMerge(const LeafNode<T> *left, const LeafNode<T> *right) {
+        return left->header.keyCount + right->header.keyCount <= left->capacity();
+    }
+
+    template<class T>
+    inline bool canMerge(const NonLeafNode<T> *left, const NonLeafNode<T> *right, const T &) {
+        return left->header.keyCount + right->header.keyCount + 1 <= left->layout().size;
+    }
+
+    //Number of entries in the subtree of a node, 0 for a non-leaf without subtree counts
+    template<class T>
+    inline int nodeEntryCount(const LeafNode<T> *node) {
+        return node->header.keyCount;
+    }
+
+    template<class T>
+    inline int nodeEntryCount(const NonLeafNode<T> *node) {
+        if (!hasCounts(node)) {
+            return 0;
+        }
+        const int *counts = node->counts();
+        int entryCount = 0;
+        for (int i = 0; i <= node->header.keyCount; i++) {
+            entryCount += counts[i];
+        }
+        return entryCount;
+    }
+
+    //Number of keys the bulk load puts in each node at the given fill factor
+    template<class T>
+    inline int bulkLeafEntries(const std::vector<RIDKeyPair<T> > &, double fillFactor, int payloadSize) {
+        const int leafSize = LeafNode<T>::capacityFor(payloadSize);
+        return max(1, min(leafSize, (int) (fillFactor * leafSize)));
+    }
+
+    template<class T>
+    inline int bulkNonLeafChildren(const std::vector<PageKeyPair<T> > &, double fillFactor, int nonLeafFormat) {
+        const int nonLeafSize = NonLeafLayouts<T>::FORMATS[nonLeafFormat].size;
+        return min(nonLeafSize + 1, (int) (fillFactor * (nonLeafSize + 1)));
+    }
+
+    //Number of keys the bulk load puts in each leaf at the given fill factor, spread evenly so no leaf ends up much emptier
+    template<class T>
+    inline void bulkLeafCounts(const std::vector<RIDKeyPair<T> > &entries, double fillFactor, int payloadSize, int,
+                               std::vector<int> &counts) {
+        int perLeaf = bulkLeafEntries(entries, fillFactor, payloadSize);
+        int numEntries = (int) entries.size();
+        int numLeaves = (numEntries + perLeaf - 1) / perLeaf;
+        for (int leaf = 0; leaf < numLeaves; leaf++) {
+            counts.push_back(numEntries / numLeaves + (leaf < numEntries % numLeaves ? 1 : 0));
+        }
+    }
+
+    /*
+     * Posting lists, see PostingLeafNode. Only LEAF_POSTINGS leaves have them, the versions below are for the others.
+     */
+
+    //The posting list at position i if it has overflow pages, NULL otherwise
+    template<class T>
+    inline const PostingList *listAt(const LeafNode<T> *, int) {
+        return NULL;
+    }
+
+    //Number of entries at positions [i, end), with the RecordIds in overflow pages
+    template<class T>
+    inline int entriesIn(const LeafNode<T> *, int i, int end) {
+        return end - i;
+    }
+
+    //First position in [i, end) whose list has overflow pages, end if there is none
+    template<class T>
+    inline int nextListed(const LeafNode<T> *, int, int end) {
+        return end;
+    }
+
+    //Last position in [begin, i] whose list has overflow pages, begin - 1 if there is none
+    template<class T>
+    inline int prevListed(const LeafNode<T> *, int, int begin) {
+        return begin - 1;
+    }
+
+    //Position to split a leaf at near start, which does not split a list
+    template<class T>
+    inline int listBoundary(const LeafNode<T> *, int start) {
+        return start;
+    }
+
+    //True if the last list of left and the first of right have the same key
+    template<class T>
+    inline bool splitsList(const LeafNode<T> *, const LeafNode<T> *) {
+        return false;
+    }
+
+    //LEAF_PACKED INTEGER leaves
+
+    /*
+     * Every INTEGER leaf is reached as a LeafNodeInt. The overloads below take the packed path when the leaf has the
+     * LEAF_PACKED format, the posting path when it has the LEAF_POSTINGS format and call the array version above otherwise.
+     * Packed fields are read and written with unaligned 8 byte loads of the bytes they start in, in the byte order
+     * of the machine, which is little-endian where this builds.
+     */
+
+    inline bool isPacked(const LeafNodeInt *node) {
+        return node->header.format == LEAF_PACKED;
+    }
+
+    inline const PackedLeafNode *packedLeaf(const LeafNodeInt *node) {
+        return (const PackedLeafNode *) node;
+    }
+
+    inline PackedLeafNode *packedLeaf(LeafNodeInt *node) {
+        return (PackedLeafNode *) node;
+    }
+
+    //Bits needed for the values from 0 to range
+    inline int bitWidth(std::uint32_t range) {
+        return range == 0 ? 0 : 32 - __builtin_clz(range);
+    }
+
+    inline std::uint32_t readBits(const std::uint8_t *bits, std::size_t position, int width) {
+        std::uint64_t word;
+        memcpy(&word, bits + position / 8, sizeof(word));
+        return (std::uint32_t) ((word >> (position % 8)) & ((((std::uint64_t) 1) << width) - 1));
+    }
+
+    inline void writeBits(std::uint8_t *bits, std::size_t position, int width, std::uint32_t value) {
+        std::uint64_t word;
+        memcpy(&word, bits + position / 8, sizeof(word));
+        std::uint64_t mask = ((((std::uint64_t) 1) << width) - 1) << (position % 8);
+        word = (word & ~mask) | (((std::uint64_t) value << (position % 8)) & mask);
+        memcpy(bits + position / 8, &word, sizeof(word));
+    }
+
+    //Key of entry i as its difference from keyBase
+    inline std::uint32_t packedKeyDelta(const PackedLeafNode *node, int i) {
+        return readBits(node->bits, (std::size_t) i * node->entryBits(), node->keyBits);
+    }
+
+    inline int packedKey(const PackedLeafNode *node, int i) {
+        return (int) ((std::uint32_t) node->keyBase + packedKeyDelta(node, i));
+    }
+
+    inline RecordId packedRid(const PackedLeafNode *node, int i) {
+        std::size_t position = (std::size_t) i * node->entryBits() + node->keyBits;
+        RecordId rid;
+        rid.page_number = node->pageBase + readBits(node->bits, position, node->pageBits);
+        rid.slot_number = (SlotId) readBits(node->bits, position + node->pageBits, node->slotBits);
+        return rid;
+    }
+
+    inline void setPackedEntry(PackedLeafNode *node, int i, int key, const RecordId &rid) {
+        std::size_t position = (std::size_t) i * node->entryBits();
+        writeBits(node->bits, position, node->keyBits, (std::uint32_t) key - (std::uint32_t) node->keyBase);
+        writeBits(node->bits, position + node->keyBits, node->pageBits, rid.page_number - node->pageBase);
+        writeBits(node->bits, position + node->keyBits + node->pageBits, node->slotBits, rid.slot_number);
+    }
+
+    //Bits of count entries with keys in [lowKey, highKey], page numbers in [lowPage, highPage] and slots up to highSlot
+    inline std::size_t packedBits(int count, int lowKey, int highKey, PageId lowPage, PageId highPage, SlotId highSlot) {
+        int width = bitWidth((std::uint32_t) highKey - (std::uint32_t) lowKey) + bitWidth(highPage - lowPage) + bitWidth(highSlot);
+        return (std::size_t) count * max(1, width);
+    }
+
+    //Store the entries, sorted by key, in the narrowest widths that hold them
+    inline void packEntries(PackedLeafNode *node, const int *keys, const RecordId *rids, int count) {
+        PageId pageBase = count > 0 ? rids[0].page_number : 0;
+        PageId pageMax = pageBase;
+        SlotId slotMax = 0;
+        for (int i = 0; i < count; i++) {
+            pageBase = min(pageBase, rids[i].page_number);
+            pageMax = max(pageMax, rids[i].page_number);
+            slotMax = max(slotMax, rids[i].slot_number);
+        }
+        node->keyBase = count > 0 ? keys[0] : 0;
+        node->pageBase = pageBase;
+        node->pageMax = pageMax;
+        node->slotMax = slotMax;
+        node->keyBits = bitWidth(count > 0 ? (std::uint32_t) keys[count - 1] - (std::uint32_t) keys[0] : 0);
+        node->pageBits = bitWidth(pageMax - pageBase);
+        node->slotBits = bitWidth(slotMax);
+        for (int i = 0; i < count; i++) {
+            setPackedEntry(node, i, keys[i], rids[i]);
+        }
+        node->header.keyCount = count;
+    }
+
+    inline void unpackEntries(const PackedLeafNode *node, std::vector<int> &keys, std::vector<RecordId> &rids) {
+        for (int i = 0; i < node->header.keyCount; i++) {
+            keys.push_back(packedKey(node, i));
+            rids.push_back(packedRid(node, i));
+        }
+    }
+
+    //True if the widths of the leaf hold the entry
+    inline bool fitsWidths(const PackedLeafNode *node, int key, const RecordId &rid) {
+        return key >= node->keyBase && (std::uint64_t) ((std::uint32_t) key - (std::uint32_t) node->keyBase) >> node->keyBits == 0
+               && rid.page_number >= node->pageBase && (std::uint64_t) (rid.page_number - node->pageBase) >> node->pageBits == 0
+               && (std::uint64_t) rid.slot_number >> node->slotBits == 0;
+    }
+
+    //Keys are sorted, so their differences from keyBase are too and the search compares them without decoding the keys
+    template<bool Upper>
+    inline int packedBound(const PackedLeafNode *node, int key) {
+        int count = node->header.keyCount;
+        if (count == 0 || key < node->keyBase) {
+            return 0;
+        }
+        std::uint32_t delta = (std::uint32_t) key - (std::uint32_t) node->keyBase;
+        if ((std::uint64_t) delta >> node->keyBits != 0) {
+            return count;
+        }
+        int low = 0, high = count;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            std::uint32_t midDelta = packedKeyDelta(node, mid);
+            if (Upper ? midDelta <= delta : midDelta < delta) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    //LEAF_POSTINGS INTEGER leaves
+
+    inline bool isPostings(const LeafNodeInt *node) {
+        return node->header.format == LEAF_POSTINGS;
+    }
+
+    inline const PostingLeafNode *postingLeaf(const LeafNodeInt *node) {
+        return (const PostingLeafNode *) node;
+    }
+
+    inline PostingLeafNode *postingLeaf(LeafNodeInt *node) {
+        return (PostingLeafNode *) node;
+    }
+
+    //RecordIds of a posting list are sorted by page number, then by slot number
+    inline bool ridLess(const RecordId &a, const RecordId &b) {
+        return a.page_number != b.page_number ? a.page_number < b.page_number : a.slot_number < b.slot_number;
+    }
+
+    //Number of the count sorted rids that are less than rid, or with Upper not greater than it
+    template<bool Upper>
+    inline int ridBound(const LeafRecordId *rids, int count, const RecordId &rid) {
+        int low = 0;
+        int high = count;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            RecordId midRid = rids[mid];
+            if (Upper ? !ridLess(rid, midRid) : ridLess(midRid, rid)) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    //Position of the first RecordId of list g
+    inline int listStart(const PostingLeafNode *node, int g) {
+        return g == 0 ? 0 : node->list(g - 1).end;
+    }
+
+    //List holding position i
+    inline int listOf(const PostingLeafNode *node, int i) {
+        int low = 0;
+        int high = node->listCount - 1;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (node->list(mid).end <= i) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    //First list with a key not less than key, or with Upper greater than key
+    template<bool Upper>
+    inline int listBound(const PostingLeafNode *node, int key) {
+        int low = 0;
+        int high = node->listCount;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            int midKey = node->list(mid).key;
+            if (Upper ? midKey <= key : midKey < key) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    //List of key, -1 if the leaf has none
+    inline int listOfKey(const PostingLeafNode *node, int key) {
+        int g = listBound<false>(node, key);
+        return g < node->listCount && node->list(g).key == key ? g : -1;
+    }
+
+    //Insert the RecordId after the ones of its list that are not greater than it, into a new list if the leaf has none for key.
+    //moved is the list of an entry from another leaf, its overflow pages come along
+    inline void postingInsert(PostingLeafNode *node, int key, const RecordId &rid, const PostingList *moved) {
+        int count = node->header.keyCount;
+        int lists = node->listCount;
+        int g = listBound<false>(node, key);
+        int position;
+        if (g < lists && node->list(g).key == key) {
+            int start = listStart(node, g);
+            position = start + ridBound<true>(node->rids() + start, node->list(g).end - start, rid);
+        }
+        else {
+            //The lists from g on move one further from the end of the page
+            position = listStart(node, g);
+            if (g < lists) {
+                memmove(&node->list(lists), &node->list(lists - 1), (lists - g) * sizeof(PostingList));
+            }
+            PostingList &list = node->list(g);
+            list.key = key;
+            list.end = position;
+            list.firstPageNo = UINT32_MAX;
+            list.lastPageNo = UINT32_MAX;
+            list.overflowCount = 0;
+            node->listCount++;
+        }
+        LeafRecordId *rids = node->rids();
+        memmove(&rids[position + 1], &rids[position], (count - position) * sizeof(LeafRecordId));
+        rids[position] = rid;
+        for (int h = g; h < node->listCount; h++) {
+            node->list(h).end++;
+        }
+        if (moved != NULL) {
+            PostingList &list = node->list(g);
+            list.firstPageNo = moved->firstPageNo;
+            list.lastPageNo = moved->lastPageNo;
+            list.overflowCount = moved->overflowCount;
+        }
+        node->header.keyCount++;
+    }
+
+    //Remove the RecordIds at positions [first, end) of list g, and the list if none of its RecordIds are left
+    inline void postingRemove(PostingLeafNode *node, int g, int first, int end) {
+        int removed = end - first;
+        LeafRecordId *rids = node->rids();
+        memmove(&rids[first], &rids[end], (node->header.keyCount - end) * sizeof(LeafRecordId));
+        node->header.keyCount -= removed;
+        if (node->list(g).end - listStart(node, g) == removed) {
+            //The lists after g move one closer to the end of the page
+            int lists = node->listCount;
+            if (g < lists - 1) {
+                memmove(&node->list(lists - 2), &node->list(lists - 1), (lists - 1 - g) * sizeof(PostingList));
+            }
+            node->listCount--;
+        }
+        for (int h = g; h < node->listCount; h++) {
+            node->list(h).end -= removed;
+        }
+    }
+
+    //Posting leaves take whole lists while they fit at the fill factor, a list too long for the leaf takes one RecordId of it
+    inline void postingLeafCounts(const std::vector<RIDKeyPair<int> > &entries, double fillFactor, std::vector<int> &counts) {
+        const int fillBytes = (int) (min(1.0, fillFactor) * PostingLeafNode::CAPACITY_BYTES);
+        size_t first = 0;
+        while (first < entries.size()) {
+            size_t next = first;
+            int bytes = 0;
+            while (next < entries.size()) {
+                size_t runEnd = next + 1;
+                while (runEnd < entries.size() && entries[runEnd].key == entries[next].key) {
+                    runEnd++;
+                }
+                int inLeaf = runEnd - next > (size_t) PostingLeafNode::MAX_INLINE ? 1 : (int) (runEnd - next);
+                int runBytes = inLeaf * (int) sizeof(LeafRecordId) + (int) sizeof(PostingList);
+                if (next > first && bytes + runBytes > fillBytes) {
+                    break;
+                }
+                bytes += runBytes;
+                next = runEnd;
+            }
+            counts.push_back((int) (next - first));
+            first = next;
+        }
+    }
+
+    inline const PostingList *listAt(const LeafNodeInt *node, int i) {
+        if (!isPostings(node)) {
+            return NULL;
+        }
+        const PostingLeafNode *postings = postingLeaf(node);
+        const PostingList &list = postings->list(listOf(postings, i));
+        return list.firstPageNo != UINT32_MAX ? &list : NULL;
+    }
+
+    inline int entriesIn(const LeafNodeInt *node, int i, int end) {
+        if (!isPostings(node) || i >= end) {
+            return end - i;
+        }
+        const PostingLeafNode *postings = postingLeaf(node);
+        int count = end - i;
+        for (int g = listOf(postings, i); g < postings->listCount && listStart(postings, g) < end; g++) {
+            count += postings->list(g).overflowCount;
+        }
+        return count;
+    }
+
+    //A list with overflow pages has a single position, where it starts
+    inline int nextListed(const LeafNodeInt *node, int i, int end) {
+        if (!isPostings(node) || i >= end) {
+            return end;
+        }
+        const PostingLeafNode *postings = postingLeaf(node);
+        for (int g = listOf(postings, i); g < postings->listCount && listStart(postings, g) < end; g++) {
+            if (postings->list(g).firstPageNo != UINT32_MAX) {
+                return max(i, listStart(postings, g));
+            }
+        }
+        return end;
+    }
+
+    inline int prevListed(const LeafNodeInt *node, int i, int begin) {
+        if (!isPostings(node) || i < begin) {
+            return begin - 1;
+        }
+        const PostingLeafNode *postings = postingLeaf(node);
+        for (int g = listOf(postings, i); g >= 0 && postings->list(g).end > begin; g--) {
+            if (postings->list(g).firstPageNo != UINT32_MAX) {
+                return listStart(postings, g);
+            }
+        }
+        return begin - 1;
+    }
+
+    //The start of the list holding start or of the next one, whichever is closer and leaves entries on both sides
+    inline int listBoundary(const LeafNodeInt *node, int start) {
+        if (!isPostings(node)) {
+            return start;
+        }
+        const PostingLeafNode *postings = postingLeaf(node);
+        int g = listOf(postings, start);
+        int low = listStart(postings, g);
+        int high = postings->list(g).end;
+        if (low == 0) {
+            return high;
+        }
+        if (high == postings->header.keyCount) {
+            return low;
+        }
+        return start - low <= high - start ? low : high;
+    }
+
+    inline bool splitsList(const LeafNodeInt *left, const LeafNodeInt *right) {
+        if (!isPostings(left) || left->header.keyCount == 0 || right->header.keyCount == 0) {
+            return false;
+        }
+        const PostingLeafNode *leftPostings = postingLeaf(left);
+        return leftPostings->list(leftPostings->listCount - 1).key == postingLeaf(right)->list(0).key;
+    }
+
+    //Dispatch on the leaf format
+
+    inline int nodeLowerBound(const LeafNodeInt *node, const int &key) {
+        if (isPostings(node)) {
+            const PostingLeafNode *postings = postingLeaf(node);
+            return listStart(postings, listBound<false>(postings, key));
+        }
+        return isPacked(node) ? packedBound<false>(packedLeaf(node), key) : nodeLowerBound<int>(node, key);
+    }
+
+    inline int nodeUpperBound(const LeafNodeInt *node, const int &key) {
+        if (isPostings(node)) {
+            const PostingLeafNode *postings = postingLeaf(node);
+            return listStart(postings, listBound<true>(postings, key));
+        }
+        return isPacked(node) ? packedBound<true>(packedLeaf(node), key) : nodeUpperBound<int>(node, key);
+    }
+
+    inline int keyAt(const LeafNodeInt *node, int i) {
+        if (isPostings(node)) {
+            const PostingLeafNode *postings = postingLeaf(node);
+            return postings->list(listOf(postings, i)).key;
+        }
+        return isPacked(node) ? packedKey(packedLeaf(node), i) : keyAt<int>(node, i);
+    }
+
+    inline int compareKeyAt(const LeafNodeInt *node, int i, const int &key) {
+        int nodeKey = keyAt(node, i);
+        return nodeKey < key ? -1 : (key < nodeKey ? 1 : 0);
+    }
+
+    inline RecordId ridAt(const LeafNodeInt *node, int i) {
+        if (isPostings(node)) {
+            return postingLeaf(node)->rids()[i];
+        }
+        return isPacked(node) ? packedRid(packedLeaf(node), i) : ridAt<int>(node, i);
+    }
+
+    //The payload of a posting leaf entry is its list, which insertAt takes to move the overflow pages with the entry
+    inline const char *payloadAt(const LeafNodeInt *node, int i) {
+        return isPostings(node) ? (const char *) &postingLeaf(node)->list(listOf(postingLeaf(node), i)) : payloadAt<int>(node, i);
+    }
+
+    //Keys of a posting leaf are written once for each list, without comparing them
+    inline void copyEntries(const LeafNodeInt *node, int i, int count, RecordId *rids, void *keys, char *payloads) {
+        if (isPostings(node)) {
+            const PostingLeafNode *postings = postingLeaf(node);
+            const LeafRecordId *leafRids = postings->rids();
+            for (int j = 0; j < count; j++) {
+                rids[j] = leafRids[i + j];
+            }
+            if (keys != NULL && count > 0) {
+                for (int g = listOf(postings, i), j = 0; j < count; g++) {
+                    int key = postings->list(g).key;
+                    for (int end = min(postings->list(g).end - i, count); j < end; j++) {
+                        ((int *) keys)[j] = key;
+                    }
+                }
+            }
+            return;
+        }
+        if (!isPacked(node)) {
+            copyEntries<int>(node, i, count, rids, keys, payloads);
+            return;
+        }
+        const PackedLeafNode *packed = packedLeaf(node);
+        for (int j = 0; j < count; j++) {
+            rids[j] = packedRid(packed, i + j);
+        }
+        if (keys != NULL) {
+            for (int j = 0; j < count; j++) {
+                ((int *) keys)[j] = packedKey(packed, i + j);
+            }
+        }
+    }
+
+    inline void prefetchEntries(const LeafNodeInt *node, int i, int count) {
+        if (isPostings(node)) {
+            const char *rids = (const char *) &postingLeaf(node)->rids()[i];
+            int bytes = min(count * (int) sizeof(LeafRecordId), 4 * CACHE_LINE_SIZE);
+            for (int offset = 0; offset < bytes; offset += CACHE_LINE_SIZE) {
+                __builtin_prefetch(rids + offset);
+            }
+            return;
+        }
+        if (!isPacked(node)) {
+            prefetchEntries<int>(node, i, count);
+            return;
+        }
+        const PackedLeafNode *packed = packedLeaf(node);
+        const char *bits = (const char *) packed->bits + (std::size_t) i * packed->entryBits() / 8;
+        int bytes = min((int) ((std::size_t) count * packed->entryBits() / 8) + 1, 4 * CACHE_LINE_SIZE);
+        for (int offset = 0; offset < bytes; offset += CACHE_LINE_SIZE) {
+            __builtin_prefetch(bits + offset);
+        }
+    }
+
+    //A packed leaf has room while all its entries fit into the page with the widths the new one needs,
+    //a posting leaf while the RecordId and a new list, if the key has none, fit in its bytes
+    inline bool hasRoomFor(const LeafNodeInt *node, const int &key, const RecordId &rid) {
+        if (isPostings(node)) {
+            const PostingLeafNode *postings = postingLeaf(node);
+            int bytes = (int) sizeof(LeafRecordId) + (listOfKey(postings, key) < 0 ? (int) sizeof(PostingList) : 0);
+            return postings->usedBytes() + bytes <= PostingLeafNode::CAPACITY_BYTES;
+        }
+        if (!isPacked(node)) {
+            return hasRoomFor<int>(node, key, rid);
+        }
+        const PackedLeafNode *packed = packedLeaf(node);
+        int count = packed->header.keyCount;
+        if (count == 0) {
+            return true;
+        }
+        return packedBits(count + 1, min(packedKey(packed, 0), key), max(packedKey(packed, count - 1), key),
+                          min(packed->pageBase, rid.page_number), max(packed->pageMax, rid.page_number),
+                          max(packed->slotMax, rid.slot_number)) <= (std::size_t) PackedLeafNode::CAPACITY_BITS;
+    }
+
+    inline void initNode(LeafNodeInt *node, int format, int payloadSize) {
+        initNode<int>(node, format, payloadSize);
+        if (format == LEAF_PACKED) {
+            int noKeys[1];
+            RecordId noRids[1];
+            packEntries(packedLeaf(node), noKeys, noRids, 0);
+        }
+        if (format == LEAF_POSTINGS) {
+            postingLeaf(node)->listCount = 0;
+        }
+    }
+
+    //Shifts the entries after i when the new one fits into the widths of the leaf, else packs all of them again.
+    //A posting leaf puts the entry where its key and RecordId sort, i is ignored, and takes the payload as the list it came from
+    inline void insertAt(LeafNodeInt *node, int i, const int &key, const RecordId &value, const char *payload) {
+        if (isPostings(node)) {
+            postingInsert(postingLeaf(node), key, value, (const PostingList *) payload);
+            return;
+        }
+        if (!isPacked(node)) {
+            insertAt<int>(node, i, key, value, payload);
+            return;
+        }
+        PackedLeafNode *packed = packedLeaf(node);
+        int count = packed->header.keyCount;
+        if (count > 0 && fitsWidths(packed, key, value)
+            && (std::size_t) (count + 1) * packed->entryBits() <= (std::size_t) PackedLeafNode::CAPACITY_BITS) {
+            for (int j = count; j > i; j--) {
+                setPackedEntry(packed, j, packedKey(packed, j - 1), packedRid(packed, j - 1));
+            }
+            setPackedEntry(packed, i, key, value);
+            packed->pageMax = max(packed->pageMax, value.page_number);
+            packed->slotMax = max(packed->slotMax, value.slot_number);
+            packed->header.keyCount++;
+            return;
+        }
+        vector<int> keys;
+        vector<RecordId> rids;
+        unpackEntries(packed, keys, rids);
+        keys.insert(keys.begin() + i, key);
+        rids.insert(rids.begin() + i, value);
+        packEntries(packed, keys.data(), rids.data(), count + 1);
+    }
+
+    //The lists of a posting leaf starting from count on are dropped, the one holding count is cut there
+    inline void truncateNode(LeafNodeInt *node, int count) {
+        if (isPostings(node)) {
+            PostingLeafNode *postings = postingLeaf(node);
+            while (postings->listCount > 0 && listStart(postings, postings->listCount - 1) >= count) {
+                postings->listCount--;
+            }
+            if (postings->listCount > 0) {
+                postings->list(postings->listCount - 1).end = count;
+            }
+        }
+        truncateNode<int>(node, count);
+    }
+
+    //Removing entries keeps the widths, the ones left still fit into them
+    inline void removeAt(LeafNodeInt *node, int i) {
+        if (isPostings(node)) {
+            PostingLeafNode *postings = postingLeaf(node);
+            postingRemove(postings, listOf(postings, i), i, i + 1);
+            return;
+        }
+        if (!isPacked(node)) {
+            removeAt<int>(node, i);
+            return;
+        }
+        PackedLeafNode *packed = packedLeaf(node);
+        int count = packed->header.keyCount;
+        for (int j = i; j < count - 1; j++) {
+            setPackedEntry(packed, j, packedKey(packed, j + 1), packedRid(packed, j + 1));
+        }
+        packed->header.keyCount--;
+    }
+
+    inline bool isUnderfull(const LeafNodeInt *node) {
+        if (isPostings(node)) {
+            return postingLeaf(node)->usedBytes() < PostingLeafNode::CAPACITY_BYTES / 2;
+        }
+        if (!isPacked(node)) {
+            return isUnderfull<int>(node);
+        }
+        const PackedLeafNode *packed = packedLeaf(node);
+        return (std::size_t) packed->header.keyCount * packed->entryBits() < (std::size_t) PackedLeafNode::CAPACITY_BITS / 2;
+    }
+
+    //The ranges of the two leaves are taken from the headers, which may be wider than the entries left
+    inline bool canMerge(const LeafNodeInt *left, const LeafNodeInt *right) {
+        if (isPostings(left)) {
+            return postingLeaf(left)->usedBytes() + postingLeaf(right)->usedBytes() <= PostingLeafNode::CAPACITY_BYTES;
+        }
+        if (!isPacked(left)) {
+            return canMerge<int>(left, right);
+        }
+        const PackedLeafNode *leftPacked = packedLeaf(left);
+        const PackedLeafNode *rightPacked = packedLeaf(right);
+        int leftCount = leftPacked->header.keyCount;
+        int rightCount = rightPacked->header.keyCount;
+        if (leftCount == 0 || rightCount == 0) {
+            return true;
+        }
+        return packedBits(leftCount + rightCount, packedKey(leftPacked, 0), packedKey(rightPacked, rightCount - 1),
+                          min(leftPacked->pageBase, rightPacked->pageBase), max(leftPacked->pageMax, rightPacked->pageMax),
+                          max(leftPacked->slotMax, rightPacked->slotMax)) <= (std::size_t) PackedLeafNode::CAPACITY_BITS;
+    }
+
+    inline int nodeEntryCount(const LeafNodeInt *node) {
+        return entriesIn(node, 0, node->header.keyCount);
+    }
+
+    //Packed leaves take entries while they fit at the fill factor, leaves of close keys take more of them
+    inline void bulkLeafCounts(const std::vector<RIDKeyPair<int> > &entries, double fillFactor, int payloadSize, int format,
+                               std::vector<int> &counts) {
+        if (format == LEAF_POSTINGS) {
+            postingLeafCounts(entries, fillFactor, counts);
+            return;
+        }
+        if (format != LEAF_PACKED) {
+            bulkLeafCounts<int>(entries, fillFactor, payloadSize, format, counts);
+            return;
+        }
+        const std::size_t fillBits = (std::size_t) (min(1.0, fillFactor) * PackedLeafNode::CAPACITY_BITS);
+        size_t first = 0;
+        while (first < entries.size()) {
+            PageId lowPage = entries[first].rid.page_number;
+            PageId highPage = lowPage;
+            SlotId highSlot = entries[first].rid.slot_number;
+            size_t next = first + 1;
+            while (next < entries.size()) {
+                const RecordId &rid = entries[next].rid;
+                if (packedBits((int) (next - first + 1), entries[first].key, entries[next].key, min(lowPage, rid.page_number),
+                               max(highPage, rid.page_number), max(highSlot, rid.slot_number)) > fillBits) {
+                    break;
+                }
+                lowPage = min(lowPage, rid.page_number);
+                highPage = max(highPage, rid.page_number);
+                highSlot = max(highSlot, rid.slot_number);
+                next++;
+            }
+            counts.push_back((int) (next - first));
+            first = next;
+        }
+    }
+
+    //STRING nodes
+
+    inline const char *keyBytes(const void *node, int keyOffset) {
+        return (const char *) node + keyOffset;
+    }
+
+    //Same order as std::string::compare
+    inline int compareKeyBytes(const char *bytes, int length, const std::string &key) {
+        int common = min(length, (int) key.size());
+        int cmp = memcmp(bytes, key.data(), common);
+        if (cmp != 0) {
+            return cmp;
+        }
+        return length - (int) key.size();
+    }
+
+    //Binary search over the slots, Upper selects the first key > key instead of the first key >= key
+    template<bool Upper, class N>
+    inline int searchSlots(const N *node, const std::string &key) {
+        int low = 0;
+        int high = node->header.keyCount;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            int cmp = compareKeyBytes(keyBytes(node, node->slot(mid).keyOffset), node->slot(mid).keyLength, key);
+            if (Upper ? cmp <= 0 : cmp < 0) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    inline int nodeLowerBound(const LeafNodeString *node, const std::string &key) {
+        return searchSlots<false>(node, key);
+    }
+
+    inline int nodeLowerBound(const NonLeafNodeString *node, const std::string &key) {
+        return searchSlots<false>(node, key);
+    }
+
+    inline int nodeUpperBound(const LeafNodeString *node, const std::string &key) {
+        return searchSlots<true>(node, key);
+    }
+
+    inline int nodeUpperBound(const NonLeafNodeString *node, const std::string &key) {
+        return searchSlots<true>(node, key);
+    }
+
+    inline std::string keyAt(const LeafNodeString *node, int i) {
+        return std::string(keyBytes(node, node->slot(i).keyOffset), node->slot(i).keyLength);
+    }
+
+    inline std::string keyAt(const NonLeafNodeString *node, int i) {
+        return std::string(keyBytes(node, node->slot(i).keyOffset), node->slot(i).keyLength);
+    }
+
+    inline int compareKeyAt(const LeafNodeString *node, int i, const std::string &key) {
+        return compareKeyBytes(keyBytes(node, node->slot(i).keyOffset), node->slot(i).keyLength, key);
+    }
+
+    inline RecordId ridAt(const LeafNodeString *node, int i) {
+        return node->slot(i).rid;
+    }
+
+    //The payload of an entry follows its slot
+    inline const char *payloadAt(const LeafNodeString *node, int i) {
+        return (const char *) &node->slot(i) + sizeof(LeafStringSlot);
+    }
+
+    //A STRING key is copied into STRINGKEYMAXSIZE bytes, padded with NUL bytes
+    inline void copyEntries(const LeafNodeString *node, int i, int count, RecordId *rids, void *keys, char *payloads) {
+        int payloadSize = node->header.payloadSize;
+        for (int j = 0; j < count; j++) {
+            const LeafStringSlot &slot = node->slot(i + j);
+            rids[j] = slot.rid;
+            if (keys != NULL) {
+                char *key = (char *) keys + j * STRINGKEYMAXSIZE;
+                memcpy(key, keyBytes(node, slot.keyOffset), slot.keyLength);
+                memset(key + slot.keyLength, 0, STRINGKEYMAXSIZE - slot.keyLength);
+            }
+            if (payloads != NULL && payloadSize > 0) {
+                memcpy(payloads + j * payloadSize, payloadAt(node, i + j), payloadSize);
+            }
+        }
+    }
+
+    //The key bytes are spread over the page, only the slots are prefetched
+    inline void prefetchEntries(const LeafNodeString *node, int i, int count) {
+        const char *slots = (const char *) &node->slot(i);
+        int slotBytes = min(count * node->slotSize(), 4 * CACHE_LINE_SIZE);
+        for (int offset = 0; offset < slotBytes; offset += CACHE_LINE_SIZE) {
+            __builtin_prefetch(slots + offset);
+        }
+    }
+
+    inline PageId childAt(const NonLeafNodeString *node, int i) {
+        return i == 0 ? node->leftPageNo : node->slot(i - 1).pageNo;
+    }
+
+    inline void setChild(NonLeafNodeString *node, int i, PageId pageNo) {
+        if (i == 0) {
+            node->leftPageNo = pageNo;
+        }
+        else {
+            node->slot(i - 1).pageNo = pageNo;
+        }
+    }
+
+    inline int countAt(const NonLeafNodeString *node, int i) {
+        if (!hasCounts(node)) {
+            return 0;
+        }
+        return i == 0 ? node->leftCount : node->slot(i - 1).count;
+    }
+
+    inline void setCount(NonLeafNodeString *node, int i, int entryCount) {
+        if (!hasCounts(node)) {
+            return;
+        }
+        if (i == 0) {
+            node->leftCount = entryCount;
+        }
+        else {
+            node->slot(i - 1).count = entryCount;
+        }
+    }
+
+    //Free bytes between the end of the slot array and the first key byte
+    template<class N>
+    inline int freeBytes(const N *node) {
+        int slotsEnd = (int) ((const char *) &node->slot(node->header.keyCount) - (const char *) node);
+        return node->keyBytesStart - slotsEnd;
+    }
+
+    inline bool hasRoomFor(const LeafNodeString *node, const std::string &key, const RecordId &) {
+        return freeBytes(node) >= (int) (node->slotSize() + key.size());
+    }
+
+    inline bool hasRoomFor(const NonLeafNodeString *node, const std::string &key) {
+        return freeBytes(node) >= (int) (node->slotSize() + key.size());
+    }
+
+    inline bool hasRoomForAnyKey(const NonLeafNodeString *node) {
+        return freeBytes(node) >= node->slotSize() + STRINGKEYMAXSIZE;
+    }
+
+    inline void initNode(LeafNodeString *node, int format, int payloadSize) {
+        node->header.nodeType = LEAF_NODE;
+        node->header.format = format;
+        node->header.payloadSize = payloadSize;
+        node->header.keyCount = 0;
+        node->rightSibPageNo = UINT32_MAX;
+        node->leftSibPageNo = UINT32_MAX;
+        node->keyBytesStart = Page::SIZE;
+    }
+
+    inline void initNode(NonLeafNodeString *node, int format) {
+        node->header.nodeType = NON_LEAF_NODE;
+        node->header.format = format;
+        node->header.payloadSize = 0;
+        node->header.keyCount = 0;
+        node->level = 1;
+        node->keyBytesStart = Page::SIZE;
+    }
+
+    //Insert a slot at position i and put the key bytes in front of the others
+    template<class N, class S>
+    inline S &insertSlot(N *node, int i, const std::string &key) {
+        int count = node->header.keyCount;
+        memmove(&node->slot(i + 1), &node->slot(i), (count - i) * node->slotSize());
+        node->keyBytesStart -= key.size();
+        memcpy((char *) node + node->keyBytesStart, key.data(), key.size());
+        S &slot = node->slot(i);
+        slot.keyOffset = node->keyBytesStart;
+        slot.keyLength = key.size();
+        node->header.keyCount++;
+        return slot;
+    }
+
+    inline void insertAt(LeafNodeString *node, int i, const std::string &key, const RecordId &value,
+                         const char *payload) {
+        LeafStringSlot &slot = insertSlot<LeafNodeString, LeafStringSlot>(node, i, key);
+        slot.rid = value;
+        if (node->header.payloadSize > 0) {
+            memcpy((char *) &slot + sizeof(LeafStringSlot), payload, node->header.payloadSize);
+        }
+    }
+
+    inline void insertAt(NonLeafNodeString *node, int i, const std::string &key, const PageId &value, int entryCount) {
+        insertSlot<NonLeafNodeString, NonLeafStringSlot>(node, i, key).pageNo = value;
+        setCount(node, i + 1, entryCount);
+    }
+
+    //Drop the keys from position count on and pack the bytes of the remaining ones again at the end of the page
+    template<class N>
+    inline void truncateSlots(N *node, int count) {
+        char keys[Page::SIZE];
+        int start = Page::SIZE;
+        for (int i = 0; i < count; i++) {
+            int length = node->slot(i).keyLength;
+            start -= length;
+            memcpy(keys + start, keyBytes(node, node->slot(i).keyOffset), length);
+            node->slot(i).keyOffset = start;
+        }
+        memcpy((char *) node + start, keys + start, Page::SIZE - start);
+        node->keyBytesStart = start;
+        node->header.keyCount = count;
+    }
+
+    inline void truncateNode(LeafNodeString *node, int count) {
+        truncateSlots(node, count);
+    }
+
+    inline void truncateNode(NonLeafNodeString *node, int count) {
+        truncateSlots(node, count);
+    }
+
+    //The bytes of the removed key are reclaimed by packing the remaining keys again
+    template<class N>
+    inline void removeSlot(N *node, int i) {
+        int count = node->header.keyCount;
+        memmove(&node->slot(i), &node->slot(i + 1), (count - i - 1) * node->slotSize());
+        truncateSlots(node, count - 1);
+    }
+
+    inline void removeAt(LeafNodeString *node, int i) {
+        removeSlot(node, i);
+    }
+
+    inline void removeAt(NonLeafNodeString *node, int i) {
+        removeSlot(node, i);
+    }
+
+    inline int nodeEntryCount(const LeafNodeString *node) {
+        return node->header.keyCount;
+    }
+
+    inline int nodeEntryCount(const NonLeafNodeString *node) {
+        if (!hasCounts(node)) {
+            return 0;
+        }
+        int entryCount = node->leftCount;
+        for (int i = 0; i < node->header.keyCount; i++) {
+            entryCount += node->slot(i).count;
+        }
+        return entryCount;
+    }
+
+    inline bool hasRoomToReplace(const NonLeafNodeString *node, int i, const std::string &key) {
+        return freeBytes(node) + node->slot(i).keyLength >= (int) key.size();
+    }
+
+    //Bytes taken by the slots and the keys, and the bytes a node can take at most
+    template<class N>
+    inline int usedBytes(const N *node) {
+        return node->header.keyCount * node->slotSize() + (Page::SIZE - node->keyBytesStart);
+    }
+
+    template<class N>
+    inline int capacityBytes(const N *node) {
+        return Page::SIZE - (int) ((const char *) &node->slot(0) - (const char *) node);
+    }
+
+    inline bool isUnderfull(const LeafNodeString *node) {
+        return usedBytes(node) < capacityBytes(node) / 2;
+    }
+
+    inline bool isUnderfull(const NonLeafNodeString *node) {
+        return usedBytes(node) < capacityBytes(node) / 2;
+    }
+
+    inline bool canMerge(const LeafNodeString *left, const LeafNodeString *right) {
+        return usedBytes(left) + usedBytes(right) <= capacityBytes(left);
+    }
+
+    inline bool canMerge(const NonLeafNodeString *left, const NonLeafNodeString *right, const std::string &separator) {
+        return usedBytes(left) + usedBytes(right) + (int) (left->slotSize() + separator.size())
+               <= capacityBytes(left);
+    }
+
+    /*
+     * A STRING node takes as many keys as fit, so the bulk load sizes nodes for the longest key,
+     * then no node can overflow whatever keys end up in it.
+     */
+    inline int bulkLeafEntries(const std::vector<RIDKeyPair<std::string> > &entries, double fillFactor, int payloadSize) {
+        size_t longest = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            longest = max(longest, entries[i].key.size());
+        }
+        int fit = (Page::SIZE - offsetof(LeafNodeString, slotArray)) / (LeafNodeString::slotSizeFor(payloadSize) + longest);
+        return max(1, (int) (fillFactor * fit));
+    }
+
+    inline int bulkNonLeafChildren(const std::vector<PageKeyPair<std::string> > &children, double fillFactor,
+                                   int nonLeafFormat) {
+        size_t longest = 0;
+        for (size_t i = 0; i < children.size(); i++) {
+            longest = max(longest, children[i].key.size());
+        }
+        size_t slotSize = (nonLeafFormat & NONLEAF_COUNTS) != 0 ? sizeof(NonLeafStringSlot) : sizeof(NonLeafStringSlot) - sizeof(int);
+        int fit = (Page::SIZE - offsetof(NonLeafNodeString, slotArray)) / (slotSize + longest);
+        return (int) (fillFactor * (fit + 1));
+    }
+
+
+    /**
+     * includesLength: Total length of the included attributes of an index, its payload size
+     * @throws BadIndexInfoException If there are more than MAXINCLUDEDATTRIBUTES of them, one of them has a negative
+     *                               offset or no bytes, or they take more than MAXPAYLOADSIZE bytes
+     */
+    inline int includesLength(const std::vector<IncludedAttribute> &includes) {
+        if (includes.size() > (size_t) MAXINCLUDEDATTRIBUTES) {
+            throw BadIndexInfoException("Too many included attributes\n");
+        }
+        int length = 0;
+        for (size_t i = 0; i < includes.size(); i++) {
+            if (includes[i].offset < 0 || includes[i].length <= 0) {
+                throw BadIndexInfoException("Included attribute must have an offset >= 0 and a length > 0\n");
+            }
+            length += includes[i].length;
+            if (length > MAXPAYLOADSIZE) {
+                throw BadIndexInfoException("Included attributes take more than MAXPAYLOADSIZE bytes\n");
+            }
+        }
+        return length;
+    }
+
 /**
    * BTreeIndex Constructor.
 	 * Check to see if the corresponding index file exists. If so, open the file.
@@ -35,231 +1387,2068 @@ namespace badgerdb {
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
+   * @param options							Build options, used only if the index file gets created
    * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
    */    BTreeIndex::BTreeIndex(const std::string &relationName,
                                 std::string &outIndexName,
                                 BufMgr *bufMgrIn,
                                 const int attrByteOffset,
-                                const Datatype attrType) {
+                                const Datatype attrType,
+                                const IndexOptions &options) {
         this->bufMgr = bufMgrIn;
+        this->scanCursor = NULL;
+        this->residentPageBudget = options.residentNonLeafPages;
+        this->savedBufferLookups = 0;
+        this->splitPolicy = options.splitPolicy;
+        this->rightmostLeafPageNo = UINT32_MAX;
+        this->rightmostInserts = 0;
+        this->insertBufferCapacity = options.insertBufferSize;
+        this->readAheadLimit = options.readAheadLeaves;
+        this->aheadLeafReads = 0;
         outIndexName = relationName + "." + std::to_string(attrByteOffset);
+        //The build options only matter when the index is created, an existing index opens with any of them
+        if (!File::exists(outIndexName)) {
+            if (options.fillFactor <= 0 || options.fillFactor > 1) {
+                throw BadIndexInfoException("Fill factor must be in (0, 1]\n");
+            }
+            includesLength(options.includes);
+            if (attrType == INTEGER && options.packedLeaves && !options.includes.empty()) {
+                throw BadIndexInfoException("Packed leaves cannot store included attributes\n");
+            }
+            if (attrType == INTEGER && options.postingLists && (options.packedLeaves || !options.includes.empty())) {
+                throw BadIndexInfoException("Posting lists cannot be packed or store included attributes\n");
+            }
+        }
+        try {
+            this->file = new BlobFile(outIndexName, true);
+        } catch (FileExistsException e)
+        {
+            this->openExistingIndex(outIndexName, relationName, attrByteOffset, attrType);
+            return;
+        }
+
+        Page* headerPage;
+        this->bufMgr->allocPage(this->file, this->headerPageNum, headerPage);
+        //Set once the root exists, from then on the root page is pinned
+        this->rootPageNum = UINT32_MAX;
+        try {
+
+            this->attributeType = attrType;
+            this->attrByteOffset = attrByteOffset;
+            this->leafOccupancy = 0;
+            this->nodeOccupancy = 0;
+            this->nonLeafFormat = (attrType != STRING && options.lineDirectory ? NONLEAF_LINE_DIRECTORY : NONLEAF_SORTED)
+                                  | (options.subtreeCounts ? NONLEAF_COUNTS : 0);
+            this->includes = options.includes;
+            this->leafPayloadSize = includesLength(this->includes);
+            this->leafFormat = attrType != INTEGER ? LEAF_ARRAYS
+                               : (options.postingLists ? LEAF_POSTINGS : (options.packedLeaves ? LEAF_PACKED : LEAF_ARRAYS));
+            this->freePageNum = UINT32_MAX;
+
+            AttributeKeyExtractor attributeKeys(attrByteOffset, attrType);
+            const KeyExtractor *keyExtractor = options.keyExtractor != NULL ? options.keyExtractor : &attributeKeys;
+
+            //Bulk load writes the whole tree first, so the root is known before the metapage is written
+            switch (attrType) {
+                case INTEGER:
+                    if (options.bulkLoad) {
+                        bulkLoadBtree<int>(relationName, options.fillFactor, options.buildThreads, keyExtractor);
+                    }
+                    else {
+                        allocateEmptyRoot<int>();
+                    }
+                    break;
+                case DOUBLE:
+                    if (options.bulkLoad) {
+                        bulkLoadBtree<double>(relationName, options.fillFactor, options.buildThreads, keyExtractor);
+                    }
+                    else {
+                        allocateEmptyRoot<double>();
+                    }
+                    break;
+                case STRING:
+                    if (options.bulkLoad) {
+                        bulkLoadBtree<string>(relationName, options.fillFactor, options.buildThreads, keyExtractor);
+                    }
+                    else {
+                        allocateEmptyRoot<string>();
+                    }
+                    break;
+            }
+
+            //populate metadata of index header page
+            IndexMetaInfo metainfo;
+            strcpy(metainfo.relationName, relationName.c_str());
+            metainfo.attrByteOffset = attrByteOffset;
+            metainfo.attrType = attrType;
+            metainfo.rootPageNo = this->rootPageNum;
+            metainfo.freePageNo = this->freePageNum;
+            metainfo.nonLeafFormat = this->nonLeafFormat;
+            metainfo.leafFormat = this->leafFormat;
+            metainfo.includeCount = (int) this->includes.size();
+            for (size_t i = 0; i < this->includes.size(); i++) {
+                metainfo.includes[i] = this->includes[i];
+            }
+
+            //Write metadata of index header page
+            this->writeMetaInfoToPage(&metainfo, this->headerPageNum, headerPage);
+            this->bufMgr->readPage(this->file, this->headerPageNum, headerPage);
+
+            //Construct Btree for this relation
+            if (!options.bulkLoad) {
+                switch (attrType) {
+                    case INTEGER:
+                        constructBtree<int>(relationName, keyExtractor);
+                        break;
+                    case DOUBLE:
+                        constructBtree<double>(relationName, keyExtractor);
+                        break;
+                    case STRING:
+                        constructBtree<string>(relationName, keyExtractor);
+                        break;
+                }
+            }
+        }
+        catch (...) {
+            this->discardNewIndex(outIndexName);
+            throw;
+        }
+    }
+
+    /**
+     * openExistingIndex: Open the index file that already exists for the relation and attribute.
+     * Leaves the header and root pages pinned like a newly constructed index.
+     * @throws BadIndexInfoException If the metapage does not match the parameters or the root is no non-leaf node,
+     *                               the file is closed again and no page stays pinned
+     */
+    void BTreeIndex::openExistingIndex(const std::string &indexName, const std::string &relationName,
+                                       int attrByteOffset, Datatype attrType) {
+        this->file = new BlobFile(indexName, false);
+        this->headerPageNum = 1;//Assumed that header pageId = 1, which is always the pageId for the 1st page of a new file
+        Page* headerPage;
+        this->bufMgr->readPage(this->file, 1, headerPage);
+        IndexMetaInfo* metaInfo = (IndexMetaInfo*) headerPage;
+
+        this->rootPageNum = metaInfo->rootPageNo;
+        this->freePageNum = metaInfo->freePageNo;
+        this->attributeType = metaInfo->attrType;
+        this->attrByteOffset = metaInfo->attrByteOffset;
+        this->nonLeafFormat = metaInfo->nonLeafFormat;
+        this->leafFormat = metaInfo->leafFormat;
+        string metaInfoRelationName = string(metaInfo->relationName);
+        if (metaInfoRelationName.compare(relationName)!=0 || this->attrByteOffset!= attrByteOffset || this->attributeType!= attrType
+            || metaInfo->includeCount < 0 || metaInfo->includeCount > MAXINCLUDEDATTRIBUTES) {
+            this->bufMgr->unPinPage(this->file, this->headerPageNum, false);
+            delete this->file;
+            throw BadIndexInfoException("Bad Index Info given\n");//Mentioned in btree.h file
+        }
+        this->includes.assign(metaInfo->includes, metaInfo->includes + metaInfo->includeCount);
+        this->leafPayloadSize = includesLength(this->includes);
+        Page* rootPage;
+        this->bufMgr->readPage(this->file, this->rootPageNum, rootPage);
+        NodeHeader *rootHeader = (NodeHeader *) rootPage;
+        if (rootHeader->nodeType != NON_LEAF_NODE || rootHeader->format != this->nonLeafFormat) {
+            //Written in an older node format, without the node header or the format in it
+            this->bufMgr->unPinPage(this->file, this->rootPageNum, false);
+            this->bufMgr->unPinPage(this->file, this->headerPageNum, false);
+            delete this->file;
+            throw BadIndexInfoException("Index root page is not a non-leaf node\n");
+        }
+    }
+
+    /**
+     * discardNewIndex: Called when constructing a new index fails. Unpins the header page, drops the pages of the
+     * file from the buffer pool and removes the half built file, so a later open does not take it for a complete index.
+     * If a node page is still pinned, because the build failed in the middle of an insert, its frame still refers
+     * to the file, so the file object is kept and only the header page is released.
+     * @param indexName -> name of the index file
+     */
+    void BTreeIndex::discardNewIndex(const std::string &indexName) {
+        try {
+            this->bufMgr->unPinPage(this->file, this->headerPageNum, false);
+        }
+        catch (...) {
+        }
+        try {
+            this->releaseResidentPages();
+            if (this->rootPageNum != UINT32_MAX) {
+                this->bufMgr->unPinPage(this->file, this->rootPageNum, false);
+            }
+        }
+        catch (...) {
+        }
         try {
-            this->file = new BlobFile(outIndexName, true);
+            this->bufMgr->flushFile(this->file);
+        }
+        catch (...) {
+            return;
+        }
+        delete this->file;
+        this->file = NULL;
+        try {
+            File::remove(indexName);
+        }
+        catch (...) {
+        }
+    }
+
+
+    //Scan bounds of the key type of the index
+    template<>
+    int &BTreeScanCursor::scanLowVal<int>() {
+        return this->lowValInt;
+    }
+
+    template<>
+    int &BTreeScanCursor::scanHighVal<int>() {
+        return this->highValInt;
+    }
+
+    template<>
+    double &BTreeScanCursor::scanLowVal<double>() {
+        return this->lowValDouble;
+    }
+
+    template<>
+    double &BTreeScanCursor::scanHighVal<double>() {
+        return this->highValDouble;
+    }
+
+    template<>
+    string &BTreeScanCursor::scanLowVal<string>() {
+        return this->lowValString;
+    }
+
+    template<>
+    string &BTreeScanCursor::scanHighVal<string>() {
+        return this->highValString;
+    }
+
+    //Key of type T passed by pointer to the public methods
+    template<class T>
+    inline T keyFromPointer(const void *key) {
+        return *(const T *) key;
+    }
+
+    //A STRING key is a char string, it ends at its first NUL byte or after STRINGKEYMAXSIZE bytes
+    template<>
+    inline string keyFromPointer<string>(const void *key) {
+        const char *chars = (const char *) key;
+        return string(chars, strnlen(chars, STRINGKEYMAXSIZE));
+    }
+
+    //Write a key in the format of the keys passed to the public methods, so keyFromPointer reads it back
+    template<class T>
+    inline void keyToPointer(const T &key, void *out) {
+        memcpy(out, &key, sizeof(T));
+    }
+
+    template<>
+    inline void keyToPointer<string>(const string &key, void *out) {
+        memcpy(out, key.data(), key.size());
+        memset((char *) out + key.size(), 0, STRINGKEYMAXSIZE - key.size());
+    }
+
+    //Key of type T inside a record. The record bytes have no alignment guarantee, so the key is copied out
+    template<class T>
+    inline T keyFromRecord(const char *key) {
+        T keyValue;
+        memcpy(&keyValue, key, sizeof(T));
+        return keyValue;
+    }
+
+    //The STRING key of a record is read the same way as the one passed to the public methods
+    template<>
+    inline string keyFromRecord<string>(const char *key) {
+        return keyFromPointer<string>(key);
+    }
+
+    AttributeKeyExtractor::AttributeKeyExtractor(int attrByteOffset, Datatype attrType)
+            : attrByteOffset(attrByteOffset), attrType(attrType) {}
+
+    void AttributeKeyExtractor::extractKey(const char *record, std::size_t length, void *key) const {
+        std::size_t offset = this->attrByteOffset;
+        if (this->attrType == STRING) {
+            //A string attribute may be shorter than a key, pad it like the keys passed to the public methods
+            std::size_t size = offset < length ? min(length - offset, (std::size_t) STRINGKEYMAXSIZE) : 0;
+            memcpy(key, record + offset, size);
+            memset((char *) key + size, 0, STRINGKEYMAXSIZE - size);
+            return;
+        }
+        std::size_t size = this->attrType == DOUBLE ? sizeof(double) : sizeof(int);
+        if (offset + size > length) {
+            throw BadIndexInfoException("Key attribute ends past the end of a record\n");
+        }
+        memcpy(key, record + offset, size);
+    }
+
+    /**
+     * payloadSize: Bytes of included attributes stored with each entry
+     */
+    int BTreeIndex::payloadSize() const {
+        return this->leafPayloadSize;
+    }
+
+    /**
+     * extractPayload: Copies the included attributes of a record one after the other into payload
+     * @param record -> bytes of the record
+     * @param length -> length of the record
+     * @param payload -> payloadSize bytes
+     */
+    void BTreeIndex::extractPayload(const char *record, std::size_t length, void *payload) const {
+        char *out = (char *) payload;
+        for (size_t i = 0; i < this->includes.size(); i++) {
+            std::size_t offset = this->includes[i].offset;
+            std::size_t size = this->includes[i].length;
+            if (offset + size > length) {
+                throw BadIndexInfoException("Included attribute ends past the end of a record\n");
+            }
+            memcpy(out, record + offset, size);
+            out += size;
+        }
+    }
+
+    /**
+     * Payloads of records by record id, for the entries of a batch or a bulk load, which are sorted by key
+     * and no longer in the order their payloads were collected in. The payloads of the records of a page
+     * are kept one after the other by slot number.
+     */
+    class RecordPayloads {
+    public:
+        explicit RecordPayloads(int payloadSize) : payloadSize(payloadSize) {}
+
+        void add(const RecordId &rid, const char *payload) {
+            vector<char> &page = this->pages[rid.page_number];
+            size_t offset = (size_t) rid.slot_number * this->payloadSize;
+            if (page.size() < offset + this->payloadSize) {
+                page.resize(offset + this->payloadSize);
+            }
+            memcpy(&page[offset], payload, this->payloadSize);
+        }
+
+        //Payload of a record that was added, NULL if the index has no included attributes
+        const char *find(const RecordId &rid) const {
+            if (this->payloadSize == 0) {
+                return NULL;
+            }
+            unordered_map<PageId, vector<char> >::const_iterator page = this->pages.find(rid.page_number);
+            return &page->second[(size_t) rid.slot_number * this->payloadSize];
+        }
+
+        //Takes over the payloads of other, whose records are all on other pages
+        void merge(RecordPayloads &other) {
+            for (unordered_map<PageId, vector<char> >::iterator it = other.pages.begin(); it != other.pages.end(); ++it) {
+                this->pages[it->first].swap(it->second);
+            }
+            other.pages.clear();
+        }
+
+    private:
+        int payloadSize;
+        unordered_map<PageId, vector<char> > pages;
+    };
+
+    /**
+     * recordKey: Key of the record with the given id, read from the record bytes on the page, without copying the record
+     * @param keyExtractor -> reads the key from the record bytes
+     */
+    template<class T>
+    T recordKey(const KeyExtractor *keyExtractor, const Page &page, const RecordId &rid) {
+        std::size_t length;
+        const char *record = page.getRecordBytes(rid, length);
+        char key[STRINGKEYMAXSIZE];
+        keyExtractor->extractKey(record, length, key);
+        return keyFromRecord<T>(key);
+    }
+
+    //allocates a new page in the file, and sets the default values, depending on the type of node
+    //Only the header is written, the key and value slots are unused until keyCount covers them
+    template<class T>
+    void BTreeIndex::AllocatePageAndSetDefaultValues(PageId& pageNo, Page *&currPage, bool isLeaf){
+        this->allocNodePage(pageNo, currPage);
+
+        if(isLeaf){
+            initNode((LeafNode<T>*)currPage, this->leafFormat, this->leafPayloadSize);
+        }
+        else {
+            initNode((NonLeafNode<T>*)currPage, this->nonLeafFormat);
+        }
+    }
+
+    /**
+     * allocateEmptyRoot: Allocates the root of an empty index. The root always is a non-leaf node,
+     * so it starts with no keys and an empty leaf as its only child.
+     */
+    template<class T>
+    void BTreeIndex::allocateEmptyRoot() {
+        PageId leafPageNo;
+        Page *leafPage, *rootPage;
+        AllocatePageAndSetDefaultValues<T>(leafPageNo, leafPage, true);
+        this->bufMgr->unPinPage(this->file, leafPageNo, true);
+
+        AllocatePageAndSetDefaultValues<T>(this->rootPageNum, rootPage, false);
+        NonLeafNode<T> *rootNode = (NonLeafNode<T> *) rootPage;
+        setChild(rootNode, 0, leafPageNo);
+        setCount(rootNode, 0, 0);
+    }
+
+    /**
+     * allocNodePage: Allocates a page for a new node. Pages freed by deleteEntry are reused first,
+     * the file only grows when the free page list is empty.
+     * @param pageNo -> page number of the allocated page
+     * @param page -> the allocated page, pinned
+     */
+    void BTreeIndex::allocNodePage(PageId &pageNo, Page *&page) {
+        if (this->freePageNum == UINT32_MAX) {
+            this->bufMgr->allocPage(this->file, pageNo, page);
+            return;
+        }
+        pageNo = this->freePageNum;
+        this->bufMgr->readPage(this->file, pageNo, page);
+        this->freePageNum = ((FreePage *) page)->nextFreePageNo;
+        this->updateMetaInfo();
+    }
+
+    /**
+     * freeNodePage: Puts the page of a node that was merged away at the head of the free page list.
+     * A BlobFile cannot delete pages, so they are kept for later allocations instead.
+     * @param pageNo -> page number of the node
+     * @param page -> the page, pinned, it is unpinned here
+     */
+    void BTreeIndex::freeNodePage(PageId pageNo, Page *page) {
+        FreePage *freePage = (FreePage *) page;
+        freePage->header.nodeType = FREE_NODE;
+        freePage->header.keyCount = 0;
+        freePage->nextFreePageNo = this->freePageNum;
+        this->bufMgr->unPinPage(this->file, pageNo, true);
+        //A free page is no node to keep resident
+        std::unordered_map<PageId, Page *>::iterator resident = this->residentPages.find(pageNo);
+        if (resident != this->residentPages.end()) {
+            this->residentPages.erase(resident);
+            this->bufMgr->unPinPage(this->file, pageNo, true);
+        }
+        this->freePageNum = pageNo;
+        this->updateMetaInfo();
+    }
+
+    /**
+     * updateMetaInfo: Writes the current root page and the head of the free page list to the metapage
+     */
+    void BTreeIndex::updateMetaInfo() {
+        Page *headerPage;
+        this->bufMgr->readPage(this->file, this->headerPageNum, headerPage);
+        IndexMetaInfo *metaInfo = (IndexMetaInfo*) (headerPage);
+        metaInfo->rootPageNo = this->rootPageNum;
+        metaInfo->freePageNo = this->freePageNum;
+        this->writeMetaInfoToPage(metaInfo, this->headerPageNum, headerPage);
+    }
+
+    /**
+     * readNonLeaf: Reads a non-leaf node on the way down the tree. A resident node is returned without
+     * going through the buffer manager. Any other node is pinned, and becomes resident if the budget
+     * of IndexOptions::residentNonLeafPages is not used up, then that pin is kept until the index is closed.
+     * @param pageNo -> page number of the node
+     * @param page -> the node, released with releaseNonLeaf
+     */
+    void BTreeIndex::readNonLeaf(PageId pageNo, Page *&page) {
+        std::unordered_map<PageId, Page *>::iterator resident = this->residentPages.find(pageNo);
+        if (resident != this->residentPages.end()) {
+            page = resident->second;
+            this->savedBufferLookups++;
+            return;
+        }
+        this->bufMgr->readPage(this->file, pageNo, page);
+        if ((int) this->residentPages.size() < this->residentPageBudget) {
+            //releaseNonLeaf leaves the pin to the resident set
+            this->residentPages[pageNo] = page;
+        }
+    }
+
+    /**
+     * releaseNonLeaf: Unpins a node read by readNonLeaf. A resident node stays pinned, its changes
+     * are written when the index is closed.
+     * @param pageNo -> page number of the node
+     * @param dirty -> true if the node was changed
+     */
+    void BTreeIndex::releaseNonLeaf(PageId pageNo, bool dirty) {
+        if (this->residentPages.count(pageNo) == 0) {
+            this->bufMgr->unPinPage(this->file, pageNo, dirty);
+        }
+    }
+
+    /**
+     * releaseResidentPages: Unpins every resident node
+     */
+    void BTreeIndex::releaseResidentPages() {
+        for (std::unordered_map<PageId, Page *>::iterator it = this->residentPages.begin();
+             it != this->residentPages.end(); ++it) {
+            this->bufMgr->unPinPage(this->file, it->first, true);
+        }
+        this->residentPages.clear();
+    }
+
+    /**
+     * bufferLookupsSaved: Number of times a descent found a node resident instead of reading it
+     * through the buffer manager
+     */
+    long long BTreeIndex::bufferLookupsSaved() const {
+        return this->savedBufferLookups;
+    }
+
+    /**
+     * rightmostLeafInserts: Number of inserts that skipped the descent through the right-most leaf cache
+     */
+    long long BTreeIndex::rightmostLeafInserts() const {
+        return this->rightmostInserts;
+    }
+
+    /**
+     * leavesReadAhead: Number of leaves range scans read ahead
+     */
+    long long BTreeIndex::leavesReadAhead() const {
+        return this->aheadLeafReads;
+    }
+
+    /**
+     * BTreeIndex Destructor.
+       * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+       * and delete file instance thereby closing the index file.
+       * Destructor should not throw any exceptions. All exceptions should be caught in here itself.
+     **/
+
+    BTreeIndex::~BTreeIndex() {
+        //Each step is tried on its own, so a failing one does not keep the others from releasing their pages
+        try {
+            if (this->scanCursor != NULL) {
+                this->endScan();
+            }
+        }
+        catch (...) {
+        }
+        try {
+            this->flushInserts();
+        }
+        catch (...) {
+            //The collected entries that did not get into the tree are lost, see IndexOptions::insertBufferSize
+        }
+        try {
+            this->releaseResidentPages();
+        }
+        catch (...) {
+        }
+        //Unpin the HeaderPage and the rootpage
+        try {
+            this->bufMgr->unPinPage(this->file, this->headerPageNum, true);
+        }
+        catch (...) {
+        }
+        try {
+            this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+        }
+        catch (...) {
+        }
+        //Flush the remaining files of the index file in the buffer Manager
+        try {
+            this->bufMgr->flushFile(this->file);
+        }
+        catch (...) {
+            //A page of the file is still pinned, its frame refers to the file object, so it is not deleted
+            return;
+        }
+
+        delete this->file;
+    }
+
+    template<class T>
+    void BTreeIndex::print(const PageId pageId, int isLeaf, int level) {
+        Page *page;
+        this->bufMgr->readPage(this->file, pageId, page);
+        if (isLeaf) {
+            //Not printing leafNodes currently -- Do nothing
+            //LeafNodeInt* leafNode = (LeafNodeInt*) page;
+        }
+        else {
+            NonLeafNode<T> *nonLeafNodeData = (NonLeafNode<T> *) page;
+            cout<< "Level : "<< level <<" <";
+            for (int i=0;i<nonLeafNodeData->header.keyCount;i++) {
+                cout<<keyAt(nonLeafNodeData, i) << " ";
+            }
+            cout<< "> \n";
+            // recursive for children
+            PageId childPageId;
+            int childLevel = nonLeafNodeData->level;
+            for (int i=0;i<=nonLeafNodeData->header.keyCount;i++) {
+                childPageId = childAt(nonLeafNodeData, i);
+                print<T>(childPageId, childLevel, level+1);
+            }
+        }
+        this->bufMgr->unPinPage(this->file, pageId, false);
+    }
+
+    void BTreeIndex::printBtree() {
+        this->flushInserts();
+        switch (this->attributeType) {
+            case INTEGER:
+                this->print<int>(this->rootPageNum, 0, 0);
+                break;
+            case DOUBLE:
+                this->print<double>(this->rootPageNum, 0, 0);
+                break;
+            case STRING:
+                this->print<string>(this->rootPageNum, 0, 0);
+                break;
+        }
+    }
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntry
+// -----------------------------------------------------------------------------
+    /**
+     * InsertEntry: Insert new key into the Btree
+     * @param key -> New key to be inserted into the Btree index
+     * @param rid -> recordId of the new key to be inserted into the btree index
+     * @param payload -> included attributes of the record
+     */
+    const void BTreeIndex::insertEntry(const void *key, const RecordId rid, const void *payload) {
+        if (this->leafPayloadSize > 0 && payload == NULL) {
+            throw BadIndexInfoException("Index has included attributes, insert needs their payload\n");
+        }
+        //Only read with included attributes, the leaves take a payload for other uses without them
+        const char *payloadBytes = this->leafPayloadSize > 0 ? (const char *) payload : NULL;
+        if (this->insertBufferCapacity > 0) {
+            //Collect the entry, in the key format of insertBatch
+            size_t keySize = this->attributeType == INTEGER ? sizeof(int)
+                             : (this->attributeType == DOUBLE ? sizeof(double) : STRINGKEYMAXSIZE);
+            size_t offset = this->pendingKeys.size();
+            this->pendingKeys.resize(offset + keySize, 0);
+            if (this->attributeType == STRING) {
+                string keyString = keyFromPointer<string>(key);
+                memcpy(&this->pendingKeys[offset], keyString.data(), keyString.size());
+            }
+            else {
+                memcpy(&this->pendingKeys[offset], key, keySize);
+            }
+            this->pendingRids.push_back(rid);
+            this->pendingPayloads.insert(this->pendingPayloads.end(), payloadBytes, payloadBytes + this->leafPayloadSize);
+            if ((int) this->pendingRids.size() >= this->insertBufferCapacity) {
+                this->flushInserts();
+            }
+            return;
+        }
+        switch (this->attributeType) {
+            case INTEGER:
+                this->insertEntryTyped<int>(keyFromPointer<int>(key), rid, payloadBytes);
+                break;
+            case DOUBLE:
+                this->insertEntryTyped<double>(keyFromPointer<double>(key), rid, payloadBytes);
+                break;
+            case STRING:
+                this->insertEntryTyped<string>(keyFromPointer<string>(key), rid, payloadBytes);
+                break;
+        }
+    }
+
+    /**
+     * insertEntryTyped: insertEntry for an index with keys of type T.
+     * Goes down from the root to the leaf, remembering the path. A node that can take one more key without
+     * splitting stops any split from below, so the nodes above it are unpinned as soon as it is reached and
+     * only the path from it down stays pinned. After the entry is in the leaf, splits go up that path
+     * as long as the node below was split.
+     */
+    template<class T>
+    void BTreeIndex::insertEntryTyped(const T &key, const RecordId rid, const char *payload) {
+        if (this->rightmostLeafPageNo != UINT32_MAX && this->insertRightmost<T>(key, rid, payload)) {
+            return;
+        }
+
+        //Non-leaf nodes on the path that are still pinned, the child each one was left through,
+        //and whether the node is the last one of its level
+        struct PathNode {
+            PageId pageNo;
+            NonLeafNode<T> *node;
+            int child;
+            bool rightmost;
+        };
+        vector<PathNode> path;
+        vector<PageId> descent;
+        bool rightmost = true;
+
+        PageId pageNo = this->rootPageNum;
+        bool isLeafNode = false;
+        Page *page;
+        while (!isLeafNode) {
+            this->readNonLeaf(pageNo, page);
+            NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+            if (hasRoomForAnyKey(nonLeafNode)) {
+                for (size_t j = 0; j < path.size(); j++) {
+                    this->releaseNonLeaf(path[j].pageNo, true);
+                }
+                path.clear();
+            }
+            // Every non-leaf node, the root included, has keyCount + 1 children
+            int i = this->insertChild(nonLeafNode, key);
+            //The entry goes into child i
+            setCount(nonLeafNode, i, countAt(nonLeafNode, i) + 1);
+            PathNode pathNode = {pageNo, nonLeafNode, i, rightmost};
+            path.push_back(pathNode);
+            descent.push_back(pageNo);
+            rightmost = rightmost && i == nonLeafNode->header.keyCount;
+            pageNo = childAt(nonLeafNode, i);
+            isLeafNode = nonLeafNode->level;
+        }
+
+        this->bufMgr->readPage(this->file, pageNo, page);
+        LeafNode<T> *leafNode = (LeafNode<T> *) page;
+        bool listed = this->insertOverflow(leafNode, key, rid);
+        if (listed || hasRoomFor(leafNode, key, rid)) {
+            if (!listed) {
+                shiftAndInsert(leafNode, key, rid, payload);
+            }
+            this->bufMgr->unPinPage(this->file, pageNo, true);
+            for (size_t j = 0; j < path.size(); j++) {
+                this->releaseNonLeaf(path[j].pageNo, true);
+            }
+            if (rightmost) {
+                this->rightmostLeafPageNo = pageNo;
+                this->rightmostPath.swap(descent);
+            }
+            return;
+        }
+
+        //Split and copy up, no space in leaf. The right-most path may change
+        this->rightmostLeafPageNo = UINT32_MAX;
+        bool append = this->splitPolicy == SPLIT_APPEND;
+        PageId newPageNo;
+        Page *newPage;
+        AllocatePageAndSetDefaultValues<T>(newPageNo, newPage, true);
+        LeafNode<T> *newLeafNode = (LeafNode<T> *) newPage;
+        bool inserted;
+        T newKey = this->splitLeafNodeInTwo(newLeafNode, leafNode, rid, key, payload, append && rightmost, inserted);
+        if (!inserted && (this->nonLeafFormat & NONLEAF_COUNTS) != 0) {
+            //The entry is inserted again below, take it out of the counts of the descent
+            for (size_t j = 0; j < path.size(); j++) {
+                setCount(path[j].node, path[j].child, countAt(path[j].node, path[j].child) - 1);
+            }
+            for (size_t j = 0; j + path.size() < descent.size(); j++) {
+                this->readNonLeaf(descent[j], page);
+                NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+                int i = this->insertChild(nonLeafNode, key);
+                setCount(nonLeafNode, i, countAt(nonLeafNode, i) - 1);
+                this->releaseNonLeaf(descent[j], true);
+            }
+        }
+
+        //The new leaf goes between the current one and its right sibling
+        PageId rightSibPageNo = leafNode->rightSibPageNo;
+        leafNode->rightSibPageNo = newPageNo;
+        newLeafNode->rightSibPageNo = rightSibPageNo;
+        newLeafNode->leftSibPageNo = pageNo;
+        if (rightSibPageNo != UINT32_MAX) {
+            this->setLeftSibling<T>(rightSibPageNo, newPageNo);
+        }
+        int leftEntries = nodeEntryCount(leafNode);
+        int newEntries = nodeEntryCount(newLeafNode);
+        this->bufMgr->unPinPage(this->file, newPageNo, true);
+        this->bufMgr->unPinPage(this->file, pageNo, true);
+
+        //Add the new node to its parent, which may in turn split
+        bool rootSplit = true;
+        while (!path.empty()) {
+            PathNode parent = path.back();
+            path.pop_back();
+            NonLeafNode<T> *parentNode = parent.node;
+            //Entries that moved to the new node are no longer under the child
+            setCount(parentNode, parent.child, countAt(parentNode, parent.child) - newEntries);
+
+            if (hasRoomFor(parentNode, newKey)) {
+                insertAt(parentNode, nodeLowerBound(parentNode, newKey), newKey, newPageNo, newEntries);
+                this->releaseNonLeaf(parent.pageNo, true);
+                for (size_t j = 0; j < path.size(); j++) {
+                    this->releaseNonLeaf(path[j].pageNo, true);
+                }
+                rootSplit = false;
+                break;
+            }
+
+            //If no space in current node split the current node and push up
+            PageId splitPageNo;
+            Page *splitPage;
+            AllocatePageAndSetDefaultValues<T>(splitPageNo, splitPage, false);
+            NonLeafNode<T> *splitNode = (NonLeafNode<T> *) splitPage;
+            newKey = this->splitNonLeafNode(splitNode, parentNode, newKey, newPageNo, newEntries,
+                                            append && parent.rightmost);
+            leftEntries = nodeEntryCount(parentNode);
+            newEntries = nodeEntryCount(splitNode);
+            newPageNo = splitPageNo;
+            this->bufMgr->unPinPage(this->file, splitPageNo, true);
+            this->releaseNonLeaf(parent.pageNo, true);
+        }
+
+        if (rootSplit) {
+            //The root was split, the new root has the two halves as its children.
+            //The old root page stays pinned as long as it is the root, move that pin to the new root
+            this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+
+            PageId newRootPageNo;
+            Page *newRootPage;
+            AllocatePageAndSetDefaultValues<T>(newRootPageNo, newRootPage, false);
+            NonLeafNode<T> *newRootNode = (NonLeafNode<T> *) newRootPage;
+            setChild(newRootNode, 0, this->rootPageNum);
+            setCount(newRootNode, 0, leftEntries);
+            insertAt(newRootNode, 0, newKey, newPageNo, newEntries);
+            newRootNode->level = 0;
+            this->rootPageNum = newRootPageNo;
+
+            this->updateMetaInfo();
+        }
+
+        //The entry did not fit into its half of a packed leaf, the leaf it goes into now holds fewer entries
+        if (!inserted) {
+            this->insertEntryTyped<T>(key, rid, payload);
+        }
+    }
+
+    /**
+     * flushInserts: Inserts the entries collected by insertEntry through insertBatch, which sorts them and writes
+     * each leaf once for the entries that go into it
+     */
+    void BTreeIndex::flushInserts() {
+        if (this->pendingRids.empty()) {
+            return;
+        }
+        this->insertBatch(&this->pendingKeys[0], &this->pendingRids[0], (int) this->pendingRids.size(),
+                          this->pendingPayloads.empty() ? NULL : &this->pendingPayloads[0]);
+        this->pendingKeys.clear();
+        this->pendingRids.clear();
+        this->pendingPayloads.clear();
+    }
 
-            Page* headerPage, *rootPage;
+    /**
+     * pendingInserts: Number of entries collected by insertEntry that are not in the tree yet
+     */
+    int BTreeIndex::pendingInserts() const {
+        return (int) this->pendingRids.size();
+    }
 
-            this->bufMgr->allocPage(this->file, this->headerPageNum, headerPage);
+    /**
+     * insertRightmost: Inserts the entry into the cached right-most leaf if its key is greater than the first key
+     * of that leaf, so a descent would go down the last child of every non-leaf node to the same leaf.
+     * An equal key goes down left of the leaf, as the separator key above the leaf can be equal to the first key.
+     * The entry counts along the cached path are updated without searching the nodes.
+     * @param key -> key of the entry
+     * @param rid -> rid of the entry
+     * @param payload -> included attributes of the entry
+     * @return true if the entry was inserted, false if it does not belong to the leaf or the leaf is full
+     */
+    template<class T>
+    bool BTreeIndex::insertRightmost(const T &key, const RecordId rid, const char *payload) {
+        Page *page;
+        this->bufMgr->readPage(this->file, this->rightmostLeafPageNo, page);
+        LeafNode<T> *leafNode = (LeafNode<T> *) page;
+        if (leafNode->header.keyCount == 0 || compareKeyAt(leafNode, 0, key) >= 0) {
+            this->bufMgr->unPinPage(this->file, this->rightmostLeafPageNo, false);
+            return false;
+        }
+        if (!this->insertOverflow(leafNode, key, rid)) {
+            if (!hasRoomFor(leafNode, key, rid)) {
+                this->bufMgr->unPinPage(this->file, this->rightmostLeafPageNo, false);
+                return false;
+            }
+            shiftAndInsert(leafNode, key, rid, payload);
+        }
+        this->bufMgr->unPinPage(this->file, this->rightmostLeafPageNo, true);
 
-            AllocatePageAndSetDefaultValues(this->rootPageNum, rootPage, false);
+        for (size_t j = 0; j < this->rightmostPath.size(); j++) {
+            this->readNonLeaf(this->rightmostPath[j], page);
+            NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+            int last = nonLeafNode->header.keyCount;
+            setCount(nonLeafNode, last, countAt(nonLeafNode, last) + 1);
+            this->releaseNonLeaf(this->rightmostPath[j], true);
+        }
+        this->rightmostInserts++;
+        return true;
+    }
 
+    /**
+     * insertBatch: Insert n entries at once
+     * @param keys -> array of n keys: int, double, or for a STRING index char[STRINGKEYMAXSIZE] ending at the first NUL byte
+     * @param rids -> array of the n record ids of the keys
+     * @param n -> number of entries
+     * @param payloads -> n payloads of included attributes, looked up by rid once the entries are sorted
+     */
+    const void BTreeIndex::insertBatch(const void *keys, const RecordId *rids, int n, const void *payloads) {
+        if (this->leafPayloadSize > 0 && payloads == NULL) {
+            throw BadIndexInfoException("Index has included attributes, insert needs their payload\n");
+        }
+        RecordPayloads recordPayloads(this->leafPayloadSize);
+        if (this->leafPayloadSize > 0) {
+            for (int j = 0; j < n; j++) {
+                recordPayloads.add(rids[j], (const char *) payloads + j * this->leafPayloadSize);
+            }
+        }
+        switch (this->attributeType) {
+            case INTEGER: {
+                vector<RIDKeyPair<int> > entries(n);
+                for (int j = 0; j < n; j++) {
+                    entries[j].set(rids[j], ((const int *) keys)[j]);
+                }
+                this->insertBatchTyped<int>(entries, &recordPayloads);
+                break;
+            }
+            case DOUBLE: {
+                vector<RIDKeyPair<double> > entries(n);
+                for (int j = 0; j < n; j++) {
+                    entries[j].set(rids[j], ((const double *) keys)[j]);
+                }
+                this->insertBatchTyped<double>(entries, &recordPayloads);
+                break;
+            }
+            case STRING: {
+                vector<RIDKeyPair<string> > entries(n);
+                for (int j = 0; j < n; j++) {
+                    entries[j].set(rids[j], keyFromPointer<string>((const char *) keys + j * STRINGKEYMAXSIZE));
+                }
+                this->insertBatchTyped<string>(entries, &recordPayloads);
+                break;
+            }
+        }
+    }
 
-            //populate metadata of index header page
-            IndexMetaInfo metainfo;
-            strcpy(metainfo.relationName, relationName.c_str());
-            metainfo.attrByteOffset = attrByteOffset;
-            metainfo.attrType = attrType;
-            metainfo.rootPageNo = this->rootPageNum;
+    /**
+     * insertBatchTyped: insertBatch for an index with keys of type T.
+     * The entries are sorted, then each descent goes to the leaf of the first entry not inserted yet,
+     * and every following entry that belongs to the same leaf is put there while the leaf has room.
+     * The separators on the path bound the keys of the leaf. An entry that finds its leaf full goes
+     * through insertEntryTyped, which splits the leaf, and the next descent goes on from there.
+     */
+    template<class T>
+    void BTreeIndex::insertBatchTyped(vector<RIDKeyPair<T> > &entries, const RecordPayloads *payloads) {
+        sort(entries.begin(), entries.end());
 
-            //Write metadata of index header page
-            this->writeMetaInfoToPage(&metainfo, this->headerPageNum, headerPage);
-            this->bufMgr->readPage(this->file, this->headerPageNum, headerPage);
+        struct PathNode {
+            PageId pageNo;
+            NonLeafNode<T> *node;
+            int child;
+        };
+        size_t next = 0;
+        while (next < entries.size()) {
+            const T &firstKey = entries[next].key;
+            vector<PathNode> path;
+            //The leaf takes the keys up to the separator right of it, the lowest level that has one bounds it most
+            bool bounded = false;
+            T upperKey = T();
 
-            this->attributeType = attrType;
-            this->attrByteOffset = attrByteOffset;
-            this->leafOccupancy = 0;
-            this->nodeOccupancy = 0;
-            //Construct Btree for this relation
-            constructBtree(relationName);
+            PageId pageNo = this->rootPageNum;
+            bool isLeafNode = false;
+            Page *page;
+            while (!isLeafNode) {
+                this->readNonLeaf(pageNo, page);
+                NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+                int i = this->insertChild(nonLeafNode, firstKey);
+                if (i < nonLeafNode->header.keyCount) {
+                    upperKey = keyAt(nonLeafNode, i);
+                    bounded = true;
+                }
+                PathNode pathNode = {pageNo, nonLeafNode, i};
+                path.push_back(pathNode);
+                pageNo = childAt(nonLeafNode, i);
+                isLeafNode = nonLeafNode->level;
+            }
 
-        } catch (FileExistsException e)
-        {
-            this->file = new BlobFile(outIndexName, false);
-            this->headerPageNum = 1;//Assumed that header pageId = 1, which is always the pageId for the 1st page of a new file
-            Page* headerPage;
-            this->bufMgr->readPage(this->file, 1, headerPage);
-            IndexMetaInfo* metaInfo = (IndexMetaInfo*) headerPage;
-
-            this->rootPageNum = metaInfo->rootPageNo;
-            this->attributeType = metaInfo->attrType;
-            this->attrByteOffset = metaInfo->attrByteOffset;
-            string metaInfoRelationName = string(metaInfo->relationName);
-            if (metaInfoRelationName.compare(relationName)!=0 || this->attrByteOffset!= attrByteOffset || this->attributeType!= attrType) {
-                throw BadIndexInfoException("Bad Index Info given\n");//Mentioned in btree.h file
-            }
-            Page* rootPage;
+            this->bufMgr->readPage(this->file, pageNo, page);
+            LeafNode<T> *leafNode = (LeafNode<T> *) page;
+            int added = 0;
+            while (next < entries.size()) {
+                const RIDKeyPair<T> &entry = entries[next];
+                //A key equal to the separator goes down left of it, into a posting leaf right of it
+                if (bounded && (this->leafFormat == LEAF_POSTINGS ? !(entry.key < upperKey) : upperKey < entry.key)) {
+                    break;
+                }
+                if (!this->insertOverflow(leafNode, entry.key, entry.rid)) {
+                    if (!hasRoomFor(leafNode, entry.key, entry.rid)) {
+                        break;
+                    }
+                    shiftAndInsert(leafNode, entry.key, entry.rid, payloads->find(entry.rid));
+                }
+                added++;
+                next++;
+            }
+            this->bufMgr->unPinPage(this->file, pageNo, added > 0);
+            for (size_t j = 0; j < path.size(); j++) {
+                setCount(path[j].node, path[j].child, countAt(path[j].node, path[j].child) + added);
+                this->releaseNonLeaf(path[j].pageNo, added > 0);
+            }
+
+            if (added == 0) {
+                //The leaf is full
+                this->insertEntryTyped<T>(entries[next].key, entries[next].rid, payloads->find(entries[next].rid));
+                next++;
+            }
+        }
+    }
+
+    /**
+     * SerachBtree: Searches the btree once the user calls the startscan with the key
+     * @param pageNo-> rootPage number to start the search from
+     * @param isLeafNode-> true if leaf node else False
+     * @param bound-> low value of an ASCENDING scan, high value of a DESCENDING scan
+     * @param op-> operator of the bound
+     */
+    template<class T>
+    PageId BTreeIndex::searchBtree(PageId pageNo, bool isLeafNode, const T &bound, Operator op) {
+
+        if (!isLeafNode) {
+
+            Page *nonLeafPage;
+            this->readNonLeaf(pageNo, nonLeafPage);
+            NonLeafNode<T>* nonLeafNodeData = (NonLeafNode<T>*) nonLeafPage;
+            int i;
+
+            //Child i holds the keys in [key i-1, key i), so go to the child holding the bound.
+            //Keys equal to a separator may also be left of it, where insertEntry puts them
+            switch (op) {
+                case GT:
+                case LTE:
+                    i = nodeUpperBound(nonLeafNodeData, bound);
+                    break;
+                case GTE:
+                case LT:
+                    i = nodeLowerBound(nonLeafNodeData, bound);
+                    break;
+                default:
+                    assert(0);
+            }
+
+            PageId childPageId = childAt(nonLeafNodeData, i);
+            int childLevel = nonLeafNodeData->level;
+            this->releaseNonLeaf(pageNo, false);
+            return this->searchBtree<T>(childPageId, childLevel, bound, op);
+            //Recursive search on the child Node
+
+        }
+        else {
+            //reached the Leaf Node return the pageId
+            return pageNo;
+        }
+    }
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntry
+// -----------------------------------------------------------------------------
+    /**
+     * deleteEntry: Delete the entry <key, rid> from the Btree
+     * @param key -> Key of the entry to be deleted
+     * @param rid -> recordId of the entry to be deleted
+     */
+    const void BTreeIndex::deleteEntry(const void *key, const RecordId rid) {
+        if (this->scanCursor != NULL) {
+            this->endScan();
+        }
+        this->flushInserts();
+        switch (this->attributeType) {
+            case INTEGER:
+                this->deleteEntryTyped<int>(keyFromPointer<int>(key), rid);
+                break;
+            case DOUBLE:
+                this->deleteEntryTyped<double>(keyFromPointer<double>(key), rid);
+                break;
+            case STRING:
+                this->deleteEntryTyped<string>(keyFromPointer<string>(key), rid);
+                break;
+        }
+    }
+
+    /**
+     * deleteEntryTyped: deleteEntry for an index with keys of type T
+     */
+    template<class T>
+    void BTreeIndex::deleteEntryTyped(const T &key, const RecordId rid) {
+        //Merges can free the right-most leaf or nodes on the path to it
+        this->rightmostLeafPageNo = UINT32_MAX;
+
+        //The root has no minimum fill
+        bool underfull;
+        if (!this->removeEntry<T>(this->rootPageNum, key, rid, 0, underfull)) {
+            throw NoSuchKeyFoundException();
+        }
+
+        //The root page stays pinned. While the root has no keys and a non-leaf child, that child becomes the root,
+        //an empty root above a leaf is kept as the root always is a non-leaf node
+        Page *rootPage;
+        this->bufMgr->readPage(this->file, this->rootPageNum, rootPage);
+        this->bufMgr->unPinPage(this->file, this->rootPageNum, false);
+        NonLeafNode<T> *rootNode = (NonLeafNode<T> *) rootPage;
+        while (rootNode->header.keyCount == 0 && rootNode->level == 0) {
+            PageId oldRootPageNum = this->rootPageNum;
+            Page *oldRootPage = rootPage;
+            this->rootPageNum = childAt(rootNode, 0);
             this->bufMgr->readPage(this->file, this->rootPageNum, rootPage);
+            //Also writes the new root to the metapage
+            this->freeNodePage(oldRootPageNum, oldRootPage);
+            rootNode = (NonLeafNode<T> *) rootPage;
         }
     }
 
+    /**
+     * removeEntry: Removes the entry <key, rid> from the subtree of the given page and rebalances the
+     * child it was removed from, if that child dropped below the minimum fill
+     * @param pageNo -> Page ID of the root of the subtree, which can be leaf or nonLeafNode
+     * @param key -> key of the entry
+     * @param rid -> rid of the entry
+     * @param isLeafNode -> true incase of the leaf node or else false
+     * @param underfull -> set to true if the node of pageNo is below the minimum fill afterwards
+     * @return true if the entry was found and removed
+     */
+    template<class T>
+    bool BTreeIndex::removeEntry(PageId pageNo, const T &key, const RecordId rid, bool isLeafNode, bool &underfull) {
+        Page *page;
+        bool removed = false;
 
-    //allocates a new page in the file, and sets the default values, depending on the type of node
-    void BTreeIndex::AllocatePageAndSetDefaultValues(PageId& pageNo, Page *&currPage, bool isLeaf){
-        this->bufMgr->allocPage(this->file, pageNo, currPage);
+        if (isLeafNode) {
+            this->bufMgr->readPage(this->file, pageNo, page);
+            LeafNode<T> *leafNode = (LeafNode<T> *) page;
+            //A list with overflow pages is searched by rid
+            removed = this->removeOverflow(leafNode, key, rid);
+            //Entries with the same key are ordered by insertion, not by rid, so check each of them
+            for (int i = nodeLowerBound(leafNode, key);
+                 !removed && i < leafNode->header.keyCount && compareKeyAt(leafNode, i, key) == 0; i++) {
+                if (ridAt(leafNode, i) == rid) {
+                    removeAt(leafNode, i);
+                    removed = true;
+                    break;
+                }
+            }
+            underfull = isUnderfull(leafNode);
+            this->bufMgr->unPinPage(this->file, pageNo, removed);
+        }
+        else {
+            this->readNonLeaf(pageNo, page);
+            NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+            //Entries with a key equal to a separator may be on both sides of it
+            int last = nodeUpperBound(nonLeafNode, key);
+            for (int c = nodeLowerBound(nonLeafNode, key); c <= last; c++) {
+                bool childUnderfull;
+                if (this->removeEntry<T>(childAt(nonLeafNode, c), key, rid, nonLeafNode->level, childUnderfull)) {
+                    setCount(nonLeafNode, c, countAt(nonLeafNode, c) - 1);
+                    if (childUnderfull) {
+                        this->rebalanceChild<T>(nonLeafNode, c);
+                    }
+                    removed = true;
+                    break;
+                }
+            }
+            underfull = isUnderfull(nonLeafNode);
+            this->releaseNonLeaf(pageNo, removed);
+        }
+        return removed;
+    }
+
+    //Replace key i of a non-leaf, keeping the child right of it
+    template<class N, class K>
+    inline void replaceKey(N *node, int i, const K &key) {
+        PageId rightPageNo = childAt(node, i + 1);
+        int rightEntries = countAt(node, i + 1);
+        removeAt(node, i);
+        insertAt(node, i, key, rightPageNo, rightEntries);
+    }
+
+    /**
+     * rebalanceChild: Merges child c of the parent with a sibling, or moves keys to it from the sibling.
+     * The left sibling is used if there is one, else the right sibling.
+     * @param parent -> nonLeaf node, pinned
+     * @param c -> index of the child which is below the minimum fill
+     */
+    template<class T>
+    void BTreeIndex::rebalanceChild(NonLeafNode<T> *parent, int c) {
+        if (parent->header.keyCount == 0) {
+            //Only child of the root, there is no sibling
+            return;
+        }
+        int i = c > 0 ? c - 1 : c;
+        PageId leftPageNo = childAt(parent, i);
+        PageId rightPageNo = childAt(parent, i + 1);
+        Page *leftPage, *rightPage;
+        this->bufMgr->readPage(this->file, leftPageNo, leftPage);
+        this->bufMgr->readPage(this->file, rightPageNo, rightPage);
+
+        bool merged;
+        if (parent->level == 1) {
+            merged = this->mergeOrBorrow<T>((LeafNode<T> *) leftPage, (LeafNode<T> *) rightPage, parent, i, c > i);
+        }
+        else {
+            merged = this->mergeOrBorrow<T>((NonLeafNode<T> *) leftPage, (NonLeafNode<T> *) rightPage, parent, i, c > i);
+        }
+
+        //Entries moved between the two, count them again
+        bool leftIsLeaf = parent->level == 1;
+        setCount(parent, i, leftIsLeaf ? nodeEntryCount((LeafNode<T> *) leftPage)
+                                       : nodeEntryCount((NonLeafNode<T> *) leftPage));
+        this->bufMgr->unPinPage(this->file, leftPageNo, true);
+        if (merged) {
+            this->freeNodePage(rightPageNo, rightPage);
+        }
+        else {
+            setCount(parent, i + 1, leftIsLeaf ? nodeEntryCount((LeafNode<T> *) rightPage)
+                                               : nodeEntryCount((NonLeafNode<T> *) rightPage));
+            this->bufMgr->unPinPage(this->file, rightPageNo, true);
+        }
+    }
+
+    /**
+     * mergeOrBorrow: Overloaded function for two sibling leaf nodes. Merges them if their entries fit in one leaf,
+     * else moves entries from the sibling which is not underfull, and the separator in the parent becomes
+     * the lowest key of the right leaf.
+     * @param left -> left leaf, child i of the parent
+     * @param right -> right leaf, child i + 1 of the parent
+     * @param parent -> parent nonLeaf node
+     * @param i -> index of the separator between the two leaves in the parent
+     * @param rightIsUnderfull -> true if right is the underfull leaf, else left is
+     * @return true if right was merged into left
+     */
+    template<class T>
+    bool BTreeIndex::mergeOrBorrow(LeafNode<T> *left, LeafNode<T> *right, NonLeafNode<T> *parent, int i,
+                                   bool rightIsUnderfull) {
+        if (canMerge(left, right)) {
+            for (int j = 0; j < right->header.keyCount; j++) {
+                insertAt(left, left->header.keyCount, keyAt(right, j), ridAt(right, j), payloadAt(right, j));
+            }
+            left->rightSibPageNo = right->rightSibPageNo;
+            if (right->rightSibPageNo != UINT32_MAX) {
+                this->setLeftSibling<T>(right->rightSibPageNo, childAt(parent, i));
+            }
+            removeAt(parent, i);
+            return true;
+        }
+
+        //A posting list is not split between the leaves, once the move of one started it goes on to its end
+        if (rightIsUnderfull) {
+            while ((isUnderfull(right) && !isUnderfull(left)) || splitsList(left, right)) {
+                int last = left->header.keyCount - 1;
+                T movedKey = keyAt(left, last);
+                RecordId movedRid = ridAt(left, last);
+                if (!hasRoomToReplace(parent, i, movedKey) || !hasRoomFor(right, movedKey, movedRid)) {
+                    break;
+                }
+                insertAt(right, 0, movedKey, movedRid, payloadAt(left, last));
+                truncateNode(left, last);
+                replaceKey(parent, i, movedKey);
+            }
+        }
+        else {
+            while ((isUnderfull(left) && !isUnderfull(right)) || splitsList(left, right)) {
+                if (!hasRoomToReplace(parent, i, keyAt(right, 1)) || !hasRoomFor(left, keyAt(right, 0), ridAt(right, 0))) {
+                    break;
+                }
+                insertAt(left, left->header.keyCount, keyAt(right, 0), ridAt(right, 0), payloadAt(right, 0));
+                removeAt(right, 0);
+                replaceKey(parent, i, keyAt(right, 0));
+            }
+        }
+        return false;
+    }
+
+    /**
+     * mergeOrBorrow: Overloaded function for two sibling nonLeaf nodes. The separator between them in the parent
+     * comes down into the merged node, or rotates through the parent when a key and child move to the underfull node.
+     * @param left -> left nonLeaf node, child i of the parent
+     * @param right -> right nonLeaf node, child i + 1 of the parent
+     * @param parent -> parent nonLeaf node
+     * @param i -> index of the separator between the two nodes in the parent
+     * @param rightIsUnderfull -> true if right is the underfull node, else left is
+     * @return true if right was merged into left
+     */
+    template<class T>
+    bool BTreeIndex::mergeOrBorrow(NonLeafNode<T> *left, NonLeafNode<T> *right, NonLeafNode<T> *parent, int i,
+                                   bool rightIsUnderfull) {
+        if (canMerge(left, right, keyAt(parent, i))) {
+            insertAt(left, left->header.keyCount, keyAt(parent, i), childAt(right, 0), countAt(right, 0));
+            for (int j = 0; j < right->header.keyCount; j++) {
+                insertAt(left, left->header.keyCount, keyAt(right, j), childAt(right, j + 1), countAt(right, j + 1));
+            }
+            removeAt(parent, i);
+            return true;
+        }
+
+        if (rightIsUnderfull) {
+            while (isUnderfull(right) && !isUnderfull(left)) {
+                //The last child of left becomes the first child of right
+                int last = left->header.keyCount - 1;
+                T separator = keyAt(parent, i);
+                T movedKey = keyAt(left, last);
+                if (!hasRoomToReplace(parent, i, movedKey) || !hasRoomFor(right, separator)) {
+                    break;
+                }
+                insertAt(right, 0, separator, childAt(right, 0), countAt(right, 0));
+                setChild(right, 0, childAt(left, last + 1));
+                setCount(right, 0, countAt(left, last + 1));
+                truncateNode(left, last);
+                replaceKey(parent, i, movedKey);
+            }
+        }
+        else {
+            while (isUnderfull(left) && !isUnderfull(right)) {
+                //The first child of right becomes the last child of left
+                T separator = keyAt(parent, i);
+                T movedKey = keyAt(right, 0);
+                if (!hasRoomToReplace(parent, i, movedKey) || !hasRoomFor(left, separator)) {
+                    break;
+                }
+                insertAt(left, left->header.keyCount, separator, childAt(right, 0), countAt(right, 0));
+                setChild(right, 0, childAt(right, 1));
+                setCount(right, 0, countAt(right, 1));
+                removeAt(right, 0);
+                replaceKey(parent, i, movedKey);
+            }
+        }
+        return false;
+    }
+
+// -----------------------------------------------------------------------------
+// BTreeIndex posting lists
+// -----------------------------------------------------------------------------
+
+    //An empty overflow page between the pages prevPageNo and nextPageNo of a chain
+    inline void initOverflow(OverflowPage *page, PageId prevPageNo, PageId nextPageNo) {
+        page->header.nodeType = OVERFLOW_NODE;
+        page->header.format = 0;
+        page->header.payloadSize = 0;
+        page->header.keyCount = 0;
+        page->prevPageNo = prevPageNo;
+        page->nextPageNo = nextPageNo;
+    }
+
+    /**
+     * insertOverflow: Leaves without posting lists take every entry themselves
+     */
+    template<class T>
+    bool BTreeIndex::insertOverflow(LeafNode<T> *, const T &, const RecordId &) {
+        return false;
+    }
+
+    /**
+     * insertOverflow: Puts the entry into the overflow pages of its list. A list that is full in the leaf moves there first,
+     * all of it but its smallest RecordId, which stays in the leaf as the position of the list.
+     * @param leaf -> leaf holding the list of key, pinned
+     * @return false if the entry still has to be inserted into the leaf
+     */
+    bool BTreeIndex::insertOverflow(LeafNodeInt *leaf, const int &key, const RecordId &rid) {
+        if (!isPostings(leaf)) {
+            return false;
+        }
+        PostingLeafNode *node = postingLeaf(leaf);
+        int g = listOfKey(node, key);
+        if (g < 0) {
+            return false;
+        }
+        PostingList &list = node->list(g);
+        LeafRecordId *rids = node->rids();
+        int start = listStart(node, g);
+        if (list.firstPageNo != UINT32_MAX) {
+            RecordId inLeaf = rids[start];
+            if (ridLess(rid, inLeaf)) {
+                rids[start] = rid;
+                this->insertOverflowRid(list, inLeaf);
+            }
+            else {
+                this->insertOverflowRid(list, rid);
+            }
+            return true;
+        }
+        int count = list.end - start;
+        if (count < PostingLeafNode::MAX_INLINE) {
+            return false;
+        }
+        vector<RecordId> listRids(rids + start, rids + list.end);
+        listRids.insert(upper_bound(listRids.begin(), listRids.end(), rid, ridLess), rid);
+        this->writeOverflow(list, &listRids[1], count);
+        rids[start] = listRids[0];
+        postingRemove(node, g, start + 1, start + count);
+        return true;
+    }
+
+    template<class T>
+    bool BTreeIndex::removeOverflow(LeafNode<T> *, const T &, const RecordId &) {
+        return false;
+    }
+
+    /**
+     * removeOverflow: Removes the entry from a list with overflow pages. If it is the RecordId kept in the leaf,
+     * the first one of the overflow pages takes its place. The list keeps its pages until they are empty.
+     * @return false if the list of key has no overflow pages or does not hold rid
+     */
+    bool BTreeIndex::removeOverflow(LeafNodeInt *leaf, const int &key, const RecordId &rid) {
+        if (!isPostings(leaf)) {
+            return false;
+        }
+        PostingLeafNode *node = postingLeaf(leaf);
+        int g = listOfKey(node, key);
+        if (g < 0 || node->list(g).firstPageNo == UINT32_MAX) {
+            return false;
+        }
+        PostingList &list = node->list(g);
+        LeafRecordId &inLeaf = node->rids()[listStart(node, g)];
+        if ((RecordId) inLeaf == rid) {
+            PageId pageNo = list.firstPageNo;
+            int entry = 0;
+            RecordId first;
+            this->readOverflow(pageNo, entry, true, &first, 1);
+            this->removeOverflowRid(list, first);
+            inLeaf = first;
+            return true;
+        }
+        return this->removeOverflowRid(list, rid);
+    }
+
+    template<class T>
+    int BTreeIndex::overflowRids(const LeafNode<T> *, int, std::vector<RecordId> *) {
+        return 0;
+    }
+
+    int BTreeIndex::overflowRids(const LeafNodeInt *leaf, int i, std::vector<RecordId> *outRids) {
+        const PostingList *list = listAt(leaf, i);
+        if (list == NULL) {
+            return 0;
+        }
+        size_t first = outRids->size();
+        outRids->resize(first + list->overflowCount);
+        PageId pageNo = list->firstPageNo;
+        int entry = 0;
+        int count = 0;
+        while (pageNo != UINT32_MAX) {
+            count += this->readOverflow(pageNo, entry, true, &(*outRids)[first + count], list->overflowCount - count);
+        }
+        return count;
+    }
+
+    template<class T>
+    void BTreeIndex::entryAt(const LeafNode<T> *leaf, int n, RecordId &rid, void *key) {
+        copyEntries(leaf, n, 1, &rid, key, NULL);
+    }
+
+    /**
+     * entryAt: Entry n of an INTEGER leaf. The RecordIds in the overflow pages of a posting list come after the one
+     * in the leaf, pages before the one holding the entry are skipped by their counts.
+     */
+    void BTreeIndex::entryAt(const LeafNodeInt *leaf, int n, RecordId &rid, void *key) {
+        if (!isPostings(leaf)) {
+            copyEntries(leaf, n, 1, &rid, key, NULL);
+            return;
+        }
+        const PostingLeafNode *node = postingLeaf(leaf);
+        int g = 0;
+        int start = 0;
+        while (n >= node->list(g).end - start + node->list(g).overflowCount) {
+            n -= node->list(g).end - start + node->list(g).overflowCount;
+            start = node->list(g).end;
+            g++;
+        }
+        const PostingList &list = node->list(g);
+        if (key != NULL) {
+            memcpy(key, &list.key, sizeof(int));
+        }
+        if (n < list.end - start) {
+            rid = node->rids()[start + n];
+            return;
+        }
+        n -= list.end - start;
+        PageId pageNo = list.firstPageNo;
+        while (1) {
+            Page *page;
+            this->bufMgr->readPage(this->file, pageNo, page);
+            const OverflowPage *overflow = (const OverflowPage *) page;
+            PageId nextPageNo = overflow->nextPageNo;
+            bool found = n < overflow->header.keyCount;
+            if (found) {
+                rid = overflow->rids[n];
+            }
+            n -= overflow->header.keyCount;
+            this->bufMgr->unPinPage(this->file, pageNo, false);
+            if (found) {
+                return;
+            }
+            pageNo = nextPageNo;
+        }
+    }
+
+    template<class T>
+    void BTreeIndex::fillLeaf(LeafNode<T> *leaf, const std::vector<RIDKeyPair<T> > &entries, int first, int count,
+                              const RecordPayloads &payloads) {
+        for (int i = 0; i < count; i++) {
+            insertAt(leaf, i, entries[first + i].key, entries[first + i].rid, payloads.find(entries[first + i].rid));
+        }
+    }
+
+    /**
+     * fillLeaf: A posting leaf keeps a list of more than PostingLeafNode::MAX_INLINE entries in overflow pages,
+     * written here in one go, and the smallest RecordId of the list in the leaf
+     */
+    void BTreeIndex::fillLeaf(LeafNodeInt *leaf, const std::vector<RIDKeyPair<int> > &entries, int first, int count,
+                              const RecordPayloads &payloads) {
+        if (!isPostings(leaf)) {
+            this->fillLeaf<int>(leaf, entries, first, count, payloads);
+            return;
+        }
+        int end = first + count;
+        while (first < end) {
+            int key = entries[first].key;
+            int runEnd = first + 1;
+            while (runEnd < end && entries[runEnd].key == key) {
+                runEnd++;
+            }
+            if (runEnd - first <= PostingLeafNode::MAX_INLINE) {
+                for (int i = first; i < runEnd; i++) {
+                    insertAt(leaf, i, key, entries[i].rid, NULL);
+                }
+            }
+            else {
+                //The entries are sorted by key and page number, not by slot number
+                vector<RecordId> rids;
+                for (int i = first; i < runEnd; i++) {
+                    rids.push_back(entries[i].rid);
+                }
+                sort(rids.begin(), rids.end(), ridLess);
+                PostingList list;
+                this->writeOverflow(list, &rids[1], (int) rids.size() - 1);
+                insertAt(leaf, first, key, rids[0], (const char *) &list);
+            }
+            first = runEnd;
+        }
+    }
+
+    /**
+     * insertChild: A key equal to a separator may be on both sides of it, inserts go down left of it.
+     * With posting lists all entries of the key are right of it, in one leaf, and inserts go down there.
+     */
+    template<class T>
+    int BTreeIndex::insertChild(const NonLeafNode<T> *node, const T &key) {
+        return this->leafFormat == LEAF_POSTINGS ? nodeUpperBound(node, key) : nodeLowerBound(node, key);
+    }
+
+    /**
+     * writeOverflow: Writes RecordIds of a list into new overflow pages, each one full but the last, and points the list to them
+     * @param list -> list the pages are for, it has no overflow pages yet
+     * @param rids -> the RecordIds, sorted
+     * @param count -> number of RecordIds, at least 1
+     */
+    void BTreeIndex::writeOverflow(PostingList &list, const RecordId *rids, int count) {
+        list.firstPageNo = UINT32_MAX;
+        list.lastPageNo = UINT32_MAX;
+        list.overflowCount = count;
+        OverflowPage *prev = NULL;
+        for (int first = 0; first < count; first += OverflowPage::CAPACITY) {
+            PageId pageNo;
+            Page *page;
+            this->allocNodePage(pageNo, page);
+            OverflowPage *overflow = (OverflowPage *) page;
+            initOverflow(overflow, list.lastPageNo, UINT32_MAX);
+            overflow->header.keyCount = min(count - first, (int) OverflowPage::CAPACITY);
+            for (int j = 0; j < overflow->header.keyCount; j++) {
+                overflow->rids[j] = rids[first + j];
+            }
+            if (prev != NULL) {
+                prev->nextPageNo = pageNo;
+                this->bufMgr->unPinPage(this->file, list.lastPageNo, true);
+            }
+            else {
+                list.firstPageNo = pageNo;
+            }
+            prev = overflow;
+            list.lastPageNo = pageNo;
+        }
+        this->bufMgr->unPinPage(this->file, list.lastPageNo, true);
+    }
 
-        if(isLeaf){
-            LeafNodeInt* leafNode = (LeafNodeInt*)currPage;
-            for (int i = 0; i<INTARRAYLEAFSIZE;i++) {
-                leafNode->keyArray[i] = INT32_MAX;
-                leafNode->ridArray[i].page_number = UINT32_MAX;
-                leafNode->ridArray[i].slot_number = UINT16_MAX;
+    /**
+     * insertOverflowRid: Inserts a RecordId into the overflow pages of a list, into the first page whose last RecordId
+     * is greater than it, or the last page. A full page is split in two first.
+     */
+    void BTreeIndex::insertOverflowRid(PostingList &list, const RecordId &rid) {
+        PageId pageNo = list.firstPageNo;
+        Page *page;
+        OverflowPage *overflow;
+        while (1) {
+            this->bufMgr->readPage(this->file, pageNo, page);
+            overflow = (OverflowPage *) page;
+            if (overflow->nextPageNo == UINT32_MAX || ridLess(rid, overflow->rids[overflow->header.keyCount - 1])) {
+                break;
             }
-            leafNode->rightSibPageNo = UINT32_MAX;
+            PageId nextPageNo = overflow->nextPageNo;
+            this->bufMgr->unPinPage(this->file, pageNo, false);
+            pageNo = nextPageNo;
         }
-        else {
-            NonLeafNodeInt* nonLeafNode = (NonLeafNodeInt*)currPage;
-            for (int i = 0; i<INTARRAYNONLEAFSIZE;i++) {
-                nonLeafNode->keyArray[i] = INT32_MAX;
-                nonLeafNode->pageNoArray[i] = UINT32_MAX;
+        if (overflow->header.keyCount == OverflowPage::CAPACITY) {
+            //The upper half moves to a new page after this one
+            PageId newPageNo;
+            Page *newPage;
+            this->allocNodePage(newPageNo, newPage);
+            OverflowPage *newOverflow = (OverflowPage *) newPage;
+            initOverflow(newOverflow, pageNo, overflow->nextPageNo);
+            const int half = OverflowPage::CAPACITY / 2;
+            newOverflow->header.keyCount = OverflowPage::CAPACITY - half;
+            memcpy(newOverflow->rids, overflow->rids + half, newOverflow->header.keyCount * sizeof(LeafRecordId));
+            overflow->header.keyCount = half;
+            this->linkOverflowPages(list, newPageNo, overflow->nextPageNo);
+            overflow->nextPageNo = newPageNo;
+            if (ridLess(rid, newOverflow->rids[0])) {
+                this->bufMgr->unPinPage(this->file, newPageNo, true);
+            }
+            else {
+                this->bufMgr->unPinPage(this->file, pageNo, true);
+                pageNo = newPageNo;
+                overflow = newOverflow;
             }
-            nonLeafNode->pageNoArray[INTARRAYNONLEAFSIZE] = UINT32_MAX;
-            nonLeafNode->level = 1;
         }
+        int count = overflow->header.keyCount;
+        int i = ridBound<true>(overflow->rids, count, rid);
+        memmove(&overflow->rids[i + 1], &overflow->rids[i], (count - i) * sizeof(LeafRecordId));
+        overflow->rids[i] = rid;
+        overflow->header.keyCount++;
+        this->bufMgr->unPinPage(this->file, pageNo, true);
+        list.overflowCount++;
     }
 
     /**
-     * BTreeIndex Destructor.
-       * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
-       * and delete file instance thereby closing the index file.
-       * Destructor should not throw any exceptions. All exceptions should be caught in here itself.
-     **/
-
-    BTreeIndex::~BTreeIndex() {
-        //Unpin the HeaderPage and the rootpage
-        this->bufMgr->unPinPage(this->file, this->headerPageNum, true);
-        this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
-        //Flush the remaining files of the index file in the buffer Manager
-        this->bufMgr->flushFile(this->file);
+     * removeOverflowRid: Removes a RecordId from the overflow pages of a list, a page left empty is unlinked and freed
+     * @return false if the pages do not hold rid
+     */
+    bool BTreeIndex::removeOverflowRid(PostingList &list, const RecordId &rid) {
+        PageId pageNo = list.firstPageNo;
+        while (pageNo != UINT32_MAX) {
+            Page *page;
+            this->bufMgr->readPage(this->file, pageNo, page);
+            OverflowPage *overflow = (OverflowPage *) page;
+            int count = overflow->header.keyCount;
+            int i = ridBound<false>(overflow->rids, count, rid);
+            if (i < count && (RecordId) overflow->rids[i] == rid) {
+                memmove(&overflow->rids[i], &overflow->rids[i + 1], (count - i - 1) * sizeof(LeafRecordId));
+                overflow->header.keyCount--;
+                list.overflowCount--;
+                if (overflow->header.keyCount == 0) {
+                    this->linkOverflowPages(list, overflow->prevPageNo, overflow->nextPageNo);
+                    this->freeNodePage(pageNo, page);
+                }
+                else {
+                    this->bufMgr->unPinPage(this->file, pageNo, true);
+                }
+                return true;
+            }
+            //The pages after this one only hold greater RecordIds
+            PageId nextPageNo = i < count ? UINT32_MAX : overflow->nextPageNo;
+            this->bufMgr->unPinPage(this->file, pageNo, false);
+            pageNo = nextPageNo;
+        }
+        return false;
+    }
 
-        delete this->file;
+    /**
+     * linkOverflowPages: Makes rightPageNo the page after leftPageNo in the chain of the list. Either one may be
+     * UINT32_MAX, the other page is then the first or last page of the list.
+     */
+    void BTreeIndex::linkOverflowPages(PostingList &list, PageId leftPageNo, PageId rightPageNo) {
+        Page *page;
+        if (leftPageNo == UINT32_MAX) {
+            list.firstPageNo = rightPageNo;
+        }
+        else {
+            this->bufMgr->readPage(this->file, leftPageNo, page);
+            ((OverflowPage *) page)->nextPageNo = rightPageNo;
+            this->bufMgr->unPinPage(this->file, leftPageNo, true);
+        }
+        if (rightPageNo == UINT32_MAX) {
+            list.lastPageNo = leftPageNo;
+        }
+        else {
+            this->bufMgr->readPage(this->file, rightPageNo, page);
+            ((OverflowPage *) page)->prevPageNo = leftPageNo;
+            this->bufMgr->unPinPage(this->file, rightPageNo, true);
+        }
     }
 
-    void BTreeIndex::print(const PageId pageId, int isLeaf, int level) {
+    /**
+     * readOverflow: Copies RecordIds of a chain of overflow pages, for lookups and scans
+     * @param pageNo -> page to start at, moved on to the page the next call starts at, UINT32_MAX past the end of the chain
+     * @param entry -> RecordId of the page to start at, -1 for the last one when reading backwards, moved on as pageNo
+     * @param forward -> true to read towards the last page, false towards the first
+     * @param outRids -> where the RecordIds are copied to
+     * @param maxCount -> most RecordIds to copy, at most the ones of one page are copied
+     * @return number of RecordIds copied
+     */
+    int BTreeIndex::readOverflow(PageId &pageNo, int &entry, bool forward, RecordId *outRids, int maxCount) {
         Page *page;
-        this->bufMgr->readPage(this->file, pageId, page);
-        if (isLeaf) {
-            //Not printing leafNodes currently -- Do nothing
-            //LeafNodeInt* leafNode = (LeafNodeInt*) page;
+        this->bufMgr->readPage(this->file, pageNo, page);
+        const OverflowPage *overflow = (const OverflowPage *) page;
+        int count = overflow->header.keyCount;
+        PageId currentPageNo = pageNo;
+        int n;
+        if (forward) {
+            n = min(count - entry, maxCount);
+            for (int j = 0; j < n; j++) {
+                outRids[j] = overflow->rids[entry + j];
+            }
+            entry += n;
+            if (entry == count) {
+                pageNo = overflow->nextPageNo;
+                entry = 0;
+            }
         }
         else {
-            NonLeafNodeInt *nonLeafNodeData = (NonLeafNodeInt *) page;
-            cout<< "Level : "<< level <<" <";
-            for (int i=0;i<INTARRAYNONLEAFSIZE;i++) {
-                if (nonLeafNodeData->keyArray[i] != INT32_MAX)
-                    cout<<nonLeafNodeData->keyArray[i] << " ";
+            if (entry < 0) {
+                entry = count - 1;
             }
-            cout<< "> \n";
-            // recursive for children
-            PageId childPageId;
-            int childLevel = nonLeafNodeData->level;
-            for (int i=0;i<INTARRAYNONLEAFSIZE;i++) {
-                if (nonLeafNodeData->keyArray[i] != INT32_MAX) {
-                    childPageId = nonLeafNodeData->pageNoArray[i];
-                    print(childPageId, childLevel, level+1);
-                }
+            n = min(entry + 1, maxCount);
+            for (int j = 0; j < n; j++) {
+                outRids[j] = overflow->rids[entry - j];
+            }
+            entry -= n;
+            if (entry < 0) {
+                pageNo = overflow->prevPageNo;
+                entry = -1;
             }
         }
-        this->bufMgr->unPinPage(this->file, pageId, false);
-    }
-
-    void BTreeIndex::printBtree() {
-        this->print(this->rootPageNum, 0, 0);
+        this->bufMgr->unPinPage(this->file, currentPageNo, false);
+        return n;
     }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::insertEntry
+// BTreeIndex::lookup
 // -----------------------------------------------------------------------------
     /**
-     * InsertEntry: Insert new key into the Btree
-     * @param key -> New key to be inserted into the Btree index
-     * @param rid -> recordId of the new key to be inserted into the btree index
+     * lookup: Append the record ids of every entry with the given key to outRids
+     * @param key -> Key to look up, pointer to integer/double/char string
+     * @param outRids -> vector the record ids are appended to
+     * @return number of record ids appended, 0 if the key is not in the index
      */
-    const void BTreeIndex::insertEntry(const void *key, const RecordId rid) {
-        //If root gets splitup, create new root, and update metapage.
-        pair<int, PageId> p = this->findPageAndInsert(this->rootPageNum, key, rid, 0);
-        if (p.first == -1 && p.second == UINT32_MAX) {
-            //do nothing
+    int BTreeIndex::lookup(const void *key, std::vector<RecordId> &outRids) {
+        this->flushInserts();
+        switch (this->attributeType) {
+            case INTEGER:
+                return this->lookupTyped<int>(keyFromPointer<int>(key), &outRids);
+            case DOUBLE:
+                return this->lookupTyped<double>(keyFromPointer<double>(key), &outRids);
+            case STRING:
+                return this->lookupTyped<string>(keyFromPointer<string>(key), &outRids);
         }
-        else {
-            //Case: If root is split
-
-            //Unpin the old rootPage as we have new rootPage
-            this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+        return 0;
+    }
 
-            PageId newPageId;
-            Page* newRootPage;
-            AllocatePageAndSetDefaultValues(newPageId, newRootPage, false);
+    /**
+     * contains: True if the index has an entry with the given key
+     * @param key -> Key to look up, pointer to integer/double/char string
+     */
+    bool BTreeIndex::contains(const void *key) {
+        this->flushInserts();
+        switch (this->attributeType) {
+            case INTEGER:
+                return this->lookupTyped<int>(keyFromPointer<int>(key), NULL) > 0;
+            case DOUBLE:
+                return this->lookupTyped<double>(keyFromPointer<double>(key), NULL) > 0;
+            case STRING:
+                return this->lookupTyped<string>(keyFromPointer<string>(key), NULL) > 0;
+        }
+        return false;
+    }
 
-            //Setup the new root node contents
-            NonLeafNodeInt* newRootNode = (NonLeafNodeInt*) newRootPage;
-            newRootNode->keyArray[0] = p.first;
-            newRootNode->pageNoArray[0] = this->rootPageNum;
-            newRootNode->pageNoArray[1] = p.second;
-            newRootNode->level = 0;
-            this->rootPageNum = newPageId;
-            this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
-            this->bufMgr->readPage(this->file, this->rootPageNum, newRootPage);
+    /**
+     * lookupTyped: lookup for an index with keys of type T. With outRids NULL it stops at the first match.
+     * The entries of the key in a leaf end at its upper bound, they are copied without comparing their keys,
+     * and the RecordIds in the overflow pages of a posting list follow the one in the leaf.
+     */
+    template<class T>
+    int BTreeIndex::lookupTyped(const T &key, std::vector<RecordId> *outRids) {
+        PageId pageNo = this->searchBtree<T>(this->rootPageNum, 0, key, GTE);
+        Page *page;
+        this->bufMgr->readPage(this->file, pageNo, page);
+        LeafNode<T>* leafNode = (LeafNode<T>*) page;
 
-            Page *headerPage;
-            this->bufMgr->readPage(this->file, this->headerPageNum, headerPage);
-            IndexMetaInfo *metaInfo = (IndexMetaInfo*) (headerPage);
-            metaInfo->rootPageNo = this->rootPageNum;
-            this->writeMetaInfoToPage(metaInfo, this->headerPageNum, headerPage);
+        int count = 0;
+        int i = nodeLowerBound(leafNode, key);
+        while (1) {
+            if (i == leafNode->header.keyCount) {
+                //Duplicates may go on in the right sibling
+                PageId rightSibPageNo = leafNode->rightSibPageNo;
+                if (rightSibPageNo == UINT32_MAX) {
+                    break;
+                }
+                this->bufMgr->unPinPage(this->file, pageNo, false);
+                pageNo = rightSibPageNo;
+                this->bufMgr->readPage(this->file, pageNo, page);
+                leafNode = (LeafNode<T>*) page;
+                i = 0;
+                continue;
+            }
+            int end = nodeUpperBound(leafNode, key);
+            if (end == i) {
+                break;
+            }
+            if (outRids == NULL) {
+                count++;
+                break;
+            }
+            for (; i < end; i++) {
+                outRids->push_back(ridAt(leafNode, i));
+                count += 1 + this->overflowRids(leafNode, i, outRids);
+            }
         }
-        return;
+        this->bufMgr->unPinPage(this->file, pageNo, false);
+        return count;
     }
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::countRange
+// -----------------------------------------------------------------------------
     /**
-     * SerachBtree: Searches the btree once the user calls the startscan with the key
-     * @param pageNo-> rootPage number to start the search from
-     * @param isLeafNode-> true if leaf node else False
+     * countRange: Number of entries in a range, from the entry counts of the non-leaf nodes
+     * on the paths to its two ends, or from the leaves of the range if the index has no subtree counts
+     * @param lowValParm -> Low value of range, pointer to integer / double / char string
+     * @param lowOpParm -> GT or GTE
+     * @param highValParm -> High value of range, pointer to integer / double / char string
+     * @param highOpParm -> LT or LTE
      */
-    PageId BTreeIndex::searchBtree(PageId pageNo, bool isLeafNode) {
-
-        if (!isLeafNode) {
+    int BTreeIndex::countRange(const void *lowValParm, const Operator lowOpParm,
+                               const void *highValParm, const Operator highOpParm) {
+        if (highOpParm == GT || highOpParm == GTE || lowOpParm == LT || lowOpParm == LTE) {
+            throw BadOpcodesException();
+        }
+        this->flushInserts();
+        switch (this->attributeType) {
+            case INTEGER:
+                return this->countRangeTyped<int>(keyFromPointer<int>(lowValParm), lowOpParm,
+                                                  keyFromPointer<int>(highValParm), highOpParm);
+            case DOUBLE:
+                return this->countRangeTyped<double>(keyFromPointer<double>(lowValParm), lowOpParm,
+                                                     keyFromPointer<double>(highValParm), highOpParm);
+            case STRING:
+                return this->countRangeTyped<string>(keyFromPointer<string>(lowValParm), lowOpParm,
+                                                     keyFromPointer<string>(highValParm), highOpParm);
+        }
+        return 0;
+    }
 
-            Page *nonLeafPage;
-            this->bufMgr->readPage(this->file, pageNo, nonLeafPage);
-            NonLeafNodeInt* nonLeafNodeData = (NonLeafNodeInt*) nonLeafPage;
-            int i=0;
+    /**
+     * countRangeTyped: countRange for an index with keys of type T
+     */
+    template<class T>
+    int BTreeIndex::countRangeTyped(const T &lowVal, const Operator lowOp, const T &highVal, const Operator highOp) {
+        if (lowVal > highVal) {
+            throw BadScanrangeException();
+        }
+        if ((this->nonLeafFormat & NONLEAF_COUNTS) == 0) {
+            return this->countLeafEntries<T>(lowVal, lowOp, highVal, highOp);
+        }
+        int count = this->entriesBefore<T>(highVal, highOp == LTE) - this->entriesBefore<T>(lowVal, lowOp == GT);
+        return max(0, count);
+    }
 
-            switch (this->lowOp) {
-                case GT:
-                    while ((this->lowValInt +1) >= nonLeafNodeData->keyArray[i] && i<INTARRAYNONLEAFSIZE) {
-                        i++;
-                    }
-                    break;
-                case GTE:
-                    while (this->lowValInt >= nonLeafNodeData->keyArray[i] && i<INTARRAYNONLEAFSIZE) {
-                        i++;
-                    }
-                    break;
-                default:
-                    assert(0);
+    /**
+     * countLeafEntries: countRange of an index without subtree counts. Goes down to the first entry of the range,
+     * as a scan does, and adds up the entries of the leaves up to the end of the range.
+     */
+    template<class T>
+    int BTreeIndex::countLeafEntries(const T &lowVal, const Operator lowOp, const T &highVal, const Operator highOp) {
+        PageId pageNo = this->searchBtree<T>(this->rootPageNum, 0, lowVal, lowOp);
+        Page *page;
+        this->bufMgr->readPage(this->file, pageNo, page);
+        LeafNode<T> *leafNode = (LeafNode<T> *) page;
+        int i = lowOp == GT ? nodeUpperBound(leafNode, lowVal) : nodeLowerBound(leafNode, lowVal);
+        int count = 0;
+        while (1) {
+            int end = highOp == LTE ? nodeUpperBound(leafNode, highVal) : nodeLowerBound(leafNode, highVal);
+            count += entriesIn(leafNode, i, max(i, end));
+            //The range goes on in the right sibling only if it takes the whole rest of the leaf
+            PageId rightSibPageNo = end == leafNode->header.keyCount ? leafNode->rightSibPageNo : UINT32_MAX;
+            this->bufMgr->unPinPage(this->file, pageNo, false);
+            if (rightSibPageNo == UINT32_MAX) {
+                return count;
             }
+            pageNo = rightSibPageNo;
+            this->bufMgr->readPage(this->file, pageNo, page);
+            leafNode = (LeafNode<T> *) page;
+            i = 0;
+        }
+    }
 
-            PageId childPageId;
-            int childLevel = nonLeafNodeData->level;
-            if(i==0 && nonLeafNodeData->pageNoArray[i] == UINT32_MAX){
-                childPageId = nonLeafNodeData->pageNoArray[i + 1];
-
+    /**
+     * firstLeaf: Page number of the leaf holding the smallest keys
+     */
+    template<class T>
+    PageId BTreeIndex::firstLeaf() {
+        PageId pageNo = this->rootPageNum;
+        while (1) {
+            Page *page;
+            this->readNonLeaf(pageNo, page);
+            NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+            PageId childPageNo = childAt(nonLeafNode, 0);
+            bool childIsLeaf = nonLeafNode->level;
+            this->releaseNonLeaf(pageNo, false);
+            pageNo = childPageNo;
+            if (childIsLeaf) {
+                return pageNo;
             }
-            else if (i!=0 &&nonLeafNodeData->pageNoArray[i] == UINT32_MAX ){
-                childPageId = nonLeafNodeData->pageNoArray[i - 1];
+        }
+    }
 
-            }  else {
-                childPageId = nonLeafNodeData->pageNoArray[i ];
+    /**
+     * rank: Number of entries with a key less than the given key, which is the position of the first entry
+     * with the key, or of the first greater key, in key order
+     * @param key -> pointer to integer / double / char string
+     */
+    int BTreeIndex::rank(const void *key) {
+        this->flushInserts();
+        switch (this->attributeType) {
+            case INTEGER:
+                return this->entriesBefore<int>(keyFromPointer<int>(key), false);
+            case DOUBLE:
+                return this->entriesBefore<double>(keyFromPointer<double>(key), false);
+            case STRING:
+                return this->entriesBefore<string>(keyFromPointer<string>(key), false);
+        }
+        return 0;
+    }
 
+    /**
+     * entriesBefore: Number of entries with a key less than key, or less than or equal to it if inclusive.
+     * Adds up the entry counts of the children left of the path to key, one node per level.
+     * Without subtree counts it adds up the entries of the leaves from the first one instead.
+     */
+    template<class T>
+    int BTreeIndex::entriesBefore(const T &key, bool inclusive) {
+        if ((this->nonLeafFormat & NONLEAF_COUNTS) == 0) {
+            return this->leafEntriesBefore<T>(key, inclusive);
+        }
+        int count = 0;
+        PageId pageNo = this->rootPageNum;
+        bool isLeafNode = false;
+        while (1) {
+            Page *page;
+            if (isLeafNode) {
+                this->bufMgr->readPage(this->file, pageNo, page);
+                LeafNode<T> *leafNode = (LeafNode<T> *) page;
+                count += entriesIn(leafNode, 0, inclusive ? nodeUpperBound(leafNode, key) : nodeLowerBound(leafNode, key));
+                this->bufMgr->unPinPage(this->file, pageNo, false);
+                return count;
             }
+            //Keys equal to a separator may be on both sides of it, so the children left of the lower bound
+            //only hold keys less than key, and the ones left of the upper bound keys less than or equal to it
+            this->readNonLeaf(pageNo, page);
+            NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+            int i = inclusive ? nodeUpperBound(nonLeafNode, key) : nodeLowerBound(nonLeafNode, key);
+            for (int j = 0; j < i; j++) {
+                count += countAt(nonLeafNode, j);
+            }
+            PageId childPageNo = childAt(nonLeafNode, i);
+            isLeafNode = nonLeafNode->level;
+            this->releaseNonLeaf(pageNo, false);
+            pageNo = childPageNo;
+        }
+    }
+
+    /**
+     * leafEntriesBefore: entriesBefore of an index without subtree counts
+     */
+    template<class T>
+    int BTreeIndex::leafEntriesBefore(const T &key, bool inclusive) {
+        int count = 0;
+        PageId pageNo = this->firstLeaf<T>();
+        while (1) {
+            Page *page;
+            this->bufMgr->readPage(this->file, pageNo, page);
+            LeafNode<T> *leafNode = (LeafNode<T> *) page;
+            int i = inclusive ? nodeUpperBound(leafNode, key) : nodeLowerBound(leafNode, key);
+            count += entriesIn(leafNode, 0, i);
+            //Keys equal to key may go on in the right sibling
+            PageId rightSibPageNo = i == leafNode->header.keyCount ? leafNode->rightSibPageNo : UINT32_MAX;
             this->bufMgr->unPinPage(this->file, pageNo, false);
-            return this->searchBtree(childPageId, childLevel);
-            //Recursive search on the child Node
+            if (rightSibPageNo == UINT32_MAX) {
+                return count;
+            }
+            pageNo = rightSibPageNo;
+        }
+    }
+
+    /**
+     * selectNth: Fetch the entry at position n in key order, counting from 0
+     * @param n -> position of the entry
+     * @param outRid -> record id of the entry
+     * @param outKey -> if not NULL, the key of the entry, in the format of BTreeScanCursor::scanNextBatch
+     */
+    void BTreeIndex::selectNth(int n, RecordId &outRid, void *outKey) {
+        this->flushInserts();
+        switch (this->attributeType) {
+            case INTEGER:
+                this->selectNthTyped<int>(n, outRid, outKey);
+                break;
+            case DOUBLE:
+                this->selectNthTyped<double>(n, outRid, outKey);
+                break;
+            case STRING:
+                this->selectNthTyped<string>(n, outRid, outKey);
+                break;
+        }
+    }
 
+    /**
+     * selectNthTyped: selectNth for an index with keys of type T. Goes down into the child whose entries
+     * hold position n, skipping the entries of the children left of it. Without subtree counts it skips
+     * whole leaves from the first one instead.
+     */
+    template<class T>
+    void BTreeIndex::selectNthTyped(int n, RecordId &outRid, void *outKey) {
+        if (n < 0) {
+            throw NoSuchKeyFoundException();
         }
-        else {
-            //reached the Leaf Node return the pageId
-            return pageNo;
+        if ((this->nonLeafFormat & NONLEAF_COUNTS) == 0) {
+            PageId pageNo = this->firstLeaf<T>();
+            while (1) {
+                Page *page;
+                this->bufMgr->readPage(this->file, pageNo, page);
+                LeafNode<T> *leafNode = (LeafNode<T> *) page;
+                int entryCount = nodeEntryCount(leafNode);
+                bool found = n < entryCount;
+                if (found) {
+                    this->entryAt(leafNode, n, outRid, outKey);
+                }
+                n -= entryCount;
+                PageId rightSibPageNo = leafNode->rightSibPageNo;
+                this->bufMgr->unPinPage(this->file, pageNo, false);
+                if (found) {
+                    return;
+                }
+                if (rightSibPageNo == UINT32_MAX) {
+                    throw NoSuchKeyFoundException();
+                }
+                pageNo = rightSibPageNo;
+            }
+        }
+        PageId pageNo = this->rootPageNum;
+        bool isLeafNode = false;
+        while (1) {
+            Page *page;
+            if (isLeafNode) {
+                this->bufMgr->readPage(this->file, pageNo, page);
+                LeafNode<T> *leafNode = (LeafNode<T> *) page;
+                bool found = n < nodeEntryCount(leafNode);
+                if (found) {
+                    this->entryAt(leafNode, n, outRid, outKey);
+                }
+                this->bufMgr->unPinPage(this->file, pageNo, false);
+                if (!found) {
+                    throw NoSuchKeyFoundException();
+                }
+                return;
+            }
+            this->readNonLeaf(pageNo, page);
+            NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+            int i = 0;
+            while (i < nonLeafNode->header.keyCount && n >= countAt(nonLeafNode, i)) {
+                n -= countAt(nonLeafNode, i);
+                i++;
+            }
+            PageId childPageNo = childAt(nonLeafNode, i);
+            isLeafNode = nonLeafNode->level;
+            this->releaseNonLeaf(pageNo, false);
+            pageNo = childPageNo;
         }
     }
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::startScan
 // -----------------------------------------------------------------------------
@@ -281,50 +3470,333 @@ namespace badgerdb {
     const void BTreeIndex::startScan(const void *lowValParm,
                                      const Operator lowOpParm,
                                      const void *highValParm,
-                                     const Operator highOpParm) {
+                                     const Operator highOpParm,
+                                     const ScanOrder order) {
+        if (this->scanCursor != NULL) {
+            this->endScan();
+        }
+        this->scanCursor = this->openScan(lowValParm, lowOpParm, highValParm, highOpParm, order);
+    }
+
+    /**
+     * openScan: Begin a scan with its own cursor
+     */
+    BTreeScanCursor *BTreeIndex::openScan(const void *lowValParm,
+                                          const Operator lowOpParm,
+                                          const void *highValParm,
+                                          const Operator highOpParm,
+                                          const ScanOrder order) {
+        this->flushInserts();
+        return new BTreeScanCursor(this, lowValParm, lowOpParm, highValParm, highOpParm, order);
+    }
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::parallelScan
+// -----------------------------------------------------------------------------
 
-        this->lowValInt = *(int*)(lowValParm);
-        this->highValInt = *(int*)(highValParm);
+    //Number of entries a parallelScan thread fetches from its cursor at once
+    const int PARALLEL_SCAN_BATCH = 1024;
 
-        if (this->lowValInt > this->highValInt) {
-            throw BadScanrangeException();
+    /*
+     * Body of a parallelScan thread: scans one part into its sink. An exception is handed over to the calling
+     * thread through error, the cursor is deleted by the calling thread.
+     */
+    void scanPart(BTreeScanCursor *cursor, ScanSink *sink, int keySize, int *count, std::exception_ptr *error) {
+        try {
+            std::vector<RecordId> rids(PARALLEL_SCAN_BATCH);
+            std::vector<char> keys(PARALLEL_SCAN_BATCH * keySize);
+            int n;
+            while ((n = cursor->scanNextBatch(&rids[0], PARALLEL_SCAN_BATCH, &keys[0])) > 0) {
+                sink->consume(&rids[0], &keys[0], n);
+                *count += n;
+            }
         }
+        catch (...) {
+            *error = std::current_exception();
+        }
+    }
 
+    /**
+     * parallelScan: Scan a range on one thread per sink
+     * @param lowValParm -> Low value of range, pointer to integer / double / char string
+     * @param lowOpParm -> GT or GTE
+     * @param highValParm -> High value of range, pointer to integer / double / char string
+     * @param highOpParm -> LT or LTE
+     * @param sinks -> sink of each part, in key order
+     */
+    int BTreeIndex::parallelScan(const void *lowValParm, const Operator lowOpParm,
+                                 const void *highValParm, const Operator highOpParm,
+                                 const std::vector<ScanSink *> &sinks) {
         if (highOpParm == GT || highOpParm == GTE || lowOpParm == LT || lowOpParm == LTE) {
             throw BadOpcodesException();
         }
+        this->flushInserts();
+        //The cursors are opened here, the descents to their first leaves may change the resident non-leaf nodes
+        std::vector<BTreeScanCursor *> cursors(sinks.size(), (BTreeScanCursor *) NULL);
+        bool found = false;
+        switch (this->attributeType) {
+            case INTEGER:
+                found = this->openScanParts<int>(lowValParm, lowOpParm, highValParm, highOpParm, cursors);
+                break;
+            case DOUBLE:
+                found = this->openScanParts<double>(lowValParm, lowOpParm, highValParm, highOpParm, cursors);
+                break;
+            case STRING:
+                found = this->openScanParts<string>(lowValParm, lowOpParm, highValParm, highOpParm, cursors);
+                break;
+        }
+        if (!found) {
+            return 0;
+        }
+
+        int keySize = this->attributeType == STRING ? STRINGKEYMAXSIZE
+                                                    : (this->attributeType == DOUBLE ? sizeof(double) : sizeof(int));
+        std::vector<int> counts(sinks.size(), 0);
+        std::vector<std::exception_ptr> errors(sinks.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < sinks.size(); i++) {
+            threads.push_back(std::thread(scanPart, cursors[i], sinks[i], keySize, &counts[i], &errors[i]));
+        }
+        int count = 0;
+        for (size_t i = 0; i < sinks.size(); i++) {
+            threads[i].join();
+            delete cursors[i];
+            count += counts[i];
+        }
+        for (size_t i = 0; i < sinks.size(); i++) {
+            if (errors[i]) {
+                std::rethrow_exception(errors[i]);
+            }
+        }
+        return count;
+    }
+
+    //Sink that keeps the record ids of its part
+    class RidSink : public ScanSink {
+    public:
+        std::vector<RecordId> rids;
+
+        void consume(const RecordId *partRids, const void *, int count) {
+            this->rids.insert(this->rids.end(), partRids, partRids + count);
+        }
+    };
+
+    /**
+     * parallelScan: Scan a range on numThreads threads and return all record ids in key order
+     * @param outRids -> record ids of the range, the parts one after the other
+     */
+    int BTreeIndex::parallelScan(const void *lowValParm, const Operator lowOpParm,
+                                 const void *highValParm, const Operator highOpParm,
+                                 int numThreads, std::vector<RecordId> &outRids) {
+        std::vector<RidSink> parts(max(1, numThreads));
+        std::vector<ScanSink *> sinks;
+        for (size_t i = 0; i < parts.size(); i++) {
+            sinks.push_back(&parts[i]);
+        }
+        int count = this->parallelScan(lowValParm, lowOpParm, highValParm, highOpParm, sinks);
+        outRids.clear();
+        outRids.reserve(count);
+        for (size_t i = 0; i < parts.size(); i++) {
+            outRids.insert(outRids.end(), parts[i].rids.begin(), parts[i].rids.end());
+        }
+        return count;
+    }
+
+    /**
+     * openScanParts: Split the range into cursors.size() parts with about the same number of entries and open
+     * a cursor on each. Part i starts at the key of the entry at position first + i * (end - first) / parts,
+     * selectNth finds it through the entry counts. It ends before the start of part i + 1.
+     * Without subtree counts the parts start at evenly spaced keys of the non-leaf nodes inside the range,
+     * see rangeSeparators, and some parts may be empty.
+     * @return false, and no cursor is opened, if there are no entries in the range
+     */
+    template<class T>
+    bool BTreeIndex::openScanParts(const void *lowValParm, const Operator lowOpParm,
+                                   const void *highValParm, const Operator highOpParm,
+                                   std::vector<BTreeScanCursor *> &cursors) {
+        T lowVal = keyFromPointer<T>(lowValParm);
+        T highVal = keyFromPointer<T>(highValParm);
+        if (lowVal > highVal) {
+            throw BadScanrangeException();
+        }
+        int parts = (int) cursors.size();
+        if (parts == 0) {
+            return false;
+        }
+
+        //Start keys in the key format of selectNth, so they can be passed as scan bounds
+        int keySize = this->attributeType == STRING ? STRINGKEYMAXSIZE : sizeof(T);
+        std::vector<char> startKeys(parts * keySize);
+        if ((this->nonLeafFormat & NONLEAF_COUNTS) != 0) {
+            int first = this->entriesBefore<T>(lowVal, lowOpParm == GT);
+            int end = this->entriesBefore<T>(highVal, highOpParm == LTE);
+            if (end <= first) {
+                return false;
+            }
+            for (int i = 1; i < parts; i++) {
+                RecordId rid;
+                int position = first + (int) ((long long) i * (end - first) / parts);
+                this->selectNthTyped<T>(position, rid, &startKeys[i * keySize]);
+            }
+        }
+        else {
+            //Parts starting at the high value are empty, or hold only the high value of an LTE range
+            std::vector<T> separators;
+            this->rangeSeparators<T>(lowVal, highVal, parts - 1, separators);
+            if (separators.empty()) {
+                separators.push_back(highVal);
+            }
+            for (int i = 1; i < parts; i++) {
+                keyToPointer(separators[(long long) i * separators.size() / parts], &startKeys[i * keySize]);
+            }
+        }
+        try {
+            for (int i = 0; i < parts; i++) {
+                const void *partLow = i == 0 ? lowValParm : &startKeys[i * keySize];
+                const void *partHigh = i == parts - 1 ? highValParm : &startKeys[(i + 1) * keySize];
+                cursors[i] = new BTreeScanCursor(this, partLow, i == 0 ? lowOpParm : GTE,
+                                                 partHigh, i == parts - 1 ? highOpParm : LT, ASCENDING);
+            }
+        }
+        catch (...) {
+            for (int i = 0; i < parts; i++) {
+                delete cursors[i];
+                cursors[i] = NULL;
+            }
+            throw;
+        }
+        return true;
+    }
+
+    /**
+     * rangeSeparators: Keys of the non-leaf nodes greater than lowVal and not greater than highVal, in key order.
+     * Takes the keys of the nodes of one level, going down a level at a time through the children in the range
+     * until there are at least wanted keys or the level above the leaves is reached.
+     */
+    template<class T>
+    void BTreeIndex::rangeSeparators(const T &lowVal, const T &highVal, int wanted, std::vector<T> &separators) {
+        std::vector<PageId> levelPageNos(1, this->rootPageNum);
+        while (1) {
+            separators.clear();
+            std::vector<PageId> childPageNos;
+            bool childrenAreLeaves = false;
+            for (size_t n = 0; n < levelPageNos.size(); n++) {
+                Page *page;
+                this->readNonLeaf(levelPageNos[n], page);
+                NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) page;
+                //Keys equal to lowVal may also be in the child left of the first key equal to it
+                int firstChild = nodeLowerBound(nonLeafNode, lowVal);
+                int firstKey = nodeUpperBound(nonLeafNode, lowVal);
+                int end = nodeUpperBound(nonLeafNode, highVal);
+                for (int i = firstKey; i < end; i++) {
+                    separators.push_back(keyAt(nonLeafNode, i));
+                }
+                for (int i = firstChild; i <= end; i++) {
+                    childPageNos.push_back(childAt(nonLeafNode, i));
+                }
+                childrenAreLeaves = nonLeafNode->level;
+                this->releaseNonLeaf(levelPageNos[n], false);
+            }
+            if ((int) separators.size() >= wanted || childrenAreLeaves) {
+                return;
+            }
+            levelPageNos.swap(childPageNos);
+        }
+    }
 
-        this->scanExecuting = true;
+    /**
+     * BTreeScanCursor Constructor.
+     * Checks the range and sets up the cursor on the leaf holding the first key in the range,
+     * or the last one for a DESCENDING scan
+     */
+    BTreeScanCursor::BTreeScanCursor(BTreeIndex *index,
+                                     const void *lowValParm,
+                                     const Operator lowOpParm,
+                                     const void *highValParm,
+                                     const Operator highOpParm,
+                                     const ScanOrder order) {
+        this->index = index;
         this->lowOp = lowOpParm;
         this->highOp = highOpParm;
-        //Start search on rootPage
+        this->order = order;
+        switch (index->attributeType) {
+            case INTEGER:
+                this->start<int>(lowValParm, highValParm);
+                break;
+            case DOUBLE:
+                this->start<double>(lowValParm, highValParm);
+                break;
+            case STRING:
+                this->start<string>(lowValParm, highValParm);
+                break;
+        }
+    }
+
+    /**
+     * start: Constructor of the cursor for an index with keys of type T
+     */
+    template<class T>
+    void BTreeScanCursor::start(const void *lowValParm, const void *highValParm) {
+
+        T &lowVal = this->scanLowVal<T>();
+        T &highVal = this->scanHighVal<T>();
+        lowVal = keyFromPointer<T>(lowValParm);
+        highVal = keyFromPointer<T>(highValParm);
+
+        if (lowVal > highVal) {
+            throw BadScanrangeException();
+        }
 
-        PageId foundLeafPage = searchBtree(this->rootPageNum, 0);
+        if (this->highOp == GT || this->highOp == GTE || this->lowOp == LT || this->lowOp == LTE) {
+            throw BadOpcodesException();
+        }
+
+        //Start search on rootPage, from the end of the range the scan starts at
+        const T &bound = this->order == ASCENDING ? lowVal : highVal;
+        Operator op = this->order == ASCENDING ? this->lowOp : this->highOp;
+        PageId foundLeafPage = this->index->searchBtree<T>(this->index->rootPageNum, 0, bound, op);
 
         this->currentPageNum = foundLeafPage;
-        this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
+        this->index->bufMgr->readPage(this->index->file, this->currentPageNum, this->currentPageData);
 
-        LeafNodeInt* currentLeaf = (LeafNodeInt*) (this->currentPageData);
-        int i = 0;
-        switch (lowOpParm) {
+        LeafNode<T>* currentLeaf = (LeafNode<T>*) (this->currentPageData);
+        int i;
+        switch (op) {
             case GT:
-                while (this->lowValInt+1 > currentLeaf->keyArray[i] && i < INTARRAYLEAFSIZE) {
-                    i++;
-                }
+                i = nodeUpperBound(currentLeaf, bound);
                 break;
             case GTE:
-                while (this->lowValInt > currentLeaf->keyArray[i] && i < INTARRAYLEAFSIZE) {
-                    i++;
-                }
+                i = nodeLowerBound(currentLeaf, bound);
+                break;
+            case LT:
+                i = nodeLowerBound(currentLeaf, bound) - 1;
+                break;
+            case LTE:
+                i = nodeUpperBound(currentLeaf, bound) - 1;
                 break;
             default:
                 assert(0);
         }
+        //i == count if every key of the leaf is below the range, scanNext moves on to the right sibling.
+        //In a DESCENDING scan i == -1 if every key is above the range, scanNext moves on to the left sibling
         this->nextEntry = i;
-        if (i == INTARRAYLEAFSIZE) {
-            assert(0); //ASSERT here, not possible, must have the key,rid pair here
-        }
-        return;
+        this->rangeLimit = -1;
+        this->readAheadPageNo = this->currentPageNum;
+        this->leavesAhead = 0;
+        this->leavesScanned = 0;
+        this->readAheadCount = 0;
+        this->overflowPageNo = UINT32_MAX;
+        this->overflowEntry = 0;
+        this->listDone = false;
+    }
+
+    /**
+     * BTreeScanCursor Destructor.
+     * Unpins the leaf the cursor is on
+     */
+    BTreeScanCursor::~BTreeScanCursor() {
+        this->index->bufMgr->unPinPage(this->index->file, this->currentPageNum, false);
+        this->index->aheadLeafReads += this->readAheadCount;
     }
 
 // -----------------------------------------------------------------------------
@@ -339,58 +3811,351 @@ namespace badgerdb {
 	**/
     const void BTreeIndex::scanNext(RecordId &outRid) {
         //Already know the leafPageId and data
-        if (!this->scanExecuting) {
+        if (this->scanCursor == NULL) {
             throw ScanNotInitializedException();
         }
-        LeafNodeInt* currentLeaf;
-        currentLeaf = (LeafNodeInt*) (this->currentPageData);
+        this->scanCursor->scanNext(outRid);
+    }
 
-        if (this->nextEntry == INTARRAYLEAFSIZE || currentLeaf->keyArray[this->nextEntry] == INT32_MAX ) {
-            if (currentLeaf->rightSibPageNo != UINT32_MAX) {
-                PageId  oldLeafNodeId = currentLeaf->rightSibPageNo;
-                this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
-                this->currentPageNum = oldLeafNodeId;
+    /**
+     * scanNext: Fetch the record id of the next index entry that matches the scan of the cursor
+     */
+    const void BTreeScanCursor::scanNext(RecordId &outRid) {
+        bool ascending = this->order == ASCENDING;
+        switch (this->index->attributeType) {
+            case INTEGER:
+                ascending ? this->next<int>(outRid) : this->prev<int>(outRid);
+                break;
+            case DOUBLE:
+                ascending ? this->next<double>(outRid) : this->prev<double>(outRid);
+                break;
+            case STRING:
+                ascending ? this->next<string>(outRid) : this->prev<string>(outRid);
+                break;
+        }
+    }
 
-                this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
-                currentLeaf = (LeafNodeInt*) (this->currentPageData);
-                this->nextEntry = 0;
+    /**
+     * next: scanNext for an index with keys of type T
+     */
+    template<class T>
+    void BTreeScanCursor::next(RecordId &outRid) {
+        if (this->index->leafFormat == LEAF_POSTINGS) {
+            //The entry may be followed by the overflow pages of its list, which nextBatch streams
+            if (this->nextBatch<T, char>(&outRid, 1, NULL, NULL) == 0) {
+                throw IndexScanCompletedException();
             }
-            else {
+            return;
+        }
+        LeafNode<T>* currentLeaf;
+        currentLeaf = (LeafNode<T>*) (this->currentPageData);
+
+        //Loop, as a leaf may also be empty
+        while (this->nextEntry >= currentLeaf->header.keyCount) {
+            if (!this->stepLeaf<T>()) {
                 throw IndexScanCompletedException();
             }
+            currentLeaf = (LeafNode<T>*) (this->currentPageData);
         }
 
         //this->nextEntry must be valid here
-        switch (this->highOp) {
-            case LTE:
-                if (currentLeaf->keyArray[this->nextEntry] <= this->highValInt) {
-                    outRid = currentLeaf->ridArray[this->nextEntry];
-                    this->nextEntry++;
+        if (this->rangeLimit < 0) {
+            this->rangeLimit = this->highOp == LT ? nodeLowerBound(currentLeaf, this->scanHighVal<T>())
+                                                  : nodeUpperBound(currentLeaf, this->scanHighVal<T>());
+        }
+        if (this->nextEntry >= this->rangeLimit) {
+            throw IndexScanCompletedException();
+        }
+        outRid = ridAt(currentLeaf, this->nextEntry);
+        this->nextEntry++;
+    }
+
+    /**
+     * scanNextBatch: Fetch the record ids of the next index entries that match the scan
+     */
+    int BTreeIndex::scanNextBatch(RecordId *outRids, int maxCount, void *outKeys, void *outPayloads) {
+        if (this->scanCursor == NULL) {
+            throw ScanNotInitializedException();
+        }
+        return this->scanCursor->scanNextBatch(outRids, maxCount, outKeys, outPayloads);
+    }
+
+    /**
+     * scanNextBatch: Fetch the record ids of the next index entries that match the scan of the cursor
+     */
+    int BTreeScanCursor::scanNextBatch(RecordId *outRids, int maxCount, void *outKeys, void *outPayloads) {
+        typedef char StringKey[STRINGKEYMAXSIZE];
+        bool ascending = this->order == ASCENDING;
+        char *payloads = (char *) outPayloads;
+        switch (this->index->attributeType) {
+            case INTEGER:
+                return ascending ? this->nextBatch<int>(outRids, maxCount, (int *) outKeys, payloads)
+                                 : this->prevBatch<int>(outRids, maxCount, (int *) outKeys, payloads);
+            case DOUBLE:
+                return ascending ? this->nextBatch<double>(outRids, maxCount, (double *) outKeys, payloads)
+                                 : this->prevBatch<double>(outRids, maxCount, (double *) outKeys, payloads);
+            case STRING:
+                return ascending ? this->nextBatch<string>(outRids, maxCount, (StringKey *) outKeys, payloads)
+                                 : this->prevBatch<string>(outRids, maxCount, (StringKey *) outKeys, payloads);
+        }
+        return 0;
+    }
+
+    /**
+     * nextBatch: scanNextBatch for an index with keys of type T. Copies the matching entries of a leaf at once,
+     * the end of the range inside a leaf is found by one binary search. A copy stops after an entry whose posting list
+     * has overflow pages, the RecordIds in them come next, with the key of the entry.
+     * @param outKeys -> K is the type of one key in the outKeys array
+     * @param outPayloads -> payloadSize bytes per entry
+     */
+    template<class T, class K>
+    int BTreeScanCursor::nextBatch(RecordId *outRids, int maxCount, K *outKeys, char *outPayloads) {
+        const int payloadSize = this->index->leafPayloadSize;
+        LeafNode<T>* currentLeaf = (LeafNode<T>*) (this->currentPageData);
+        const T &highVal = this->scanHighVal<T>();
+
+        int count = 0;
+        while (count < maxCount) {
+            if (this->overflowPageNo != UINT32_MAX) {
+                int n = this->index->readOverflow(this->overflowPageNo, this->overflowEntry, true, outRids + count,
+                                                  maxCount - count);
+                if (outKeys != NULL) {
+                    T key = keyAt(currentLeaf, this->nextEntry - 1);
+                    for (int j = 0; j < n; j++) {
+                        keyToPointer(key, outKeys + count + j);
+                    }
                 }
-                else {
-                    throw IndexScanCompletedException();
+                count += n;
+                continue;
+            }
+            if (this->nextEntry >= currentLeaf->header.keyCount) {
+                if (!this->stepLeaf<T>()) {
+                    break;
                 }
+                currentLeaf = (LeafNode<T>*) (this->currentPageData);
+                continue;
+            }
+
+            //Entries before end are in the range
+            if (this->rangeLimit < 0) {
+                this->rangeLimit = this->highOp == LT ? nodeLowerBound(currentLeaf, highVal) : nodeUpperBound(currentLeaf, highVal);
+            }
+            int end = this->rangeLimit;
+            int n = min(end - this->nextEntry, maxCount - count);
+            if (n <= 0) {
                 break;
-            case LT:
-                if (currentLeaf->keyArray[this->nextEntry] < this->highValInt) {
-                    outRid = currentLeaf->ridArray[this->nextEntry];
-                    this->nextEntry++;
+            }
+            int listed = nextListed(currentLeaf, this->nextEntry, this->nextEntry + n);
+            const PostingList *list = NULL;
+            if (listed < this->nextEntry + n) {
+                n = listed - this->nextEntry + 1;
+                list = listAt(currentLeaf, listed);
+            }
+            copyEntries(currentLeaf, this->nextEntry, n, outRids + count, outKeys == NULL ? NULL : outKeys + count,
+                        outPayloads == NULL ? NULL : outPayloads + count * payloadSize);
+            this->nextEntry += n;
+            count += n;
+            if (list != NULL) {
+                this->overflowPageNo = list->firstPageNo;
+                this->overflowEntry = 0;
+            }
+            else if (end < currentLeaf->header.keyCount) {
+                //The range ends in this leaf
+                break;
+            }
+        }
+        //The next batch likely starts where this one ended, load its first entries while the caller works on this one
+        if (this->rangeLimit >= 0) {
+            prefetchEntries(currentLeaf, this->nextEntry, max(0, min(count, this->rangeLimit - this->nextEntry)));
+        }
+        return count;
+    }
+
+    /**
+     * prev: scanNext of a DESCENDING scan for an index with keys of type T
+     */
+    template<class T>
+    void BTreeScanCursor::prev(RecordId &outRid) {
+        if (this->index->leafFormat == LEAF_POSTINGS) {
+            if (this->prevBatch<T, char>(&outRid, 1, NULL, NULL) == 0) {
+                throw IndexScanCompletedException();
+            }
+            return;
+        }
+        LeafNode<T>* currentLeaf = (LeafNode<T>*) (this->currentPageData);
+
+        //Loop, as a leaf may also be empty
+        while (this->nextEntry < 0) {
+            if (!this->stepLeaf<T>()) {
+                throw IndexScanCompletedException();
+            }
+            currentLeaf = (LeafNode<T>*) (this->currentPageData);
+        }
+
+        if (this->rangeLimit < 0) {
+            this->rangeLimit = this->lowOp == GT ? nodeUpperBound(currentLeaf, this->scanLowVal<T>())
+                                                 : nodeLowerBound(currentLeaf, this->scanLowVal<T>());
+        }
+        if (this->nextEntry < this->rangeLimit) {
+            throw IndexScanCompletedException();
+        }
+        outRid = ridAt(currentLeaf, this->nextEntry);
+        this->nextEntry--;
+    }
+
+    /**
+     * prevBatch: scanNextBatch of a DESCENDING scan for an index with keys of type T
+     */
+    template<class T, class K>
+    int BTreeScanCursor::prevBatch(RecordId *outRids, int maxCount, K *outKeys, char *outPayloads) {
+        const int payloadSize = this->index->leafPayloadSize;
+        LeafNode<T>* currentLeaf = (LeafNode<T>*) (this->currentPageData);
+        const T &lowVal = this->scanLowVal<T>();
+
+        int count = 0;
+        while (count < maxCount) {
+            if (this->overflowPageNo != UINT32_MAX) {
+                int n = this->index->readOverflow(this->overflowPageNo, this->overflowEntry, false, outRids + count,
+                                                  maxCount - count);
+                if (outKeys != NULL) {
+                    T key = keyAt(currentLeaf, this->nextEntry);
+                    for (int j = 0; j < n; j++) {
+                        keyToPointer(key, outKeys + count + j);
+                    }
                 }
-                else {
-                    throw IndexScanCompletedException();
+                count += n;
+                this->listDone = this->overflowPageNo == UINT32_MAX;
+                continue;
+            }
+            if (this->nextEntry < 0) {
+                if (!this->stepLeaf<T>()) {
+                    break;
                 }
+                currentLeaf = (LeafNode<T>*) (this->currentPageData);
+                continue;
+            }
+
+            //Entries from begin on are in the range
+            if (this->rangeLimit < 0) {
+                this->rangeLimit = this->lowOp == GT ? nodeUpperBound(currentLeaf, lowVal) : nodeLowerBound(currentLeaf, lowVal);
+            }
+            int begin = this->rangeLimit;
+            int n = min(this->nextEntry - begin + 1, maxCount - count);
+            if (n <= 0) {
                 break;
-            default:
-                assert(0);
+            }
+            //The overflow pages of a list hold its greatest RecordIds, they come before the entry in the leaf
+            const PostingList *list = this->listDone ? NULL : listAt(currentLeaf, this->nextEntry);
+            if (list != NULL) {
+                this->overflowPageNo = list->lastPageNo;
+                this->overflowEntry = -1;
+                continue;
+            }
+            n = min(n, this->nextEntry - prevListed(currentLeaf, this->nextEntry - 1, this->nextEntry - n + 1));
+            this->listDone = false;
+            for (int j = 0; j < n; j++) {
+                copyEntries(currentLeaf, this->nextEntry - j, 1, outRids + count + j,
+                            outKeys == NULL ? NULL : outKeys + count + j,
+                            outPayloads == NULL ? NULL : outPayloads + (count + j) * payloadSize);
+            }
+            this->nextEntry -= n;
+            count += n;
+            if (begin > 0 && this->nextEntry < begin) {
+                //The range begins in this leaf
+                break;
+            }
         }
+        if (this->rangeLimit >= 0) {
+            int ahead = max(0, min(count, this->nextEntry - this->rangeLimit + 1));
+            prefetchEntries(currentLeaf, this->nextEntry - ahead + 1, ahead);
+        }
+        return count;
     }
 
-    //structure of record in the relation, copied from main.cpp -- Needed here for typecasting the record back
-    typedef struct tuple {
-        int i;
-        double d;
-        char s[64];
-    } RECORD;
+    /**
+     * stepLeaf: Move the cursor on to the next leaf of the scan, the right sibling of the current leaf in an ASCENDING
+     * scan and the left sibling in a DESCENDING scan, and keep the leaves after it read ahead.
+     * @return false, and the cursor stays on its leaf, if the current leaf is the last one
+     */
+    template<class T>
+    bool BTreeScanCursor::stepLeaf() {
+        BufMgr *bufMgr = this->index->bufMgr;
+        File *file = this->index->file;
+        bool ascending = this->order == ASCENDING;
+        LeafNode<T> *currentLeaf = (LeafNode<T> *) (this->currentPageData);
+        PageId siblingPageNo = ascending ? currentLeaf->rightSibPageNo : currentLeaf->leftSibPageNo;
+        if (siblingPageNo == UINT32_MAX) {
+            return false;
+        }
+        bufMgr->unPinPage(file, this->currentPageNum, false);
+        this->currentPageNum = siblingPageNo;
+        bufMgr->readPage(file, this->currentPageNum, this->currentPageData);
+        currentLeaf = (LeafNode<T> *) (this->currentPageData);
+        this->nextEntry = ascending ? 0 : currentLeaf->header.keyCount - 1;
+        this->rangeLimit = -1;
+        this->listDone = false;
+        //The scan goes on from one end of the leaf, load the first lines of entries from that end
+        const int B = KeyLines<T>::KEYS_PER_LINE;
+        int firstLines = min(currentLeaf->header.keyCount, B);
+        prefetchEntries(currentLeaf, ascending ? 0 : currentLeaf->header.keyCount - firstLines, firstLines);
+
+        this->leavesScanned++;
+        if (this->leavesAhead > 0) {
+            this->leavesAhead--;
+        }
+        else if (this->readAheadPageNo != UINT32_MAX) {
+            this->readAheadPageNo = this->currentPageNum;
+        }
+        this->readAhead<T>();
+        return true;
+    }
+
+    /**
+     * readAhead: Read leaves after the last leaf read ahead into the buffer pool, until the scan has as many leaves
+     * read ahead as it moved through so far, at most IndexOptions::readAheadLeaves. The buffer manager reads pages
+     * synchronously, so the leaves are read here in one go instead of one at a time as the scan reaches them.
+     * Stops at the leaf the range ends in. The leaves are unpinned, the scan itself still follows the sibling links.
+     */
+    template<class T>
+    void BTreeScanCursor::readAhead() {
+        int window = min(this->leavesScanned, this->index->readAheadLimit);
+        if (this->readAheadPageNo == UINT32_MAX || this->leavesAhead >= window) {
+            return;
+        }
+        BufMgr *bufMgr = this->index->bufMgr;
+        File *file = this->index->file;
+        bool ascending = this->order == ASCENDING;
+        Page *page;
+        bufMgr->readPage(file, this->readAheadPageNo, page);
+        while (true) {
+            LeafNode<T> *leaf = (LeafNode<T> *) page;
+            PageId siblingPageNo = ascending ? leaf->rightSibPageNo : leaf->leftSibPageNo;
+            bool rangeEnds = false;
+            if (leaf->header.keyCount > 0) {
+                if (ascending) {
+                    int c = compareKeyAt(leaf, leaf->header.keyCount - 1, this->scanHighVal<T>());
+                    rangeEnds = this->highOp == LT ? c >= 0 : c > 0;
+                }
+                else {
+                    int c = compareKeyAt(leaf, 0, this->scanLowVal<T>());
+                    rangeEnds = this->lowOp == GT ? c <= 0 : c < 0;
+                }
+            }
+            bufMgr->unPinPage(file, this->readAheadPageNo, false);
+            if (siblingPageNo == UINT32_MAX || rangeEnds) {
+                this->readAheadPageNo = UINT32_MAX;
+                return;
+            }
+            this->readAheadPageNo = siblingPageNo;
+            this->leavesAhead++;
+            this->readAheadCount++;
+            bufMgr->readPage(file, this->readAheadPageNo, page);
+            if (this->leavesAhead >= window) {
+                bufMgr->unPinPage(file, this->readAheadPageNo, false);
+                return;
+            }
+        }
+    }
 
 // -----------------------------------------------------------------------------
 // BTreeIndex::endScan
@@ -401,141 +4166,318 @@ namespace badgerdb {
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	**/
     const void BTreeIndex::endScan() {
-        if (!this->scanExecuting) {
+        if (this->scanCursor == NULL) {
             throw ScanNotInitializedException();
         }
-        this->scanExecuting = false;
-        this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
-    }
-
-    /**
-     * Given the FileIterator and PageIterator, fetches the next record from the
-     * page iterator and extracts key from that record
-     * @param fileit -> File Iterator
-     * @param page_ir -> Page Iterator
-     */
-    int BTreeIndex::getKeyValue(FileIterator &file_it, PageIterator &page_it) {
-        RecordId currRecordId = page_it.getCurrentRecord();
-        string currRecord = (*file_it).getRecord(currRecordId);
-        //Assumed Records to be of the type "struct tuple" defined in main.cpp
-        tuple *fetchedRecord;// = new tuple();
-        fetchedRecord = (tuple*) (currRecord.c_str());
-        //int keyValue = stoi(keyString);
-
-        int keyValue = fetchedRecord->i;//keyString[0];
-        return keyValue;
+        delete this->scanCursor;
+        this->scanCursor = NULL;
     }
 
     /**
      * ConstructBTree: Called from the btreeIndex constructor
      * which will iterate throught the give relation and constructs the btree index
      * @param relationName -> Relation Name
+     * @param keyExtractor -> reads the key of each record
      */
-    void BTreeIndex::constructBtree(const std::string &relationName) {
+    template<class T>
+    void BTreeIndex::constructBtree(const std::string &relationName, const KeyExtractor *keyExtractor) {
 
         PageFile relation = PageFile::open(relationName);//open relation page file
         FileIterator file_it = relation.begin();//file begin, points to 1st page
+        vector<char> payload(this->leafPayloadSize);
 
         while (file_it != relation.end()) {
-            PageIterator page_it = (*file_it).begin(); //page begin, points to 1st record
-            while (page_it != (*file_it).end()) {
+            //Read each page once, the keys are read from its records in place
+            Page page = *file_it;
+            PageIterator page_it = page.begin(); //page begin, points to 1st record
+            while (page_it != page.end()) {
                 RecordId currRecordId = page_it.getCurrentRecord();
-                int keyValue = this->getKeyValue(file_it, page_it);
-                this->insertEntry((void *) &keyValue, currRecordId);
+                T keyValue = recordKey<T>(keyExtractor, page, currRecordId);
+                if (this->leafPayloadSize > 0) {
+                    std::size_t length;
+                    const char *record = page.getRecordBytes(currRecordId, length);
+                    this->extractPayload(record, length, &payload[0]);
+                }
+                this->insertEntryTyped<T>(keyValue, currRecordId, this->leafPayloadSize > 0 ? &payload[0] : NULL);
                 page_it++;
             }
             file_it++;
         }
         //Destructor of Pagefile closes the file. No explicit close
     }
+
     /**
-     * shiftAndInsert: Find the position of the currKey into the keyArray and inserts into the array
-     * shifting rest of the elements
-     * @param keyArray-> keyarray which may be in LeafNode or NonLeafNode
-     * @param Tarray-> PageNoArray incase of nonLeafNode or rid array incase of LeafNode
-     * @param currKey -> the key to be inserted into the keyArray
-     * @param Tvalue -> Pid incase of nonLeafNode or rid incase of the LeafNode
-     * @param keyArray_size -> Size of the key array
-     * @param array_size2 -> which is the size of the PageNoArray or the rid array
+     * bulkLoadBtree: Called from the btreeIndex constructor instead of constructBtree.
+     * Collects and sorts all the (key, rid) pairs of the relation, packs them into leaves from left to right
+     * and then builds the non-leaf levels bottom-up until a single root node is left.
+     * Every page is written exactly once, the root page is left pinned.
+     * @param relationName -> Relation Name
+     * @param fillFactor -> fraction of the slots of each node to fill
+     * @param buildThreads -> number of threads to collect the pairs on
+     * @param keyExtractor -> reads the key of each record
      */
+    template<class T>
+    void BTreeIndex::bulkLoadBtree(const std::string &relationName, double fillFactor, int buildThreads,
+                                   const KeyExtractor *keyExtractor) {
+        vector<RIDKeyPair<T> > entries;
+        RecordPayloads payloads(this->leafPayloadSize);
+        this->collectSortedEntries<T>(relationName, buildThreads, keyExtractor, entries, payloads);
+
+        Page *rootPage;
+        if (entries.empty()) {
+            //Nothing to load, start with the same empty root as the insert path
+            allocateEmptyRoot<T>();
+            return;
+        }
 
-    template <typename T>
-    void shiftAndInsert(int *keyArray, T *TArray, int &currKey, const T &Tvalue, int keyArray_size, int array_size2) {
+        vector<int> leafCounts;
+        bulkLeafCounts(entries, fillFactor, this->leafPayloadSize, this->leafFormat, leafCounts);
 
-        //Called only if node has space
+        vector<PageKeyPair<T> > level;
+        vector<int> levelCounts;
+        PageId prevLeafPageNo = UINT32_MAX;
+        LeafNode<T> *prevLeaf = NULL;
+        int next = 0;
+        for (size_t leaf = 0; leaf < leafCounts.size(); leaf++) {
+            int count = leafCounts[leaf];
+            PageId leafPageNo;
+            Page *leafPage;
+            AllocatePageAndSetDefaultValues<T>(leafPageNo, leafPage, true);
+            LeafNode<T> *leafNode = (LeafNode<T> *) leafPage;
+            this->fillLeaf(leafNode, entries, next, count, payloads);
 
-        int i = 0;
-        //TODO: can i exceed array size: check and update
-        while (keyArray[i] < currKey) {
-            i++;
-        }
-        //empty slot, no shifting required, insert and return
-        if (keyArray[i] == INT32_MAX) {
-            keyArray[i] = currKey;
-            if (array_size2==keyArray_size) {//For leaf node
-                TArray[i] = Tvalue;
-            }
-            else{//For nonleaf node
-                TArray[i+1] = Tvalue;
+            //Link the previous leaf, now that its right sibling is known, and write it out
+            leafNode->leftSibPageNo = prevLeafPageNo;
+            if (prevLeaf != NULL) {
+                prevLeaf->rightSibPageNo = leafPageNo;
+                this->bufMgr->unPinPage(this->file, prevLeafPageNo, true);
             }
-            return;
-        }
+            PageKeyPair<T> child;
+            child.set(leafPageNo, entries[next].key);
+            level.push_back(child);
+            levelCounts.push_back(count);
 
-        for (int k = keyArray_size - 1; k > i; k--) {
-            keyArray[k] = keyArray[k - 1];
+            prevLeaf = leafNode;
+            prevLeafPageNo = leafPageNo;
+            next += count;
         }
+        this->bufMgr->unPinPage(this->file, prevLeafPageNo, true);
+
+        //The root is a non-leaf node even if there is a single leaf, then it just has no keys
+        bool childrenAreLeaves = true;
+        do {
+            level = buildNonLeafLevel<T>(level, levelCounts, childrenAreLeaves, fillFactor);
+            childrenAreLeaves = false;
+        } while (level.size() > 1);
+        this->rootPageNum = level[0].pageNo;
+        this->bufMgr->readPage(this->file, this->rootPageNum, rootPage);
+    }
 
-        if (keyArray_size == array_size2) {//For leaf node
-            for (int j = array_size2 - 1; j > i; j--) {
-                TArray[j] = TArray[j - 1];
+    /**
+     * Pages of a relation, handed out one at a time to the threads collecting its (key, rid) pairs.
+     * The relation file has a single stream, so reading a page and moving to the next one is done under a lock.
+     */
+    class RelationPages {
+    public:
+        RelationPages(PageFile &relation) : next(relation.begin()), end(relation.end()) {}
+
+        //Copies the next page of the relation into page, returns false once every page was handed out
+        bool take(Page &page) {
+            std::lock_guard<std::mutex> guard(this->mutex);
+            if (this->next == this->end) {
+                return false;
             }
-            keyArray[i] = currKey;
-            TArray[i] = Tvalue;
+            page = *this->next;
+            this->next++;
+            return true;
         }
-        else {// for NonLeafNode
-            for (int j = array_size2 - 1; j > i+1; j--) {
-                TArray[j] = TArray[j - 1];
+
+    private:
+        FileIterator next;
+        FileIterator end;
+        std::mutex mutex;
+    };
+
+    /**
+     * collectRun: Worker of collectSortedEntries. Takes pages until there are none left, adds the (key, rid) pair
+     * of every record on them to run and sorts it.
+     * @param keyExtractor -> reads the key of each record
+     * @param index -> reads the payload of each record into payloads, if the index has included attributes
+     * @param error -> set to the exception the worker stopped on, if any
+     */
+    template<class T>
+    void collectRun(RelationPages *pages, const KeyExtractor *keyExtractor, const BTreeIndex *index,
+                    vector<RIDKeyPair<T> > *run, RecordPayloads *payloads, std::exception_ptr *error) {
+        try {
+            Page page;
+            vector<char> payload(index->payloadSize());
+            while (pages->take(page)) {
+                for (PageIterator page_it = page.begin(); page_it != page.end(); page_it++) {
+                    RIDKeyPair<T> entry;
+                    RecordId rid = page_it.getCurrentRecord();
+                    entry.set(rid, recordKey<T>(keyExtractor, page, rid));
+                    run->push_back(entry);
+                    if (!payload.empty()) {
+                        std::size_t length;
+                        const char *record = page.getRecordBytes(rid, length);
+                        index->extractPayload(record, length, &payload[0]);
+                        payloads->add(rid, &payload[0]);
+                    }
+                }
             }
-            keyArray[i] = currKey;
-            TArray[i+1] = Tvalue;
+            sort(run->begin(), run->end());
+        }
+        catch (...) {
+            *error = std::current_exception();
         }
+    }
 
-        return;
+    //Merges the sorted runs [first, middle) and [middle, last) of entries
+    template<class T>
+    void mergeRuns(vector<RIDKeyPair<T> > *entries, size_t first, size_t middle, size_t last) {
+        inplace_merge(entries->begin() + first, entries->begin() + middle, entries->begin() + last);
     }
 
     /**
-     * isRootPageEmpty: Check if the root is empty
-     * @param rootNode: RootNode pointer
+     * collectSortedEntries: Collect the (key, rid) pairs of all records of the relation in key order.
+     * Each thread sorts the pairs of the pages it took into a run, the runs are then merged pairwise,
+     * the merges of one round on their own threads.
+     * @param relationName -> Relation Name
+     * @param buildThreads -> number of threads, 1 collects and sorts on the calling thread
+     * @param keyExtractor -> reads the key of each record
+     * @param entries -> the sorted pairs
+     * @param payloads -> the payloads of the records, every thread collects those of its pages on its own
      */
-    bool BTreeIndex::isRootPageEmpty(NonLeafNodeInt *rootNode) {
+    template<class T>
+    void BTreeIndex::collectSortedEntries(const std::string &relationName, int buildThreads,
+                                          const KeyExtractor *keyExtractor, vector<RIDKeyPair<T> > &entries,
+                                          RecordPayloads &payloads) {
+        int numThreads = max(1, buildThreads);
+        vector<vector<RIDKeyPair<T> > > runs(numThreads);
+        vector<RecordPayloads> runPayloads(numThreads, RecordPayloads(this->leafPayloadSize));
+        vector<std::exception_ptr> errors(numThreads);
+        {
+            PageFile relation = PageFile::open(relationName);
+            RelationPages pages(relation);
+            if (numThreads == 1) {
+                collectRun<T>(&pages, keyExtractor, this, &runs[0], &payloads, &errors[0]);
+            }
+            else {
+                vector<std::thread> threads;
+                for (int i = 0; i < numThreads; i++) {
+                    threads.push_back(std::thread(collectRun<T>, &pages, keyExtractor, this, &runs[i], &runPayloads[i],
+                                                  &errors[i]));
+                }
+                for (int i = 0; i < numThreads; i++) {
+                    threads[i].join();
+                }
+            }
+        }
+        for (int i = 0; i < numThreads; i++) {
+            if (errors[i]) {
+                std::rethrow_exception(errors[i]);
+            }
+            payloads.merge(runPayloads[i]);
+        }
 
-        if (rootNode->keyArray[0] == INT32_MAX) {
-            return true;
+        //Runs are placed one after the other, bounds[i] is where run i starts
+        size_t total = 0;
+        for (int i = 0; i < numThreads; i++) {
+            total += runs[i].size();
         }
-        else {
-            return false;
+        entries.clear();
+        entries.reserve(total);
+        vector<size_t> bounds(1, 0);
+        for (int i = 0; i < numThreads; i++) {
+            entries.insert(entries.end(), runs[i].begin(), runs[i].end());
+            vector<RIDKeyPair<T> >().swap(runs[i]);
+            bounds.push_back(entries.size());
+        }
+        while (bounds.size() > 2) {
+            vector<size_t> merged(1, 0);
+            vector<std::thread> threads;
+            for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+                threads.push_back(std::thread(mergeRuns<T>, &entries, bounds[i], bounds[i + 1], bounds[i + 2]));
+                merged.push_back(bounds[i + 2]);
+            }
+            if (bounds.size() % 2 == 0) {
+                //Odd number of runs, the last one waits for the next round
+                merged.push_back(bounds.back());
+            }
+            for (size_t i = 0; i < threads.size(); i++) {
+                threads[i].join();
+            }
+            bounds.swap(merged);
         }
     }
 
     /**
-     * insertFirstEntryInRoot: Called when first entry in the root node needs to be inserted
-     * creates a new child page and inserts the key and rid pair in it
-     * @param rootNode -> Root Node pointer
-     * @param currKey -> New key to be inserted into the root
-     * @param Rid -> new rid to be inserted into the new created leage child
+     * buildNonLeafLevel: Packs the given children, sorted by key, into new non-leaf nodes.
+     * The separator between two children is the lowest key of the right child.
+     * @param children -> page number and lowest key of every child, in key order
+     * @param counts -> number of entries under every child, replaced by the number of entries under every new node
+     * @param childrenAreLeaves -> true if the children are leaf nodes
+     * @param fillFactor -> fraction of the slots of each node to fill
      */
-    void BTreeIndex::insertFirstEntryInRoot(NonLeafNodeInt *rootNode, int currKey, const RecordId rid) {
-        //Alocate child node and populate default contents
-        rootNode->keyArray[0] = currKey;
-        Page* firstLeafPage;
-        AllocatePageAndSetDefaultValues(rootNode->pageNoArray[1], firstLeafPage, true);
+    template<class T>
+    vector<PageKeyPair<T> > BTreeIndex::buildNonLeafLevel(const vector<PageKeyPair<T> > &children, vector<int> &counts,
+                                                         bool childrenAreLeaves, double fillFactor) {
+        //At least 3 children per node, so that an even spread never leaves a node with a single child
+        int perNode = max(3, bulkNonLeafChildren(children, fillFactor, this->nonLeafFormat));
+        int numChildren = (int) children.size();
+        int numNodes = (numChildren + perNode - 1) / perNode;
+
+        vector<PageKeyPair<T> > parents;
+        vector<int> parentCounts;
+        int next = 0;
+        for (int node = 0; node < numNodes; node++) {
+            int count = numChildren / numNodes + (node < numChildren % numNodes ? 1 : 0);
+            PageId nodePageNo;
+            Page *nodePage;
+            AllocatePageAndSetDefaultValues<T>(nodePageNo, nodePage, false);
+            NonLeafNode<T> *nonLeafNode = (NonLeafNode<T> *) nodePage;
+            nonLeafNode->level = childrenAreLeaves ? 1 : 0;
+            setChild(nonLeafNode, 0, children[next].pageNo);
+            setCount(nonLeafNode, 0, counts[next]);
+            for (int i = 1; i < count; i++) {
+                insertAt(nonLeafNode, i - 1, children[next + i].key, children[next + i].pageNo, counts[next + i]);
+            }
+            parentCounts.push_back(nodeEntryCount(nonLeafNode));
+            this->bufMgr->unPinPage(this->file, nodePageNo, true);
 
+            PageKeyPair<T> parent;
+            parent.set(nodePageNo, children[next].key);
+            parents.push_back(parent);
+            next += count;
+        }
+        counts.swap(parentCounts);
+        return parents;
+    }
+
+    /**
+     * shiftAndInsert: Find the position of the key in the leaf and insert the key there,
+     * shifting the keys after it
+     * @param node -> leaf node, which has room for the key
+     * @param key -> the key to be inserted
+     * @param value -> rid of the key
+     * @param payload -> included attributes of the entry
+     */
+    template <class N, class K, class V>
+    void shiftAndInsert(N *node, const K &key, const V &value, const char *payload) {
+        insertAt(node, nodeLowerBound(node, key), key, value, payload);
+    }
 
-        LeafNodeInt* newLeafNode = (LeafNodeInt*) firstLeafPage;
-        newLeafNode->keyArray[0] = currKey;
-        newLeafNode->ridArray[0] = rid;
-        this->bufMgr->unPinPage(this->file, rootNode->pageNoArray[1], true);
-        return;
+    /**
+     * setLeftSibling: Sets the left sibling of a leaf that is not pinned by the caller
+     * @param pageNo -> page number of the leaf
+     * @param leftSibPageNo -> page number of its new left sibling
+     */
+    template<class T>
+    void BTreeIndex::setLeftSibling(PageId pageNo, PageId leftSibPageNo) {
+        Page *page;
+        this->bufMgr->readPage(this->file, pageNo, page);
+        ((LeafNode<T> *) page)->leftSibPageNo = leftSibPageNo;
+        this->bufMgr->unPinPage(this->file, pageNo, true);
     }
 
     /**
@@ -550,66 +4492,109 @@ namespace badgerdb {
     }
 
     /**
-     * isNodeFull: Check if the given node which is either leaf or non leaf is full
-     * @param node -> leaf or nonleaf Node
-     * @param size -> size of the key array
-     */
-    template<typename T>
-    bool BTreeIndex::isNodeFull(T *node, int size) {
-        if (node->keyArray[size-1] != INT32_MAX) {
-            return true;
-        }
-        else {
-            return false;
-        }
-    }
-
-    /**
-     * copyAndSet: Overloaded function which copies half the contents of the currentNode (which is leafNode in this function)
-     * which is being split into the newLeafNode
+     * copyAndSet: Overloaded function which moves the last size keys of the currentNode (which is leafNode in this function)
+     * which is being split into the empty newLeafNode
      * @param newLeafNode -> newLeafNode pointer
      * @param currentNode -> currentNode pointer which is being split
      * @param start-> start point form where the contents need to be copied
-     * @param size-> end point till where contents need to be copied
+     * @param size-> number of keys to copy, up to the end of currentNode
      */
     //for leaf node
-    void BTreeIndex::copyAndSet(LeafNodeInt* newLeafNode, LeafNodeInt* currentNode, int start, int size)
+    template<class T>
+    void BTreeIndex::copyAndSet(LeafNode<T>* newLeafNode, LeafNode<T>* currentNode, int start, int size)
     {
-        int copyKeySize = size* sizeof(int);
-        int copyRidSize = size* sizeof(RecordId);
-        memcpy((void *) &newLeafNode->keyArray[0], (void *) &currentNode->keyArray[start],
+        int copyKeySize = size* sizeof(T);
+        int copyRidSize = size* sizeof(LeafRecordId);
+        int payloadSize = currentNode->header.payloadSize;
+        memcpy((void *) &newLeafNode->keys()[0], (void *) &currentNode->keys()[start],
                copyKeySize);
-        memcpy((void *) &newLeafNode->ridArray[0], (void *) &currentNode->ridArray[start],
+        memcpy((void *) &newLeafNode->rids()[0], (void *) &currentNode->rids()[start],
                copyRidSize);
-        for (int i = 0; i< size; i++) {
-            currentNode->keyArray[i+start] = INT32_MAX;
-            currentNode->ridArray[i+start].page_number = UINT32_MAX;
-            currentNode->ridArray[i+start].slot_number = UINT16_MAX;
-        }
+        memcpy((void *) newLeafNode->payloads(), (void *) payloadAt(currentNode, start), size * payloadSize);
+        newLeafNode->header.keyCount = size;
+        currentNode->header.keyCount = start;
     }
 
     /**
-     * copyAndSet: Overloaded function which copies half the contents of the currentNode(NonLeafNode in this case)
-     * which is being split into the newLeafNode
+     * copyAndSet: Overloaded function which moves the last size keys of the currentNode(NonLeafNode in this case),
+     * together with the child page left of each of them and the last child page and their entry counts, into the empty newNonLeafNode
      * @param newLeafNode -> newLeafNode pointer
      * @param currentNode -> currentNode pointer which is being split
      * @param start-> start point form where the contents need to be copied
-     * @param size-> end point till where contents need to be copied
+     * @param size-> number of keys to copy, up to the end of currentNode
      */
     //For non-leaf node
-    void BTreeIndex::copyAndSet(NonLeafNodeInt* newNonLeafNode, NonLeafNodeInt* currentNode, int start, int size)
+    template<class T>
+    void BTreeIndex::copyAndSet(NonLeafNode<T>* newNonLeafNode, NonLeafNode<T>* currentNode, int start, int size)
     {
-        int copyKeySize = size* sizeof(int);
+        int copyKeySize = size* sizeof(T);
         int copyPageIdSize = size* sizeof(PageId);
-        memcpy((void *) &newNonLeafNode->keyArray[0], (void *) &currentNode->keyArray[start],
+        memcpy((void *) &newNonLeafNode->keys()[0], (void *) &currentNode->keys()[start],
                copyKeySize);
-        memcpy((void *) &newNonLeafNode->pageNoArray[0], (void *) &currentNode->pageNoArray[start],
+        memcpy((void *) &newNonLeafNode->pageNos()[0], (void *) &currentNode->pageNos()[start],
                copyPageIdSize + sizeof(PageId));
-        for (int i = 0; i< size; i++) {
-            currentNode->keyArray[i + start] = INT32_MAX;
-            currentNode->pageNoArray[i + start + 1] = UINT32_MAX;
+        if (hasCounts(currentNode)) {
+            memcpy((void *) &newNonLeafNode->counts()[0], (void *) &currentNode->counts()[start],
+                   (size + 1) * sizeof(int));
+        }
+        newNonLeafNode->header.keyCount = size;
+        currentNode->header.keyCount = start;
+        updateDirectory(newNonLeafNode, 0);
+        updateDirectory(currentNode, start);
+    }
+
+    /**
+     * copySlots: Copies the last size slots of a STRING node, starting at start, together with their key bytes
+     * into the empty newNode. The keys stay in currentNode, the caller truncates it.
+     */
+    template<class N>
+    void copySlots(N *newNode, const N *currentNode, int start, int size) {
+        for (int i = 0; i < size; i++) {
+            int length = currentNode->slot(start + i).keyLength;
+            newNode->keyBytesStart -= length;
+            memcpy((char *) newNode + newNode->keyBytesStart,
+                   keyBytes(currentNode, currentNode->slot(start + i).keyOffset), length);
+            memcpy(&newNode->slot(i), &currentNode->slot(start + i), currentNode->slotSize());
+            newNode->slot(i).keyOffset = newNode->keyBytesStart;
+        }
+        newNode->header.keyCount = size;
+    }
+
+    //copyAndSet for STRING nodes
+    void BTreeIndex::copyAndSet(LeafNodeString* newLeafNode, LeafNodeString* currentNode, int start, int size)
+    {
+        copySlots(newLeafNode, currentNode, start, size);
+        truncateNode(currentNode, start);
+    }
+
+    void BTreeIndex::copyAndSet(NonLeafNodeString* newNonLeafNode, NonLeafNodeString* currentNode, int start, int size)
+    {
+        copySlots(newNonLeafNode, currentNode, start, size);
+        setChild(newNonLeafNode, 0, childAt(currentNode, start));
+        setCount(newNonLeafNode, 0, countAt(currentNode, start));
+        truncateNode(currentNode, start);
+    }
+
+    //copyAndSet for INTEGER leaves, a packed leaf is split by packing both halves again in the widths they need.
+    //The lists of a posting leaf move with their overflow pages
+    void BTreeIndex::copyAndSet(LeafNodeInt* newLeafNode, LeafNodeInt* currentNode, int start, int size)
+    {
+        if (isPostings(currentNode)) {
+            for (int j = start; j < start + size; j++) {
+                insertAt(newLeafNode, j - start, keyAt(currentNode, j), ridAt(currentNode, j), payloadAt(currentNode, j));
+            }
+            truncateNode(currentNode, start);
+            return;
+        }
+        if (!isPacked(currentNode)) {
+            this->copyAndSet<int>(newLeafNode, currentNode, start, size);
+            return;
         }
-        //currentNode->pageNoArray[INTARRAYNONLEAFSIZE] = UINT32_MAX;
+        vector<int> keys;
+        vector<RecordId> rids;
+        unpackEntries(packedLeaf(currentNode), keys, rids);
+        packEntries(packedLeaf(newLeafNode), keys.data() + start, rids.data() + start, size);
+        packEntries(packedLeaf(currentNode), keys.data(), rids.data(), start);
     }
 
     /**
@@ -619,219 +4604,97 @@ namespace badgerdb {
      * @param currentNode -> Leaf Node which is being split
      * @param r -> Record id of the new key which cause the node to split
      * @param k -> new key which cause the split to occur and needs to be inserted
+     * @param payload -> included attributes of the new entry
+     * @param append -> true if currentNode is the right-most leaf and split policy is SPLIT_APPEND. Then a k past the last key
+     *                  goes alone into newLeafNode
      */
-    int BTreeIndex::splitLeafNodeInTwo(LeafNodeInt* newLeafNode, LeafNodeInt* currentNode, RecordId r, int k)
+    template<class T>
+    T BTreeIndex::splitLeafNodeInTwo(LeafNode<T>* newLeafNode, LeafNode<T>* currentNode, RecordId r, T k,
+                                     const char *payload, bool append, bool &inserted)
     {
-        int i = 0;
-        while (currentNode->keyArray[i] < k && i < INTARRAYLEAFSIZE) {
-            i++;
-        }
+        //Node is full, it has no room for k
+        const int leafSize = currentNode->header.keyCount;
+        inserted = true;
+        int i = nodeLowerBound(currentNode, k);
         //i = new position
-        if (i<INTARRAYLEAFSIZE/2) {
-            int start = floor(INTARRAYLEAFSIZE/2.0);
-            this->copyAndSet(newLeafNode,currentNode, start, INTARRAYLEAFSIZE - start );
-            shiftAndInsert(currentNode->keyArray, currentNode->ridArray, k, r, INTARRAYLEAFSIZE, INTARRAYLEAFSIZE);
-
+        if (append && i == leafSize) {
+            shiftAndInsert(newLeafNode, k, r, payload);
+            return keyAt(newLeafNode, 0);
         }
-        else{
-            int start = ceil(INTARRAYLEAFSIZE/2.0);
-            this->copyAndSet(newLeafNode,currentNode, start , INTARRAYLEAFSIZE - start);
-            shiftAndInsert(newLeafNode->keyArray, newLeafNode->ridArray, k, r, INTARRAYLEAFSIZE, INTARRAYLEAFSIZE);
+        //Keys [start, leafSize) move to the new leaf. The new key goes to the side its position is on,
+        //with an odd leafSize position leafSize/2 is still left of start
+        int start = i < leafSize / 2 ? leafSize / 2 : (leafSize + 1) / 2;
+        //A posting leaf is split between two lists
+        start = listBoundary(currentNode, start);
+        this->copyAndSet(newLeafNode, currentNode, start, leafSize - start);
+        //Each half of a packed leaf fits into the page, but with k its entries may need wider fields than fit
+        LeafNode<T> *side = i < start ? currentNode : newLeafNode;
+        if (hasRoomFor(side, k, r)) {
+            shiftAndInsert(side, k, r, payload);
+        }
+        else {
+            inserted = false;
         }
-        return newLeafNode->keyArray[0];
+        return keyAt(newLeafNode, 0);
     }
 
     /**
      * splitLeafNodeInTwo: split given nonLeaf node(CurrentNode) by using the newNonLeafNode pointer which is passed
      * and insert the key and rid pair in the appropriate position
+     * The middle key moves up to the parent, the returned key is not kept in either node.
      * @param newLeafNode -> New Leaf Node
      * @param currentNode -> Leaf Node which is being split
      * @param key -> new key which cause the split to occur and needs to be inserted
      * @param pageId -> Page id of the new key which cause the node to split
+     * @param entryCount -> number of entries in the subtree of pageId
+     * @param append -> true if currentNode is the right-most node of its level and split policy is SPLIT_APPEND.
+     *                  Then a key past the last key moves up, and pageId becomes the only child of newNonLeafNode
      */
-    int BTreeIndex::splitNonLeafNode(NonLeafNodeInt* newNonLeafNode, NonLeafNodeInt* currentNode, int key, PageId pageId){
-        int i = 0;
-        while (currentNode->keyArray[i] < key && i< INTARRAYNONLEAFSIZE) {
-            i++;
-        }
+    template<class T>
+    T BTreeIndex::splitNonLeafNode(NonLeafNode<T>* newNonLeafNode, NonLeafNode<T>* currentNode, T key, PageId pageId,
+                                   int entryCount, bool append){
+        const int nonLeafSize = currentNode->header.keyCount;
+        const int mid = nonLeafSize/2;
+        int i = nodeLowerBound(currentNode, key);
         //Copy the level
         newNonLeafNode->level = currentNode->level;
         //i = Position to insert
-        if (i == INTARRAYNONLEAFSIZE/2) {
-            //Do not insert, same key should be returned back
-            this->copyAndSet(newNonLeafNode, currentNode, INTARRAYNONLEAFSIZE/2, INTARRAYNONLEAFSIZE - INTARRAYNONLEAFSIZE/2);
-            newNonLeafNode->pageNoArray[0] = pageId;
+        if (append && i == nonLeafSize) {
+            //Nothing moves, the key goes up and pageId is the only child of the new node
+            this->copyAndSet(newNonLeafNode, currentNode, nonLeafSize, 0);
+            setChild(newNonLeafNode, 0, pageId);
+            setCount(newNonLeafNode, 0, entryCount);
             return key;
         }
-        if (i < INTARRAYNONLEAFSIZE/2) {
-
-            this->copyAndSet(newNonLeafNode, currentNode, INTARRAYNONLEAFSIZE/2, INTARRAYNONLEAFSIZE - INTARRAYNONLEAFSIZE/2);
-
-            shiftAndInsert(currentNode->keyArray, currentNode->pageNoArray,
-                           key, pageId, INTARRAYNONLEAFSIZE, INTARRAYNONLEAFSIZE+1);
-            int newkey = currentNode->keyArray[INTARRAYNONLEAFSIZE/2 ];
-            currentNode->keyArray[INTARRAYNONLEAFSIZE/2 ] = INT32_MAX;
+        if (i == mid) {
+            //Do not insert, same key should be returned back. pageId becomes the first child of the new node
+            this->copyAndSet(newNonLeafNode, currentNode, mid, nonLeafSize - mid);
+            setChild(newNonLeafNode, 0, pageId);
+            setCount(newNonLeafNode, 0, entryCount);
+            return key;
+        }
+        if (i < mid) {
+            //Key mid - 1 moves up, its right child (child mid) is copied as the first child of the new node
+            this->copyAndSet(newNonLeafNode, currentNode, mid, nonLeafSize - mid);
+            T newkey = keyAt(currentNode, mid - 1);
+            truncateNode(currentNode, mid - 1);
 
-            currentNode->pageNoArray[INTARRAYNONLEAFSIZE/2 ] = pageId;
-            //newnode has the pointer set as pageNoArray was split into two
+            insertAt(currentNode, nodeLowerBound(currentNode, key), key, pageId, entryCount);
             return newkey;
         }
         else{
-            this->copyAndSet(newNonLeafNode, currentNode, INTARRAYNONLEAFSIZE/2 , INTARRAYNONLEAFSIZE - INTARRAYNONLEAFSIZE/2);
-            shiftAndInsert(newNonLeafNode->keyArray, newNonLeafNode->pageNoArray,
-                           key, pageId, INTARRAYNONLEAFSIZE, INTARRAYNONLEAFSIZE+1);
-            int newkey = newNonLeafNode->keyArray[0];
-            int counter;
-            for(counter=0; counter<INTARRAYNONLEAFSIZE-1; counter++){
-                newNonLeafNode->keyArray[counter] = newNonLeafNode->keyArray[counter+1];
-                newNonLeafNode->pageNoArray[counter] = newNonLeafNode->pageNoArray[counter+1];
-                //Check everywhere but not here for segFault
-            }
-
-            newNonLeafNode->pageNoArray[counter] = UINT32_MAX;
-            return newkey;
+            //Key mid moves up, the keys right of it go to the new node
+            this->copyAndSet(newNonLeafNode, currentNode, mid + 1, nonLeafSize - mid - 1);
+            T newkey = keyAt(currentNode, mid);
+            truncateNode(currentNode, mid);
 
+            insertAt(newNonLeafNode, nodeLowerBound(newNonLeafNode, key), key, pageId, entryCount);
+            return newkey;
         }
     }
 
-    /**
-     * findPageAndInsert: Find the Page where the new key and the rid pair needs to be inserted into the Btree
-     * @param currPageId ->Page ID to start searching from, which can be leaf or nonLeafNode
-     * @param key -> key which needs to be inserted
-     * @param rid -> rid related to the key which is passed
-     * @param isLeafNode -> true incase of the leaf node or else false
-     */
-    pair<int, PageId> BTreeIndex::findPageAndInsert(PageId currPageId, const void *key, const RecordId rid, bool isLeafNode) {
-        int currentKey = *(int *) key;
-
-        Page *currPage;
-        this->bufMgr->readPage(this->file, currPageId, currPage);
-
-        if (!isLeafNode) {
-            NonLeafNodeInt *currentNode = (NonLeafNodeInt *) currPage;
-            //Nonleaf node---------------------------------------------------------------
-            //Check if root page and empty , insert in root nad leaf
-            if (currPageId == this->rootPageNum) {
-                int isRootEmpty = this->isRootPageEmpty(currentNode);
-
-                if (isRootEmpty) {
-                    this->insertFirstEntryInRoot(currentNode, currentKey, rid);
-                    this->bufMgr->unPinPage(this->file, currPageId, true);
-                    return pair<int, PageId>(-1, UINT32_MAX);
-                }
-            }
-            // Find the child node index and navigate to the child through recursion
-            int i = 0;
-            while (currentNode->keyArray[i] < currentKey && i<INTARRAYNONLEAFSIZE) {
-                i++;
-            }
-            // i is the pagenumber where it should go!
-            // Note: i = INTARRAYNONLEAFSIZE in worst case, and it is okay to access pageNoArray[INTARRAYNONLEAFSIZE]
-            if (currentNode->pageNoArray[i] == UINT32_MAX) {
-                //Child page doesn't exist, create it
-                assert(currentNode->level == 1);//Just below current Node are the leaf Nodes
-                int counter = i;
-                Page* newLeafPage;
-                AllocatePageAndSetDefaultValues(currentNode->pageNoArray[i], newLeafPage, true);
-
-                int rightpageID = currentNode->pageNoArray[i];
-                if( counter != 0) {
-                    counter--;//finding left sibling
-                    if(currentNode->pageNoArray[counter] ==UINT32_MAX){
-                        assert(0);
-                    }
-                    else{
-                        //left sibling present, yay!!!
-                        Page* leftChildPage;
-                        this->bufMgr->readPage(this->file, currentNode->pageNoArray[counter], leftChildPage);
-                        LeafNodeInt *leftchild = (LeafNodeInt *) leftChildPage;
-                        //Swapping siblingPageIDs
-                        PageId currentRightSibling = leftchild->rightSibPageNo;
-                        leftchild->rightSibPageNo = rightpageID;
-
-                        LeafNodeInt* justCreatedLeaf = (LeafNodeInt*) newLeafPage;
-                        justCreatedLeaf->rightSibPageNo = currentRightSibling;
-                        this->bufMgr->unPinPage(this->file, currentNode->pageNoArray[i], true);
-                        this->bufMgr->unPinPage(this->file, currentNode->pageNoArray[counter], true);
-                    }
-                }
-                else if (counter == 0) {
-                    //Left leaf child allocated for the 1st time
-                    assert(currentNode->pageNoArray[1] != UINT32_MAX );
-                    LeafNodeInt justCreatedLeaf;
-                    justCreatedLeaf.rightSibPageNo = currentNode->pageNoArray[1];
-                    this->bufMgr->unPinPage(this->file, currentNode->pageNoArray[0], true);
-                }
-
-            }
-            pair<int, PageId> childReturn = this->findPageAndInsert(currentNode->pageNoArray[i], key, rid, currentNode->level);
-
-            //Check return type , if -1,UINT32_MAX then return
-            if (childReturn.first == -1 && childReturn.second == UINT32_MAX) {
-                //Unpin before returning
-                //Possiblity of pinCount Mismatch
-                this->bufMgr->unPinPage(this->file, currPageId, true);
-                return pair<int, PageId>(-1, UINT32_MAX);
-            }
-                //Else Child node was split, copy the key to current node
-            else {
-                int isFull = this->isNodeFull(currentNode, INTARRAYNONLEAFSIZE);
-
-                if(isFull){
-                    //If no space in current node split the current node and push up
-                    PageId newPageId;
-                    Page* newPage;
-                    //this->allocatePageAndUpdateMap(newPageId, 1);
-
-                    AllocatePageAndSetDefaultValues(newPageId, newPage, false);
-
-                    NonLeafNodeInt* newNonLeafNode = (NonLeafNodeInt*) newPage;
-                    int newKey = this->splitNonLeafNode(newNonLeafNode, currentNode, childReturn.first, childReturn.second);
-                    this->bufMgr->unPinPage(this->file, newPageId, true);
-                    this->bufMgr->unPinPage(this->file, currPageId, true);
-                    return pair<int, PageId > (newKey, newPageId);
-                }
-                else{
-                    //Else insert
-                    shiftAndInsert(currentNode->keyArray, currentNode->pageNoArray, childReturn.first, childReturn.second, INTARRAYNONLEAFSIZE, INTARRAYNONLEAFSIZE+1);
-
-                    this->bufMgr->unPinPage(this->file, currPageId, true);
-                    return pair<int, PageId>(-1, UINT32_MAX);
-                }
-            }
-        }
-        else {
-            //Leaf node
-            LeafNodeInt *currentNode = (LeafNodeInt *) currPage;
-
-            if (currentNode->keyArray[INTARRAYLEAFSIZE - 1] != INT32_MAX) {
-                //Split and copy up, no space in leaf
-                PageId newLeafPageID;
-                Page* newLeafPage;
-                AllocatePageAndSetDefaultValues(newLeafPageID, newLeafPage, true);
-
-                LeafNodeInt* newLeafNode = (LeafNodeInt*) newLeafPage;
-
-                //Split the node contents to a new page
-                int newKey = this->splitLeafNodeInTwo(newLeafNode, currentNode, rid, currentKey);
-                PageId currentSiblingPageId = currentNode->rightSibPageNo;
-
-                //Swapping siblingPageIDs
-
-                currentNode->rightSibPageNo = newLeafPageID;
-                newLeafNode->rightSibPageNo = currentSiblingPageId;
-                //Typecast to string and write the new page
-                this->bufMgr->unPinPage(this->file, newLeafPageID, true);
-                this->bufMgr->unPinPage(this->file, currPageId, true);
-                return pair<int, PageId>(newKey, newLeafPageID);
-            }
-            else {
-                //Find where to insert, and shift
-                shiftAndInsert(&currentNode->keyArray[0], &currentNode->ridArray[0], currentKey, rid,
-                               INTARRAYLEAFSIZE, INTARRAYLEAFSIZE);
-                this->bufMgr->unPinPage(this->file, currPageId, true);
-                return pair<int, PageId>(-1, UINT32_MAX);
-            }
-        }
-    }
-}
\ No newline at end of file
+    //Instantiations of the public templates, for the key types of INTEGER, DOUBLE and STRING indexes
+    template void BTreeIndex::print<int>(const PageId, int, int);
+    template void BTreeIndex::print<double>(const PageId, int, int);
+    template void BTreeIndex::print<string>(const PageId, int, int);
+}
@@ -7,17 +7,21 @@
 
 #pragma once
 
+#include <cstddef>
 #include <iostream>
 #include <string>
 #include "string.h"
 #include <sstream>
 #include <utility>
+#include <vector>
+#include <unordered_map>
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
+#include "node_search.h"
 
 namespace badgerdb {
 
@@ -40,18 +44,219 @@ namespace badgerdb {
                 GT        /* Greater Than */
     };
 
+/**
+ * @brief Order in which a scan returns the entries of its range. Passed to BTreeIndex::startScan() method.
+ */
+    enum ScanOrder {
+        ASCENDING, /* From the low value up */
+        DESCENDING /* From the high value down */
+    };
+
+/**
+ * @brief How an insert splits a full node. Set for each index through IndexOptions::splitPolicy.
+ */
+    enum SplitPolicy {
+        SPLIT_EVEN,  /* Half of the keys move to the new node */
+        SPLIT_APPEND /* A key past the end of the right-most node of its level goes alone into the new node,
+                        the full node stays full. Indexes whose keys only grow end up with full nodes */
+    };
+
+
+/**
+ * @brief Kind of node stored in an index page. Every leaf and non-leaf page starts with it, so the
+ * kind of a page can be checked before it is cast to a node structure.
+ */
+    enum NodeType {
+        LEAF_NODE = 1,
+        NON_LEAF_NODE = 2,
+        FREE_NODE = 3,
+        OVERFLOW_NODE = 4
+    };
+
+/**
+ * @brief Layout of non-leaf nodes, set for each index through IndexOptions::lineDirectory and
+ * IndexOptions::subtreeCounts. Stored in the header of every non-leaf node, see NonLeafLayout.
+ * A format is NONLEAF_SORTED or NONLEAF_LINE_DIRECTORY, plus NONLEAF_COUNTS if the index keeps subtree counts.
+ * STRING non-leaf nodes are always NONLEAF_SORTED.
+ */
+    enum NonLeafFormat {
+        NONLEAF_SORTED = 0,         /* Keys in one sorted array, searched by binary search */
+        NONLEAF_LINE_DIRECTORY = 1, /* Keys in cache line blocks, searched through a directory of the block maxima */
+        NONLEAF_COUNTS = 2          /* Flag: each child also has the number of entries in its subtree */
+    };
+
+/**
+ * @brief Layout of leaves, set for each index through IndexOptions::packedLeaves and IndexOptions::postingLists.
+ * Stored in the header of every leaf.
+ */
+    enum LeafFormat {
+        LEAF_ARRAYS = 0,  /* Keys, RecordIds and payloads in arrays of fixed size entries, see LeafNode */
+        LEAF_PACKED = 1,  /* INTEGER only: keys and RecordIds bit-packed as differences from a base, see PackedLeafNode */
+        LEAF_POSTINGS = 2 /* INTEGER only: every key once with the sorted list of its RecordIds, see PostingLeafNode */
+    };
+
+/**
+ * @brief Header at the start of every leaf and non-leaf node page.
+ */
+    struct NodeHeader {
+        /**
+         * Kind of the node, a NodeType.
+         */
+        std::uint8_t nodeType;
+
+        /**
+         * Layout of the rest of the page, a NonLeafFormat in the non-leaf nodes of INTEGER and DOUBLE indexes,
+         * a LeafFormat in leaves, else 0. Every node of an index has the format the index was created with.
+         */
+        std::uint8_t format;
+
+        /**
+         * Bytes of included attributes stored with each entry of a leaf, the payload size of the index. 0 in non-leaf nodes.
+         */
+        std::uint16_t payloadSize;
+
+        /**
+         * Number of occupied key slots. They are always the first keyCount slots of the key array,
+         * the slots after them are never read, so they are left uninitialized.
+         */
+        int keyCount;
+    };
+
+/**
+ * @brief Page of the index file that no node uses anymore. Freed pages form a list starting at
+ * IndexMetaInfo::freePageNo and are reused before the file grows.
+ */
+    struct FreePage {
+        /**
+         * Node type FREE_NODE, keyCount is unused.
+         */
+        NodeHeader header;
+
+        /**
+         * Next page of the list, UINT32_MAX if this is the last one.
+         */
+        PageId nextFreePageNo;
+    };
+
+/**
+ * @brief RecordId as stored in leaves. RecordId pads its 2 byte slot number to 8 bytes, here the page number
+ * is split in two 16 bit halves so the 3 fields take 6 bytes, and leaves hold more entries.
+ */
+    struct LeafRecordId {
+        std::uint16_t pageLow;
+        std::uint16_t pageHigh;
+        SlotId slot;
+
+        LeafRecordId &operator=(const RecordId &rid) {
+            pageLow = (std::uint16_t) rid.page_number;
+            pageHigh = (std::uint16_t) (rid.page_number >> 16);
+            slot = rid.slot_number;
+            return *this;
+        }
+
+        operator RecordId() const {
+            RecordId rid;
+            rid.page_number = ((PageId) pageHigh << 16) | pageLow;
+            rid.slot_number = slot;
+            return rid;
+        }
+    };
+
+/**
+ * @brief Placement of the parts of an INTEGER or DOUBLE non-leaf node in its page for one NonLeafFormat,
+ * offsets in bytes from the start of the page. The header and the level come first, then the keys,
+ * the page numbers of the children and the number of entries under each child.
+ * The counts are only there with NONLEAF_COUNTS. NONLEAF_SORTED keys follow the level. NONLEAF_LINE_DIRECTORY keys start on a cache line and are sized to
+ * whole lines. The largest key of each group of KEYS_PER_LINE lines follows the level, and the largest key
+ * of each line is in the lines before the keys, see searchKeyLines.
+ */
+    template<class T, int Format>
+    struct NonLeafFormatLayout {
+        static const bool DIRECTORY = (Format & NONLEAF_LINE_DIRECTORY) != 0;
+        static const bool COUNTS = (Format & NONLEAF_COUNTS) != 0;
+        static const int B = KeyLines<T>::KEYS_PER_LINE;
+        //Page number and, with NONLEAF_COUNTS, entry count of a child
+        static const int CHILD_BYTES = sizeof(PageId) + (COUNTS ? sizeof(int) : 0);
+        //First byte after the header and the level, aligned for a key
+        static const int FIRST = (sizeof(NodeHeader) + sizeof(int) + sizeof(T) - 1) / sizeof(T) * sizeof(T);
+        //With the directory: the header line, about one key per line in the directory and up to 2 lines of padding
+        static const int SIZE = DIRECTORY
+                                ? (Page::SIZE - 3 * CACHE_LINE_SIZE - CHILD_BYTES) * B / ((sizeof(T) + CHILD_BYTES) * B + sizeof(T))
+                                : (Page::SIZE - FIRST - CHILD_BYTES) / (sizeof(T) + CHILD_BYTES);
+        static const int LINES = (SIZE + B - 1) / B;
+        static const int GROUPS = (LINES + B - 1) / B;
+        static const int GROUP_MAX_OFFSET = FIRST;
+        static const int LINE_MAX_OFFSET = (FIRST + GROUPS * sizeof(T) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+        static const int KEY_OFFSET = DIRECTORY ? LINE_MAX_OFFSET + GROUPS * B * sizeof(T) : FIRST;
+        static const int PAGE_NO_OFFSET = KEY_OFFSET + (DIRECTORY ? LINES * B : SIZE) * sizeof(T);
+        static const int COUNT_OFFSET = PAGE_NO_OFFSET + (SIZE + 1) * sizeof(PageId);
+
+        static_assert(COUNT_OFFSET + (COUNTS ? SIZE + 1 : 0) * sizeof(int) <= Page::SIZE, "non-leaf nodes must fit in a page");
+    };
+
+/**
+ * @brief NonLeafFormatLayout of one format, looked up at run time from the format in the node header.
+ */
+    struct NonLeafLayout {
+        int size;
+        int groupMaxOffset;
+        int lineMaxOffset;
+        int keyOffset;
+        int pageNoOffset;
+        int countOffset;
+    };
+
+    template<class T, int Format>
+    constexpr NonLeafLayout nonLeafLayoutOf() {
+        typedef NonLeafFormatLayout<T, Format> L;
+        return {L::SIZE, L::GROUP_MAX_OFFSET, L::LINE_MAX_OFFSET, L::KEY_OFFSET, L::PAGE_NO_OFFSET, L::COUNT_OFFSET};
+    }
+
+/**
+ * @brief NonLeafLayout of every NonLeafFormat, indexed by the format.
+ */
+    template<class T>
+    struct NonLeafLayouts {
+        static const NonLeafLayout FORMATS[4];
+    };
+
+    template<class T>
+    const NonLeafLayout NonLeafLayouts<T>::FORMATS[4] = {nonLeafLayoutOf<T, NONLEAF_SORTED>(),
+                                                         nonLeafLayoutOf<T, NONLEAF_LINE_DIRECTORY>(),
+                                                         nonLeafLayoutOf<T, NONLEAF_SORTED | NONLEAF_COUNTS>(),
+                                                         nonLeafLayoutOf<T, NONLEAF_LINE_DIRECTORY | NONLEAF_COUNTS>()};
+
+/**
+ * @brief Number of key slots in B+Tree leaf and non-leaf nodes for keys of type T, fixed at compile time.
+ * LEAF_SIZE is the fanout of leaves without included attributes,
+ * NONLEAF_SIZE is the fanout of the default NONLEAF_SORTED format.
+ */
+    template<class T>
+    struct NodeFanout {
+//                                                   header                 sibling ptrs                key             rid
+        static const int LEAF_SIZE = (Page::SIZE - sizeof(NodeHeader) - 2 * sizeof(PageId)) / (sizeof(T) + sizeof(LeafRecordId));
+        static const int NONLEAF_SIZE = NonLeafFormatLayout<T, NONLEAF_SORTED>::SIZE;
+    };
 
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-//                                                  sibling ptr             key               rid
-    const int INTARRAYLEAFSIZE = (Page::SIZE - sizeof(PageId)) / (sizeof(int) + sizeof(RecordId));
+    const int INTARRAYLEAFSIZE = NodeFanout<int>::LEAF_SIZE;
 
 /**
  * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
  */
-//                                                     level     extra pageNo                  key       pageNo
-    const int INTARRAYNONLEAFSIZE = (Page::SIZE - sizeof(int) - sizeof(PageId)) / (sizeof(int) + sizeof(PageId));
+    const int INTARRAYNONLEAFSIZE = NodeFanout<int>::NONLEAF_SIZE;
+
+/**
+ * @brief Number of key slots in B+Tree leaf for DOUBLE key.
+ */
+    const int DOUBLEARRAYLEAFSIZE = NodeFanout<double>::LEAF_SIZE;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for DOUBLE key.
+ */
+    const int DOUBLEARRAYNONLEAFSIZE = NodeFanout<double>::NONLEAF_SIZE;
 
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that
@@ -79,169 +284,1275 @@ namespace badgerdb {
         PageId pageNo;
         T key;
 
-        void set(int p, T k) {
-            pageNo = p;
-            key = k;
-        }
-    };
+        void set(int p, T k) {
+            pageNo = p;
+            key = k;
+        }
+    };
+
+/**
+ * @brief Overloaded operator to compare the key values of two rid-key pairs
+ * and if they are the same compares to see if the first pair has
+ * a smaller rid.pageNo value.
+*/
+    template<class T>
+    bool operator<(const RIDKeyPair<T> &r1, const RIDKeyPair<T> &r2) {
+        if (r1.key != r2.key)
+            return r1.key < r2.key;
+        else
+            return r1.rid.page_number < r2.rid.page_number;
+    }
+
+/**
+ * @brief Bytes of a record copied into the leaves next to the key of its entry, see IndexOptions::includes.
+ */
+    struct IncludedAttribute {
+        /**
+         * Offset of the first byte inside the record.
+         */
+        int offset;
+
+        /**
+         * Number of bytes.
+         */
+        int length;
+    };
+
+/**
+ * @brief Maximum number of included attributes of an index.
+ */
+    const int MAXINCLUDEDATTRIBUTES = 8;
+
+/**
+ * @brief Maximum payload size, the total length of the included attributes of an index.
+ * An INTEGER leaf then still holds 30 entries.
+ */
+    const int MAXPAYLOADSIZE = 256;
+
+/**
+ * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
+ * to the following structure to store or retrieve information from it.
+ * Contains the relation name for which the index is created, the byte offset
+ * of the key value on which the index is made, the type of the key and the page no
+ * of the root page. Root page starts as page 2 but since a split can occur
+ * at the root the root page may get moved up and get a new page no.
+*/
+    struct IndexMetaInfo {
+        /**
+         * Name of base relation.
+         */
+        char relationName[20];
+
+        /**
+         * Offset of attribute, over which index is built, inside the record stored in pages.
+         */
+        int attrByteOffset;
+
+        /**
+         * Type of the attribute over which index is built.
+         */
+        Datatype attrType;
+
+        /**
+         * Page number of root page of the B+ Tree inside the file index file.
+         */
+        PageId rootPageNo;
+
+        /**
+         * First page of the list of freed pages, UINT32_MAX if it is empty.
+         */
+        PageId freePageNo;
+
+        /**
+         * Format of the non-leaf nodes, a NonLeafFormat.
+         */
+        int nonLeafFormat;
+
+        /**
+         * Format of the leaves, a LeafFormat.
+         */
+        int leafFormat;
+
+        /**
+         * Number of included attributes.
+         */
+        int includeCount;
+
+        /**
+         * Included attributes, the first includeCount are used.
+         */
+        IncludedAttribute includes[MAXINCLUDEDATTRIBUTES];
+    };
+
+/**
+ * @brief Reads the key of a record of the base relation while the index is constructed.
+ * Called on the threads of a parallel bulk load as well, so extractKey must not change shared state.
+*/
+    class KeyExtractor {
+    public:
+        virtual ~KeyExtractor() {}
+
+        /**
+           * Write the key of the record to key, as the public methods take keys for the attribute type of the index:
+           * an int, a double or a char string of STRINGKEYMAXSIZE bytes, NUL padded if it is shorter.
+         * @param record		Bytes of the record, on the page, with no alignment guarantee
+         * @param length		Length of the record in bytes
+         * @param key		Buffer of at least STRINGKEYMAXSIZE bytes
+          **/
+        virtual void extractKey(const char *record, std::size_t length, void *key) const = 0;
+    };
+
+/**
+ * @brief The default KeyExtractor, reads the attribute of the given type at the given byte offset of the record.
+ * @throws BadIndexInfoException from extractKey if an int or double attribute ends past the end of the record.
+ * A STRING attribute ends at the end of the record at the latest.
+*/
+    class AttributeKeyExtractor : public KeyExtractor {
+    public:
+        AttributeKeyExtractor(int attrByteOffset, Datatype attrType);
+
+        void extractKey(const char *record, std::size_t length, void *key) const;
+
+    private:
+        int attrByteOffset;
+        Datatype attrType;
+    };
+
+/**
+ * @brief Build-time options of an index. Passed to the BTreeIndex constructor and only consulted
+ * when the index file does not exist yet and has to be constructed from the base relation,
+ * except residentNonLeafPages, splitPolicy and insertBufferSize, which apply every time the index is opened.
+*/
+    struct IndexOptions {
+        /**
+         * If true the index is bulk loaded: all (key, rid) pairs of the relation are collected and sorted,
+         * leaves are packed left to right and the non-leaf levels are built bottom-up.
+         * If false every tuple is inserted through insertEntry.
+         */
+        bool bulkLoad;
+
+        /**
+         * Fraction of the slots of every leaf and non-leaf node filled by the bulk load. Must be in (0, 1].
+         * Leaving free slots makes later inserts into a bulk loaded index split less often.
+         */
+        double fillFactor;
+
+        /**
+         * Number of non-leaf nodes kept pinned in the buffer pool while the index is open. Descents reach them
+         * without a buffer manager lookup. Nodes become resident as descents first read them, so the root and
+         * the levels below it fill the budget. Each of them takes a buffer frame for as long as the index is open.
+         */
+        int residentNonLeafPages;
+
+        /**
+         * How inserts split full nodes, SPLIT_APPEND for keys that are mostly inserted in increasing order.
+         */
+        SplitPolicy splitPolicy;
+
+        /**
+         * Number of insertEntry calls collected in memory before they go into the tree together through insertBatch,
+         * 0 to insert every entry right away. Each leaf is then written once for all the collected entries that go into it.
+         * Every other operation on the index, and closing it, first inserts the collected entries, so a read
+         * or scan after an insert pays for inserting everything collected so far.
+         * The entries are only kept in process memory, not in the index file: they are lost if the process ends
+         * before they are inserted. Call flushInserts to have them in the tree. If inserting them fails when
+         * the index is closed, the destructor drops them, as it does not throw.
+         */
+        int insertBufferSize;
+
+        /**
+         * Maximum number of leaves a range scan reads into the buffer pool ahead of the leaf it is on, 0 to never
+         * read ahead. Once a scan moves past its first leaf it keeps as many leaves read ahead as it has already
+         * moved through, up to this limit, so only long scans reach it. Leaves past the end of the range are not read.
+         */
+        int readAheadLeaves;
+
+        /**
+         * Number of threads the bulk load reads and sorts the relation on. The threads take the pages of the relation
+         * one at a time, extract the keys of their records and sort them, the sorted runs are then merged.
+         * Pages are still read from the relation file one at a time, only extracting and sorting run in parallel.
+         */
+        int buildThreads;
+
+        /**
+         * Reads the keys of the records of the relation, NULL for an AttributeKeyExtractor on the attribute offset
+         * and type the index is created with. Not owned by the index. The key it writes has to be of that type.
+         */
+        const KeyExtractor *keyExtractor;
+
+        /**
+         * If true the non-leaf nodes of an INTEGER or DOUBLE index have the NONLEAF_LINE_DIRECTORY format:
+         * a search reads a few cache lines of each node instead of binary searching its keys, and a node
+         * holds fewer keys (969 instead of 1022 for INTEGER, 652 instead of 681 with subtreeCounts).
+         * Ignored for STRING indexes.
+         */
+        bool lineDirectory;
+
+        /**
+         * If true every non-leaf node keeps the number of entries in the subtree of each child, so countRange,
+         * rank and selectNth only read one path per bound, and parallelScan splits a range into parts with about
+         * the same number of entries. The counts take 4 bytes per child, which cuts the INTEGER non-leaf fanout
+         * from 1022 to 681, and every insert and delete updates the counts on its path.
+         * Without them countRange, rank and selectNth read the leaves up to the entries they look for, and
+         * parallelScan splits a range at the keys of the non-leaf nodes, whose parts may differ in size.
+         */
+        bool subtreeCounts;
+
+        /**
+         * Attributes of the records stored in the leaves next to the key of each entry, at most MAXINCLUDEDATTRIBUTES
+         * of them with at most MAXPAYLOADSIZE bytes together. Scans return them through scanNextBatch, so a query that
+         * only needs the key and these attributes never reads the base relation. Leaves then hold fewer entries.
+         * The index keeps the ones it was created with, they are written to the metapage.
+         */
+        std::vector<IncludedAttribute> includes;
+
+        /**
+         * If true the leaves of an INTEGER index have the LEAF_PACKED format: each entry stores the difference of its key
+         * to the smallest key of the leaf and of its page number to the smallest page number of the leaf, in as few bits
+         * as the leaf needs. Leaves of close keys over records on close pages hold 2 to 4 times as many entries,
+         * so scans read fewer leaves, while inserts and deletes shift bit fields instead of array slots.
+         * Cannot be combined with includes. Ignored for DOUBLE and STRING indexes.
+         */
+        bool packedLeaves;
+
+        /**
+         * If true the leaves of an INTEGER index have the LEAF_POSTINGS format: each key is stored once with the sorted list
+         * of the RecordIds of its records, and a long list moves to overflow pages, so all entries of a key are in one leaf
+         * and its overflow pages. Meant for columns with few distinct keys. An entry takes 6 bytes in the leaf, plus 20 bytes
+         * per key, so leaves of keys with a few records each hold more entries, leaves of unique keys fewer.
+         * Equality and range scans copy the RecordIds of a list without comparing keys and stream the overflow pages.
+         * Cannot be combined with packedLeaves or includes. Ignored for DOUBLE and STRING indexes.
+         */
+        bool postingLists;
+
+        IndexOptions() : bulkLoad(true), fillFactor(1.0), residentNonLeafPages(0), splitPolicy(SPLIT_EVEN),
+                         insertBufferSize(0), readAheadLeaves(8), buildThreads(1), keyExtractor(NULL),
+                         lineDirectory(false), subtreeCounts(false), packedLeaves(false), postingLists(false) {}
+    };
+
+/*
+Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
+These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of
+node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes
+at this level are just above the leaf nodes. Otherwise set to 0.
+*/
+
+/**
+ * @brief Structure for all non-leaf nodes, templated on the key type (int or double, see below for STRING).
+ * A node with keyCount keys has keyCount + 1 children, child i holds the keys in [keys()[i-1], keys()[i]).
+ * With NONLEAF_COUNTS every child also has the number of entries in its subtree, so ranks and range counts
+ * need no leaf scans.
+ * The rest of the page is placed by the NonLeafLayout of the format of the node.
+ * The NONLEAF_SORTED format has the most keys and is searched by binary search over the key array.
+ * The NONLEAF_LINE_DIRECTORY format gives up some keys for a two level directory of the largest key of each
+ * cache line of keys. A search then reads the first line of the node, which holds the header and the group
+ * maxima, one line of line maxima and one line of keys, see searchKeyLines, where the binary search reads
+ * about log2(keyCount) lines. That is 3 cache lines for INTEGER keys. DOUBLE group maxima only fit into the
+ * first line up to 6 groups, a DOUBLE node with more than 384 keys has the others in the second line, so its
+ * search reads 4 lines. The node starts on a cache line, the buffer pool frames are aligned for it.
+*/
+    template<class T>
+    struct NonLeafNode {
+        /**
+         * Node type (NON_LEAF_NODE), NonLeafFormat and number of keys.
+         */
+        NodeHeader header;
+
+        /**
+         * Level of the node in the tree.
+         */
+        int level;
+
+        /**
+         * Placement of the parts of the node, from its format.
+         */
+        const NonLeafLayout &layout() const {
+            return NonLeafLayouts<T>::FORMATS[header.format];
+        }
+
+        /**
+         * Keys, the first keyCount of them are used.
+         */
+        T *keys() {
+            return (T *) ((char *) this + layout().keyOffset);
+        }
+
+        const T *keys() const {
+            return (const T *) ((const char *) this + layout().keyOffset);
+        }
+
+        /**
+         * Page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+         */
+        PageId *pageNos() {
+            return (PageId *) ((char *) this + layout().pageNoOffset);
+        }
+
+        const PageId *pageNos() const {
+            return (const PageId *) ((const char *) this + layout().pageNoOffset);
+        }
+
+        /**
+         * NONLEAF_COUNTS only: number of leaf entries in the subtree of each child.
+         */
+        int *counts() {
+            return (int *) ((char *) this + layout().countOffset);
+        }
+
+        const int *counts() const {
+            return (const int *) ((const char *) this + layout().countOffset);
+        }
+
+        /**
+         * NONLEAF_LINE_DIRECTORY only: largest key of each line of keys, sized to whole groups,
+         * and largest key of each group of KEYS_PER_LINE lines.
+         */
+        T *lineMax() {
+            return (T *) ((char *) this + layout().lineMaxOffset);
+        }
+
+        const T *lineMax() const {
+            return (const T *) ((const char *) this + layout().lineMaxOffset);
+        }
+
+        T *groupMax() {
+            return (T *) ((char *) this + layout().groupMaxOffset);
+        }
+
+        const T *groupMax() const {
+            return (const T *) ((const char *) this + layout().groupMaxOffset);
+        }
+    };
+
+
+/**
+ * @brief Structure for all leaf nodes, templated on the key type (int or double, see below for STRING).
+ * The sibling links follow the header, then come the keys, the RecordIds and the payloads, the included
+ * attributes of each entry. How many entries a leaf holds depends on the payload size in its header.
+*/
+    template<class T>
+    struct LeafNode {
+        /**
+         * Node type (LEAF_NODE), payload size and number of keys.
+         */
+        NodeHeader header;
+
+        /**
+         * Page number of the leaf on the right side.
+           * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+         */
+        PageId rightSibPageNo;
+
+        /**
+         * Page number of the leaf on the left side, used by descending scans.
+         */
+        PageId leftSibPageNo;
+
+        /**
+         * Number of entries a leaf with the given payload size can hold.
+         */
+        static int capacityFor(int payloadSize) {
+            return payloadSize == 0 ? NodeFanout<T>::LEAF_SIZE
+                                    : (Page::SIZE - (int) sizeof(LeafNode)) / ((int) sizeof(T) + (int) sizeof(LeafRecordId) + payloadSize);
+        }
+
+        int capacity() const {
+            return capacityFor(header.payloadSize);
+        }
+
+        /**
+         * Keys, the first keyCount of them are used.
+         */
+        T *keys() {
+            return (T *) (this + 1);
+        }
+
+        const T *keys() const {
+            return (const T *) (this + 1);
+        }
+
+        /**
+         * RecordIds of the keys.
+         */
+        LeafRecordId *rids() {
+            return (LeafRecordId *) (keys() + capacity());
+        }
+
+        const LeafRecordId *rids() const {
+            return (const LeafRecordId *) (keys() + capacity());
+        }
+
+        /**
+         * payloadSize bytes for each key.
+         */
+        char *payloads() {
+            return (char *) (rids() + capacity());
+        }
+
+        const char *payloads() const {
+            return (const char *) (rids() + capacity());
+        }
+    };
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
+*/
+    typedef NonLeafNode<int> NonLeafNodeInt;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of INTEGER type.
+*/
+    typedef LeafNode<int> LeafNodeInt;
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of DOUBLE type.
+*/
+    typedef NonLeafNode<double> NonLeafNodeDouble;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of DOUBLE type.
+*/
+    typedef LeafNode<double> LeafNodeDouble;
+
+/**
+ * @brief Leaf of an INTEGER index in the LEAF_PACKED format. The header and the sibling links are where LeafNodeInt has them,
+ * the tree code reads every INTEGER leaf as a LeafNodeInt and the node access functions check the format.
+ * Entry i takes entryBits() bits from bit i * entryBits() of bits on: its key minus keyBase in keyBits bits,
+ * the page number of its RecordId minus pageBase in pageBits bits, then the slot number in slotBits bits.
+ * All entries of a leaf have the same widths, so a search reads entry i without decoding the ones before it.
+ * Inserts keep the widths while the new entry fits into them and pack the leaf again when it does not.
+ * Deletes keep them, so keyBase and pageBase may be below, and pageMax and slotMax above, the entries left.
+*/
+    struct PackedLeafNode {
+        /**
+         * Node type (LEAF_NODE), format LEAF_PACKED and number of entries.
+         */
+        NodeHeader header;
+
+        /**
+         * Sibling links, as in LeafNode.
+         */
+        PageId rightSibPageNo;
+        PageId leftSibPageNo;
+
+        /**
+         * Key and page number the entries are stored as differences from.
+         */
+        int keyBase;
+        PageId pageBase;
+
+        /**
+         * Largest page and slot numbers the widths were chosen for.
+         */
+        PageId pageMax;
+        SlotId slotMax;
+
+        /**
+         * Widths of the three fields of an entry.
+         */
+        std::uint8_t keyBits;
+        std::uint8_t pageBits;
+        std::uint8_t slotBits;
+
+        /**
+         * The entries. The last 8 bytes are never used, so every field is read with one unaligned 8 byte load.
+         */
+        std::uint8_t bits[Page::SIZE - 40];
+
+        /**
+         * Number of bits of the entries a leaf holds.
+         */
+        static const int CAPACITY_BITS = (Page::SIZE - 40 - 8) * 8;
+
+        int entryBits() const {
+            int width = keyBits + pageBits + slotBits;
+            return width > 0 ? width : 1;
+        }
+    };
+
+    static_assert(sizeof(PackedLeafNode) <= Page::SIZE && offsetof(PackedLeafNode, leftSibPageNo) == offsetof(LeafNodeInt, leftSibPageNo),
+                  "Packed leaves must fit in a page and link to their siblings as other leaves do");
+
+/**
+ * @brief Key of a leaf in the LEAF_POSTINGS format with the place of its RecordIds, see PostingLeafNode.
+ */
+    struct PostingList {
+        /**
+         * The key, stored once for all its RecordIds.
+         */
+        int key;
+
+        /**
+         * Position after the last RecordId of the list in the leaf. The list starts where the one before it ends.
+         */
+        int end;
+
+        /**
+         * First and last overflow page of the list, UINT32_MAX if it has none.
+         */
+        PageId firstPageNo;
+        PageId lastPageNo;
+
+        /**
+         * Number of RecordIds in the overflow pages.
+         */
+        int overflowCount;
+    };
+
+/**
+ * @brief Leaf of an INTEGER index in the LEAF_POSTINGS format. The header and the sibling links are where LeafNodeInt has them,
+ * the node access functions check the format. The RecordIds of all lists follow the header, by key and then sorted,
+ * and the lists grow from the end of the page towards them, list g is the g-th PostingList from the end.
+ * A list keeps its RecordIds in the leaf until it has MAX_INLINE of them. Then all but the smallest one move to a chain
+ * of overflow pages, sorted as well, which later RecordIds of the key go into. The list keeps its overflow pages until they are empty.
+ * Positions of the leaf are its RecordIds, keyCount of them, so a list with overflow pages has a single position.
+ * The entries of a leaf are those RecordIds and the ones in the overflow pages.
+ * Every key is in one leaf only: splits and borrows move whole lists, and an insert goes down right of a separator equal to its key.
+ */
+    struct PostingLeafNode {
+        /**
+         * Node type (LEAF_NODE), format LEAF_POSTINGS and number of RecordIds in the leaf.
+         */
+        NodeHeader header;
+
+        /**
+         * Sibling links, as in LeafNode.
+         */
+        PageId rightSibPageNo;
+        PageId leftSibPageNo;
+
+        /**
+         * Number of lists, which is the number of keys.
+         */
+        int listCount;
+
+        /**
+         * Bytes of the RecordIds and the lists a leaf holds.
+         */
+        static const int CAPACITY_BYTES = Page::SIZE - sizeof(NodeHeader) - 2 * sizeof(PageId) - sizeof(int);
+
+        /**
+         * Number of RecordIds a list keeps in the leaf before it moves them to overflow pages, an eighth of the leaf.
+         */
+        static const int MAX_INLINE = CAPACITY_BYTES / sizeof(LeafRecordId) / 8;
+
+        LeafRecordId *rids() {
+            return (LeafRecordId *) (this + 1);
+        }
+
+        const LeafRecordId *rids() const {
+            return (const LeafRecordId *) (this + 1);
+        }
+
+        PostingList &list(int g) {
+            return ((PostingList *) ((char *) this + Page::SIZE))[-1 - g];
+        }
+
+        const PostingList &list(int g) const {
+            return ((const PostingList *) ((const char *) this + Page::SIZE))[-1 - g];
+        }
+
+        int usedBytes() const {
+            return header.keyCount * (int) sizeof(LeafRecordId) + listCount * (int) sizeof(PostingList);
+        }
+    };
+
+    static_assert(sizeof(PostingLeafNode) + PostingLeafNode::CAPACITY_BYTES == Page::SIZE
+                  && offsetof(PostingLeafNode, leftSibPageNo) == offsetof(LeafNodeInt, leftSibPageNo),
+                  "Posting leaves must fill a page and link to their siblings as other leaves do");
+
+/**
+ * @brief Page of the overflow chain of a PostingList. Holds a sorted part of the RecordIds of the list, all of them greater
+ * than or equal to the ones of the page before. Pages are linked both ways, a descending scan reads the chain from its last page.
+ * A full page is split in two, an empty one is freed.
+ */
+    struct OverflowPage {
+        /**
+         * Node type (OVERFLOW_NODE) and number of RecordIds.
+         */
+        NodeHeader header;
+
+        /**
+         * Next and previous page of the chain, UINT32_MAX at its ends.
+         */
+        PageId nextPageNo;
+        PageId prevPageNo;
+
+        static const int CAPACITY = (Page::SIZE - sizeof(NodeHeader) - 2 * sizeof(PageId)) / sizeof(LeafRecordId);
+
+        LeafRecordId rids[CAPACITY];
+    };
+
+    static_assert(sizeof(OverflowPage) <= Page::SIZE, "Overflow pages must fit in a page");
+
+    static_assert(sizeof(LeafNodeInt) + NodeFanout<int>::LEAF_SIZE * (sizeof(int) + sizeof(LeafRecordId)) <= Page::SIZE
+                  && sizeof(LeafNodeDouble) + NodeFanout<double>::LEAF_SIZE * (sizeof(double) + sizeof(LeafRecordId)) <= Page::SIZE,
+                  "INTEGER and DOUBLE leaves must fit in a page");
+
+/**
+ * @brief Maximum length of a STRING key. The key is the attribute up to its first NUL byte, but at most this many bytes.
+ */
+    const int STRINGKEYMAXSIZE = 64;
+
+/**
+ * @brief Slot of a STRING leaf, locates one key inside the page and holds its RecordId.
+ */
+    struct LeafStringSlot {
+        LeafRecordId rid;
+        std::uint16_t keyOffset;
+        std::uint16_t keyLength;
+    };
+
+/**
+ * @brief Slot of a STRING non-leaf, locates one key inside the page and holds the page number of the child right of it,
+ * with the number of entries in the subtree of that child. Without NONLEAF_COUNTS the slots end before count.
+ */
+    struct NonLeafStringSlot {
+        PageId pageNo;
+        std::uint16_t keyOffset;
+        std::uint16_t keyLength;
+        int count;
+    };
+
+/*
+STRING keys vary in length, so their nodes are slotted pages. The slot array grows from the start of the page
+and holds one fixed size slot per key, in key order. The key bytes are packed at the end of the page, growing
+towards the slots, the area from keyBytesStart to the end of the page holds exactly the bytes of the keyCount keys.
+The slot array is declared as long as the page, the part past keyCount is free space or key bytes.
+A node is full when the free space between the two cannot take one more slot and key, so the fanout
+depends on the actual key lengths.
+*/
+
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+*/
+    template<>
+    struct LeafNode<std::string> {
+        /**
+         * Node type (LEAF_NODE), payload size and number of keys.
+         */
+        NodeHeader header;
+
+        /**
+         * Page number of the leaf on the right side.
+         */
+        PageId rightSibPageNo;
+
+        /**
+         * Page number of the leaf on the left side.
+         */
+        PageId leftSibPageNo;
+
+        /**
+         * Offset in the page of the first key byte.
+         */
+        int keyBytesStart;
+
+        /**
+         * Key locations, RecordIds and payloads, the first keyCount slots are used. Only reached through slot.
+         */
+        LeafStringSlot slotArray[(Page::SIZE - sizeof(NodeHeader) - 2 * sizeof(PageId) - sizeof(int)) / sizeof(LeafStringSlot)];
+
+        /**
+         * Bytes taken by one slot, with the payload of the entry after it, padded to keep the slots aligned.
+         */
+        static int slotSizeFor(int payloadSize) {
+            return sizeof(LeafStringSlot) + (payloadSize + 1) / 2 * 2;
+        }
+
+        int slotSize() const {
+            return slotSizeFor(header.payloadSize);
+        }
+
+        LeafStringSlot &slot(int i) {
+            return *(LeafStringSlot *) ((char *) slotArray + i * slotSize());
+        }
+
+        const LeafStringSlot &slot(int i) const {
+            return *(const LeafStringSlot *) ((const char *) slotArray + i * slotSize());
+        }
+    };
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of STRING type.
+ * Child 0 is leftPageNo, child i > 0 is slotArray[i-1].pageNo, and the same for the entry counts.
+*/
+    template<>
+    struct NonLeafNode<std::string> {
+        /**
+         * Node type (NON_LEAF_NODE) and number of keys.
+         */
+        NodeHeader header;
+
+        /**
+         * Level of the node in the tree.
+         */
+        int level;
+
+        /**
+         * Page number of the child left of the first key.
+         */
+        PageId leftPageNo;
+
+        /**
+         * Number of entries in the subtree of leftPageNo, unused without NONLEAF_COUNTS.
+         */
+        int leftCount;
+
+        /**
+         * Offset in the page of the first key byte.
+         */
+        int keyBytesStart;
+
+        /**
+         * Key locations and the children right of them, the first keyCount slots are used.
+         * Only reached through slot, the slots are shorter without NONLEAF_COUNTS.
+         */
+        NonLeafStringSlot slotArray[(Page::SIZE - sizeof(NodeHeader) - 3 * sizeof(int) - sizeof(PageId)) / sizeof(NonLeafStringSlot)];
+
+        /**
+         * Bytes taken by one slot, without the count if the node has no NONLEAF_COUNTS.
+         */
+        int slotSize() const {
+            return (header.format & NONLEAF_COUNTS) != 0 ? sizeof(NonLeafStringSlot) : sizeof(NonLeafStringSlot) - sizeof(int);
+        }
+
+        NonLeafStringSlot &slot(int i) {
+            return *(NonLeafStringSlot *) ((char *) slotArray + i * slotSize());
+        }
+
+        const NonLeafStringSlot &slot(int i) const {
+            return *(const NonLeafStringSlot *) ((const char *) slotArray + i * slotSize());
+        }
+    };
+
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+*/
+    typedef LeafNode<std::string> LeafNodeString;
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of STRING type.
+*/
+    typedef NonLeafNode<std::string> NonLeafNodeString;
+
+    static_assert(sizeof(NonLeafNodeString) <= Page::SIZE && sizeof(LeafNodeString) <= Page::SIZE,
+                  "STRING nodes must fit in a page");
+
+
+    class BTreeIndex;
+
+    class RecordPayloads;
+
+/**
+ * @brief Receives the entries of one part of a BTreeIndex::parallelScan. consume is called on the worker thread
+ * that scans the part, one sink per part, so a sink needs no locking for its own state.
+*/
+    class ScanSink {
+    public:
+        virtual ~ScanSink() {}
+
+        /**
+           * Take the next entries of the part, in key order.
+         * @param rids		Record ids of the entries
+         * @param keys		Keys of the entries, as outKeys of BTreeScanCursor::scanNextBatch
+         * @param count		Number of entries
+          **/
+        virtual void consume(const RecordId *rids, const void *keys, int count) = 0;
+    };
+
+/**
+ * @brief Position of one range scan over a BTreeIndex. Every cursor has its own bounds and its own pinned leaf,
+ * so any number of cursors can be open on an index at the same time.
+ * Cursors are created by BTreeIndex::openScan and deleted by the caller, which unpins the leaf.
+ * All cursors of an index have to be deleted before the index, and before deleteEntry is called on it.
+*/
+    class BTreeScanCursor {
+        friend class BTreeIndex;
+
+    private:
+
+        BTreeScanCursor(BTreeIndex *index, const void *lowVal, const Operator lowOp,
+                        const void *highVal, const Operator highOp, const ScanOrder order);
+
+        BTreeScanCursor(const BTreeScanCursor &) = delete;
+
+        BTreeScanCursor &operator=(const BTreeScanCursor &) = delete;
+
+        /*
+         * Constructor and scanNext for an index with keys of type T
+         */
+        template<class T>
+        void start(const void *lowVal, const void *highVal);
+
+        template<class T>
+        void next(RecordId &outRid);
+
+        template<class T, class K>
+        int nextBatch(RecordId *outRids, int maxCount, K *outKeys, char *outPayloads);
+
+        /*
+         * scanNext and scanNextBatch of a DESCENDING scan
+         */
+        template<class T>
+        void prev(RecordId &outRid);
+
+        template<class T, class K>
+        int prevBatch(RecordId *outRids, int maxCount, K *outKeys, char *outPayloads);
+
+        /*
+         * Move on to the next leaf in the order of the scan, and read the leaves after it ahead
+         */
+        template<class T>
+        bool stepLeaf();
+
+        template<class T>
+        void readAhead();
+
+        /*
+         * Low and high value of the scan, of the member matching T
+         */
+        template<class T>
+        T &scanLowVal();
+
+        template<class T>
+        T &scanHighVal();
+
+        /**
+         * Index the cursor scans.
+         */
+        BTreeIndex *index;
+
+        /**
+         * Index of next entry to be scanned in current leaf being scanned, -1 if a DESCENDING scan
+         * has to move on to the left sibling.
+         */
+        int nextEntry;
+
+        /**
+         * Where the range ends in the current leaf, -1 until it is looked up for that leaf. In an ASCENDING scan
+         * the index of the first entry past the high value or keyCount, in a DESCENDING scan the index of the last
+         * entry below the low value plus one, or 0. Entries up to it are returned without comparing their keys,
+         * so a run of duplicates streams out of the leaf.
+         */
+        int rangeLimit;
+
+        /**
+         * Page number of current page being scanned.
+         */
+        PageId currentPageNum;
+
+        /**
+         * Last leaf read ahead of the scan, UINT32_MAX once the read-ahead reached the leaf the range ends in.
+         */
+        PageId readAheadPageNo;
+
+        /**
+         * Number of leaves read ahead that the scan has not reached yet.
+         */
+        int leavesAhead;
+
+        /**
+         * Number of leaves the scan has moved on to after its first one.
+         */
+        int leavesScanned;
+
+        /**
+         * Number of leaves read ahead, added to the count of the index when the cursor is deleted.
+         */
+        int readAheadCount;
+
+        /**
+         * Posting leaves only: overflow page the scan goes on in, UINT32_MAX if it is not in a list of overflow pages.
+         * An ASCENDING scan streams the list of the entry before nextEntry, a DESCENDING scan the one of nextEntry.
+         */
+        PageId overflowPageNo;
+
+        /**
+         * Next RecordId of that overflow page, -1 for the last one in a DESCENDING scan.
+         */
+        int overflowEntry;
+
+        /**
+         * DESCENDING scans: true once the overflow pages of the list of nextEntry were returned, its entry is next.
+         */
+        bool listDone;
+
+        /**
+         * Current Page being scanned.
+         */
+        Page *currentPageData;
+
+        /**
+         * Low INTEGER value for scan.
+         */
+        int lowValInt;
+
+        /**
+         * Low DOUBLE value for scan.
+         */
+        double lowValDouble;
+
+        /**
+         * Low STRING value for scan.
+         */
+        std::string lowValString;
+
+        /**
+         * High INTEGER value for scan.
+         */
+        int highValInt;
+
+        /**
+         * High DOUBLE value for scan.
+         */
+        double highValDouble;
+
+        /**
+         * High STRING value for scan.
+         */
+        std::string highValString;
+
+        /**
+         * Low Operator. Can only be GT(>) or GTE(>=).
+         */
+        Operator lowOp;
+
+        /**
+         * High Operator. Can only be LT(<) or LTE(<=).
+         */
+        Operator highOp;
+
+        /**
+         * Order of the scan.
+         */
+        ScanOrder order;
+
+    public:
+
+        /**
+         * Unpins the leaf the cursor is on.
+         */
+        ~BTreeScanCursor();
+
+        /**
+           * Fetch the record id of the next index entry that matches the scan.
+           * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+           * A DESCENDING scan moves on to the left sibling instead.
+         * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+           * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+          **/
+        const void scanNext(RecordId &outRid);
+
+
+        /**
+           * Fetch the record ids of the next index entries that match the scan, as many as fit in outRids.
+           * Moves on to the right siblings of the current page as needed, or to the left siblings in a DESCENDING scan.
+           * Does not throw at the end of the scan. The keys come from the leaves, so a query that only needs the indexed
+           * attribute can take it from outKeys and never read the records of the base relation.
+         * @param outRids	Array of at least maxCount record ids, filled with the record ids found
+         * @param maxCount	Maximum number of record ids to fetch
+         * @param outKeys	If not NULL, array of at least maxCount keys filled with the keys found: int, double, or for a
+         *                  STRING index char[STRINGKEYMAXSIZE] padded with NUL bytes
+         * @param outPayloads	If not NULL, maxCount times BTreeIndex::payloadSize bytes filled with the included attributes
+         *                  of the entries found, see IndexOptions::includes
+         * @return Number of record ids fetched. It is less than maxCount only if no more records are left to be scanned.
+          **/
+        int scanNextBatch(RecordId *outRids, int maxCount, void *outKeys = NULL, void *outPayloads = NULL);
+
+    };
+
+/**
+ * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+ * relation. This index supports one scan at a time through startScan, and any number of scans through openScan.
+*/
+    class BTreeIndex {
+        friend class BTreeScanCursor;
+
+    private:
+
+        /*
+         * All the methods below that are templated on T work on nodes holding keys of type T.
+         * The public methods pick T once from attributeType, int for INTEGER, double for DOUBLE and std::string for STRING.
+         */
+
+        /*
+         * Iterate over the relation, and construct the Btree
+         *
+         */
+        template<class T>
+        void constructBtree(const std::string &relationName, const KeyExtractor *keyExtractor);
+
+        /*
+         * Collect all (key, rid) pairs of the relation, sort them and build the Btree bottom-up.
+         * Sets rootPageNum, the root page is left pinned.
+         */
+        template<class T>
+        void bulkLoadBtree(const std::string &relationName, double fillFactor, int buildThreads,
+                           const KeyExtractor *keyExtractor);
+
+        /*
+         * Collect all (key, rid) pairs of the relation in key order, on buildThreads threads,
+         * and the payload of every record if the index has included attributes.
+         */
+        template<class T>
+        void collectSortedEntries(const std::string &relationName, int buildThreads, const KeyExtractor *keyExtractor,
+                                  std::vector<RIDKeyPair<T> > &entries, RecordPayloads &payloads);
+
+        /*
+         * Build one non-leaf level on top of the given children, returns the (pageNo, lowest key) pair of every new node
+         */
+        template<class T>
+        std::vector<PageKeyPair<T> > buildNonLeafLevel(const std::vector<PageKeyPair<T> > &children, std::vector<int> &counts,
+                                                      bool childrenAreLeaves, double fillFactor);
+
+        /*
+         *
+         */
+        //void allocatePageAndUpdateMap(PageId&,int);
+        template<class T>
+        void AllocatePageAndSetDefaultValues(PageId &pageNo, Page *&currPage, bool isLeaf);
+
+        /*
+         * Allocate an empty root whose single child is an empty leaf. Sets rootPageNum, the root page is left pinned.
+         */
+        template<class T>
+        void allocateEmptyRoot();
+
+        /*
+         * Allocate a page for a node, taking the first freed page if there is one
+         */
+        void allocNodePage(PageId &pageNo, Page *&page);
+
+        /*
+         * Put the pinned page of a node that is no longer used on the free page list and unpin it
+         */
+        void freeNodePage(PageId pageNo, Page *page);
+
+        /*
+         * Write rootPageNum and freePageNum to the metapage
+         */
+        void updateMetaInfo();
+
+        /*
+         * Read and release a non-leaf node on a descent, through the resident nodes if it is one of them
+         */
+        void readNonLeaf(PageId pageNo, Page *&page);
+
+        void releaseNonLeaf(PageId pageNo, bool dirty);
+
+        void releaseResidentPages();
+
+        /*
+         * Open the existing index file, see the constructor
+         */
+        void openExistingIndex(const std::string &indexName, const std::string &relationName,
+                               int attrByteOffset, Datatype attrType);
+
+        /*
+         * Release what the constructor allocated for a new index that could not be built
+         */
+        void discardNewIndex(const std::string &indexName);
+
+        template<typename T>
+        void writeNodeToPage(T *, PageId, Page *);
+
+        void writeMetaInfoToPage(IndexMetaInfo *, PageId, Page *);
+
+        template<class T>
+        void setLeftSibling(PageId pageNo, PageId leftSibPageNo);
+
+        template<class T>
+        void copyAndSet(LeafNode<T> *, LeafNode<T> *, int, int);
+
+        template<class T>
+        void copyAndSet(NonLeafNode<T> *, NonLeafNode<T> *, int, int);
+
+        void copyAndSet(LeafNodeString *, LeafNodeString *, int, int);
+
+        void copyAndSet(LeafNodeInt *, LeafNodeInt *, int, int);
 
-/**
- * @brief Overloaded operator to compare the key values of two rid-key pairs
- * and if they are the same compares to see if the first pair has
- * a smaller rid.pageNo value.
-*/
-    template<class T>
-    bool operator<(const RIDKeyPair<T> &r1, const RIDKeyPair<T> &r2) {
-        if (r1.key != r2.key)
-            return r1.key < r2.key;
-        else
-            return r1.rid.page_number < r2.rid.page_number;
-    }
+        void copyAndSet(NonLeafNodeString *, NonLeafNodeString *, int, int);
 
-/**
- * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
- * to the following structure to store or retrieve information from it.
- * Contains the relation name for which the index is created, the byte offset
- * of the key value on which the index is made, the type of the key and the page no
- * of the root page. Root page starts as page 2 but since a split can occur
- * at the root the root page may get moved up and get a new page no.
-*/
-    struct IndexMetaInfo {
-        /**
-         * Name of base relation.
+        /*
+         * Split currentNode into newLeafNode and insert the entry. inserted is set to false if the entry does not fit into
+         * its half of a packed leaf, the caller then inserts it again once the split is done.
          */
-        char relationName[20];
+        template<class T>
+        T splitLeafNodeInTwo(LeafNode<T> *newLeafNode, LeafNode<T> *currentNode, RecordId r, T k, const char *payload,
+                             bool append, bool &inserted);
 
-        /**
-         * Offset of attribute, over which index is built, inside the record stored in pages.
+        template<class T>
+        T splitNonLeafNode(NonLeafNode<T> *newNonLeafNode, NonLeafNode<T> *currentNode, T key, PageId pageId, int entryCount,
+                           bool append);
+
+        /*
+         * Posting lists of LEAF_POSTINGS leaves, see PostingLeafNode. The templates are for leaves without them,
+         * the overloads for INTEGER leaves check the format.
          */
-        int attrByteOffset;
 
-        /**
-         * Type of the attribute over which index is built.
+        /*
+         * Put the entry into the overflow pages of its list, moving the list there if it is full in the leaf.
+         * Returns false if the entry still has to be inserted into the leaf.
          */
-        Datatype attrType;
+        template<class T>
+        bool insertOverflow(LeafNode<T> *leaf, const T &key, const RecordId &rid);
 
-        /**
-         * Page number of root page of the B+ Tree inside the file index file.
+        bool insertOverflow(LeafNodeInt *leaf, const int &key, const RecordId &rid);
+
+        /*
+         * Remove the entry if its list has overflow pages. Returns false if it was not removed.
          */
-        PageId rootPageNo;
-    };
+        template<class T>
+        bool removeOverflow(LeafNode<T> *leaf, const T &key, const RecordId &rid);
 
-/*
-Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
-These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of
-node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes
-at this level are just above the leaf nodes. Otherwise set to 0.
-*/
+        bool removeOverflow(LeafNodeInt *leaf, const int &key, const RecordId &rid);
 
-/**
- * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
-*/
-    struct NonLeafNodeInt {
-        /**
-         * Level of the node in the tree.
+        /*
+         * Append the RecordIds in the overflow pages of the list at position i to outRids, returns their number
          */
-        int level;
+        template<class T>
+        int overflowRids(const LeafNode<T> *leaf, int i, std::vector<RecordId> *outRids);
 
-        /**
-         * Stores keys.
+        int overflowRids(const LeafNodeInt *leaf, int i, std::vector<RecordId> *outRids);
+
+        /*
+         * Entry n of a leaf, counting the RecordIds in overflow pages, and its key if key is not NULL
          */
-        int keyArray[INTARRAYNONLEAFSIZE];
+        template<class T>
+        void entryAt(const LeafNode<T> *leaf, int n, RecordId &rid, void *key);
 
-        /**
-         * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+        void entryAt(const LeafNodeInt *leaf, int n, RecordId &rid, void *key);
+
+        /*
+         * Put count entries of a bulk load from first on into an empty leaf
          */
-        PageId pageNoArray[INTARRAYNONLEAFSIZE + 1];
+        template<class T>
+        void fillLeaf(LeafNode<T> *leaf, const std::vector<RIDKeyPair<T> > &entries, int first, int count,
+                      const RecordPayloads &payloads);
 
-        NonLeafNodeInt() {
-            for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-                keyArray[i] = INT32_MAX;
-                pageNoArray[i] = UINT32_MAX;
-            }
-            pageNoArray[INTARRAYNONLEAFSIZE] = UINT32_MAX;
-            level = 1;
-        }
+        void fillLeaf(LeafNodeInt *leaf, const std::vector<RIDKeyPair<int> > &entries, int first, int count,
+                      const RecordPayloads &payloads);
 
-    };
+        /*
+         * Child of a non-leaf an insert of key goes down to
+         */
+        template<class T>
+        int insertChild(const NonLeafNode<T> *node, const T &key);
 
+        /*
+         * Overflow pages of a list: write the sorted rids into new pages, insert or remove one RecordId,
+         * link two pages of the chain, or one to the end of it if the other is UINT32_MAX
+         */
+        void writeOverflow(PostingList &list, const RecordId *rids, int count);
 
-/**
- * @brief Structure for all leaf nodes when the key is of INTEGER type.
-*/
-    struct LeafNodeInt {
-        /**
-         * Stores keys.
+        void insertOverflowRid(PostingList &list, const RecordId &rid);
+
+        bool removeOverflowRid(PostingList &list, const RecordId &rid);
+
+        void linkOverflowPages(PostingList &list, PageId leftPageNo, PageId rightPageNo);
+
+        /*
+         * Copy up to maxCount RecordIds of a chain from RecordId entry of page pageNo on, backwards unless forward.
+         * pageNo and entry are moved past them, pageNo is UINT32_MAX at the end of the chain. Returns their number.
          */
-        int keyArray[INTARRAYLEAFSIZE];
+        int readOverflow(PageId &pageNo, int &entry, bool forward, RecordId *outRids, int maxCount);
 
-        /**
-         * Stores RecordIds.
+        /*
+         * Find the leaf holding the first key that satisfies key op bound for GT/GTE,
+         * or the last one for LT/LTE
          */
-        RecordId ridArray[INTARRAYLEAFSIZE];
+        template<class T>
+        PageId searchBtree(PageId, bool, const T &bound, Operator op);
+
+        template<class T>
+        void insertEntryTyped(const T &key, const RecordId rid, const char *payload);
 
         /**
-         * Page number of the leaf on the right side.
-           * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+         * Inserts the entry into the right-most leaf without going down the tree, if the entry belongs there
+         * and the leaf has room. Returns false if nothing was inserted.
          */
-        PageId rightSibPageNo;
+        template<class T>
+        bool insertRightmost(const T &key, const RecordId rid, const char *payload);
 
-        LeafNodeInt() {
-            for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
-                keyArray[i] = INT32_MAX;
-                ridArray[i].page_number = UINT32_MAX;
-                ridArray[i].slot_number = UINT16_MAX;
-            }
-            rightSibPageNo = UINT32_MAX;
-        }
-    };
+        /*
+         * payloads holds the payload of every entry by its rid
+         */
+        template<class T>
+        void insertBatchTyped(std::vector<RIDKeyPair<T> > &entries, const RecordPayloads *payloads);
 
+        template<class T>
+        void deleteEntryTyped(const T &key, const RecordId rid);
 
-/**
- * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
- * relation. This index supports only one scan at a time.
-*/
-    class BTreeIndex {
+        template<class T>
+        int lookupTyped(const T &key, std::vector<RecordId> *outRids);
 
-    private:
+        template<class T>
+        int countRangeTyped(const T &lowVal, const Operator lowOp, const T &highVal, const Operator highOp);
 
         /*
-         * Iterate over the relation, and construct the Btree
-         *
+         * countRange by reading the leaves of the range, for an index without subtree counts
          */
-        void constructBtree(const std::string &relationName);
+        template<class T>
+        int countLeafEntries(const T &lowVal, const Operator lowOp, const T &highVal, const Operator highOp);
 
         /*
-         * return key's value
+         * Page number of the leaf holding the smallest keys
          */
-        int getKeyValue(FileIterator &, PageIterator &);
-        /*
-         *
-         */
-        //void allocatePageAndUpdateMap(PageId&,int);
-        void AllocatePageAndSetDefaultValues(PageId &pageNo, Page *&currPage, bool isLeaf);
+        template<class T>
+        PageId firstLeaf();
 
-        bool isRootPageEmpty(NonLeafNodeInt *);
+        template<class T>
+        void selectNthTyped(int n, RecordId &outRid, void *outKey);
 
-        void insertFirstEntryInRoot(NonLeafNodeInt *, int, const RecordId);
+        /*
+         * Open one cursor per part of a parallelScan, returns false if the range is empty
+         */
+        template<class T>
+        bool openScanParts(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp,
+                           std::vector<BTreeScanCursor *> &cursors);
 
-        template<typename T>
-        void writeNodeToPage(T *, PageId, Page *);
+        /*
+         * Number of entries with a key less than key, or less than or equal to it if inclusive
+         */
+        template<class T>
+        int entriesBefore(const T &key, bool inclusive);
 
-        void writeMetaInfoToPage(IndexMetaInfo *, PageId, Page *);
+        /*
+         * entriesBefore by reading the leaves from the first one, for an index without subtree counts
+         */
+        template<class T>
+        int leafEntriesBefore(const T &key, bool inclusive);
 
-        template<typename T>
-        bool isNodeFull(T *, int);
+        /*
+         * Keys of the non-leaf nodes in (lowVal, highVal], from the highest level that has at least wanted of them
+         */
+        template<class T>
+        void rangeSeparators(const T &lowVal, const T &highVal, int wanted, std::vector<T> &separators);
 
-        void copyAndSet(LeafNodeInt *, LeafNodeInt *, int, int);
+        /*
+         * Remove the entry from the subtree, returns false if it is not there.
+         * underfull is set if the node of pageNo has dropped below the minimum fill.
+         */
+        template<class T>
+        bool removeEntry(PageId pageNo, const T &key, const RecordId rid, bool isLeafNode, bool &underfull);
 
-        void copyAndSet(NonLeafNodeInt *, NonLeafNodeInt *, int, int);
+        /*
+         * Bring child c of parent, which is underfull, back to the minimum fill using its sibling
+         */
+        template<class T>
+        void rebalanceChild(NonLeafNode<T> *parent, int c);
 
-        int splitLeafNodeInTwo(LeafNodeInt *newLeafNode, LeafNodeInt *currentNode, RecordId r, int k);
+        /*
+         * Merge right into left or move keys between them. left is child i of parent, right is child i + 1.
+         * Returns true if the nodes were merged, then right is no longer used.
+         */
+        template<class T>
+        bool mergeOrBorrow(LeafNode<T> *left, LeafNode<T> *right, NonLeafNode<T> *parent, int i, bool rightIsUnderfull);
 
-        int splitNonLeafNode(NonLeafNodeInt *newNonLeafNode, NonLeafNodeInt *currentNode, int key, PageId pageId);
+        template<class T>
+        bool mergeOrBorrow(NonLeafNode<T> *left, NonLeafNode<T> *right, NonLeafNode<T> *parent, int i, bool rightIsUnderfull);
 
-        PageId searchBtree(PageId, bool);
 
         /**
            * File object for the index file.
@@ -263,6 +1574,11 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          */
         PageId rootPageNum;
 
+        /**
+         * First page of the list of freed pages, UINT32_MAX if it is empty.
+         */
+        PageId freePageNum;
+
         /**
          * Datatype of attribute over which index is built.
          */
@@ -283,77 +1599,107 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          */
         int nodeOccupancy;
 
+        /**
+         * Format of the non-leaf nodes, a NonLeafFormat.
+         */
+        int nonLeafFormat;
 
-        // MEMBERS SPECIFIC TO SCANNING
+        /**
+         * Attributes of the records stored in the leaves, see IndexOptions::includes.
+         */
+        std::vector<IncludedAttribute> includes;
 
         /**
-         * True if an index scan has been started.
+         * Total length of the included attributes, bytes of payload per leaf entry.
          */
-        bool scanExecuting;
+        int leafPayloadSize;
 
         /**
-         * Index of next entry to be scanned in current leaf being scanned.
+         * Format of the leaves, a LeafFormat.
          */
-        int nextEntry;
+        int leafFormat;
 
         /**
-         * Page number of current page being scanned.
+         * Non-leaf nodes kept pinned while the index is open, by page number.
          */
-        PageId currentPageNum;
+        std::unordered_map<PageId, Page *> residentPages;
 
         /**
-         * Current Page being scanned.
+         * Maximum number of resident non-leaf nodes.
          */
-        Page *currentPageData;
+        int residentPageBudget;
 
         /**
-         * Low INTEGER value for scan.
+         * Number of non-leaf node reads served by the resident nodes.
          */
-        int lowValInt;
+        long long savedBufferLookups;
 
         /**
-         * Low DOUBLE value for scan.
+         * Split policy of inserts.
          */
-        double lowValDouble;
+        SplitPolicy splitPolicy;
 
         /**
-         * Low STRING value for scan.
+         * Right-most leaf, as found by the last insert that went down to it, UINT32_MAX if not known.
+         * Splits and deletes reset it.
          */
-        std::string lowValString;
+        PageId rightmostLeafPageNo;
 
         /**
-         * High INTEGER value for scan.
+         * Non-leaf nodes from the root down to the right-most leaf.
          */
-        int highValInt;
+        std::vector<PageId> rightmostPath;
 
         /**
-         * High DOUBLE value for scan.
+         * Number of inserts that went straight to the right-most leaf.
          */
-        double highValDouble;
+        long long rightmostInserts;
 
         /**
-         * High STRING value for scan.
+         * Maximum number of collected inserts, 0 if inserts are not collected.
          */
-        std::string highValString;
+        int insertBufferCapacity;
 
         /**
-         * Low Operator. Can only be GT(>) or GTE(>=).
+         * Keys of the collected inserts, in the key format of insertBatch.
          */
-        Operator lowOp;
+        std::vector<char> pendingKeys;
 
         /**
-         * High Operator. Can only be LT(<) or LTE(<=).
+         * Record ids of the collected inserts.
          */
-        Operator highOp;
+        std::vector<RecordId> pendingRids;
+
+        /**
+         * Payloads of the collected inserts, leafPayloadSize bytes each.
+         */
+        std::vector<char> pendingPayloads;
+
+        /**
+         * Maximum number of leaves a scan reads ahead.
+         */
+        int readAheadLimit;
+
+        /**
+         * Number of leaves scans read ahead.
+         */
+        long long aheadLeafReads;
+
+
+        // MEMBERS SPECIFIC TO SCANNING
+
+        /**
+         * Cursor of the scan started with startScan, NULL if no such scan is executing.
+         */
+        BTreeScanCursor *scanCursor;
 
     public:
 
         void printBtree();
 
+        template<class T>
         void print(const PageId pageId, int isLeaf, int level);
 
-        std::pair<int, PageId> findPageAndInsert(PageId currPage, const void *key, const RecordId rid, bool);
-
         /**
          * BTreeIndex Constructor.
            * Check to see if the corresponding index file exists. If so, open the file.
@@ -364,10 +1710,12 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          * @param bufMgrIn						Buffer Manager Instance
          * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
          * @param attrType						Datatype of attribute over which index is built
+         * @param options							Build options, used only if the index file gets created
          * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
          */
         BTreeIndex(const std::string &relationName, std::string &outIndexName,
-                   BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+                   BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType,
+                   const IndexOptions &options = IndexOptions());
 
 
         /**
@@ -381,14 +1729,114 @@ at this level are just above the leaf nodes. Otherwise set to 0.
 
         /**
            * Insert a new entry using the pair <value,rid>.
-           * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
+           * Start from root to find out the leaf to insert the entry in, keeping the path to it. The insertion may cause splitting of leaf node.
            * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
            * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
            * Make sure to unpin pages as soon as you can.
+           * With IndexOptions::insertBufferSize set the entry is only collected, see flushInserts.
          * @param key			Key to insert, pointer to integer/double/char string
          * @param rid			Record ID of a record whose entry is getting inserted into the index.
+         * @param payload		payloadSize bytes of included attributes of the record, as written by extractPayload.
+         *                      Only read if the index has included attributes.
+           * @throws BadIndexInfoException If the index has included attributes and payload is NULL.
+          **/
+        const void insertEntry(const void *key, const RecordId rid, const void *payload = NULL);
+
+
+        /**
+           * Insert n entries <keys[j],rids[j]>, with the same result as n calls of insertEntry.
+           * The entries are sorted first, so each leaf, and the path to it, is read once for all the entries that go into it,
+           * as long as the leaf does not have to be split.
+         * @param keys			Array of n keys: int, double, or for a STRING index char[STRINGKEYMAXSIZE] ending at the first NUL byte
+         * @param rids			Record IDs of the records of the keys
+         * @param n				Number of entries
+         * @param payloads		n times payloadSize bytes of included attributes, only read if the index has included attributes
+           * @throws BadIndexInfoException If the index has included attributes and payloads is NULL.
+          **/
+        const void insertBatch(const void *keys, const RecordId *rids, int n, const void *payloads = NULL);
+
+
+        /**
+           * Bytes of included attributes stored with each entry, the total length of IndexOptions::includes.
+           * 0 for an index without included attributes.
+          **/
+        int payloadSize() const;
+
+
+        /**
+           * Copy the included attributes of a record one after the other into payload, the format insertEntry takes
+           * and scanNextBatch returns.
+         * @param record		Bytes of the record
+         * @param length		Length of the record
+         * @param payload		payloadSize bytes
+           * @throws BadIndexInfoException If an included attribute ends past the end of the record.
+          **/
+        void extractPayload(const char *record, std::size_t length, void *payload) const;
+
+
+        /**
+           * Delete the entry <value,rid>.
+           * Start from root to recursively find out the leaf holding the entry. A node that drops below half full
+           * borrows keys from a sibling or is merged with it, which removes a key from the parent, which may in-turn
+           * drop below half full. If the root is left with a single non-leaf child, that child becomes the new root
+           * and metapage is changed accordingly. Pages of merged nodes are reused by later insertions.
+           * A scan that is executing is ended, as the leaf it is on may be merged away.
+         * @param key			Key to delete, pointer to integer/double/char string
+         * @param rid			Record ID of the record whose entry is getting deleted from the index.
+         * @throws  NoSuchKeyFoundException If the index has no entry <key,rid>.
+          **/
+        const void deleteEntry(const void *key, const RecordId rid);
+
+
+        /**
+           * Find the entries with the given key. Start from root to find the leaf holding the first of them,
+           * and copy their record ids. No scan is started, and every page is unpinned before returning.
+         * @param key			Key to look up, pointer to integer/double/char string
+         * @param outRids		Vector the record ids of the entries are appended to
+         * @return Number of entries with the key, 0 if there is none.
+          **/
+        int lookup(const void *key, std::vector<RecordId> &outRids);
+
+
+        /**
+           * Check if the index has an entry with the given key. Same as lookup, but stops at the first entry found.
+         * @param key			Key to look up, pointer to integer/double/char string
+          **/
+        bool contains(const void *key);
+
+
+        /**
+           * Count the entries in a range. With IndexOptions::subtreeCounts the leaves in the middle of it are not visited:
+           * every non-leaf node keeps the number of entries under each of its children, so only the nodes on the paths
+           * to the two ends of the range are read. Without them the leaves of the range are read.
+         * @param lowVal	Low value of range, pointer to integer / double / char string
+         * @param lowOp		Low operator (GT/GTE)
+         * @param highVal	High value of range, pointer to integer / double / char string
+         * @param highOp	High operator (LT/LTE)
+         * @return Number of entries in the range.
+         * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+         * @throws  BadScanrangeException If lowVal > highval
+          **/
+        int countRange(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp);
+
+
+        /**
+           * Number of entries with a key less than the given key, read from the nodes on the path to the key
+           * with IndexOptions::subtreeCounts, else from the leaves up to the key.
+         * @param key			Pointer to integer/double/char string
+          **/
+        int rank(const void *key);
+
+
+        /**
+           * Fetch the entry at position n in key order, counting from 0. With IndexOptions::subtreeCounts the entry
+           * counts of the non-leaf nodes lead straight to the leaf holding it, else the leaves before it are read.
+         * @param n				Position of the entry
+         * @param outRid		Record id of the entry
+         * @param outKey		If not NULL, filled with the key of the entry as in BTreeScanCursor::scanNextBatch
+           * @throws NoSuchKeyFoundException If n is negative or not less than the number of entries.
           **/
-        const void insertEntry(const void *key, const RecordId rid);
+        void selectNth(int n, RecordId &outRid, void *outKey = NULL);
 
 
         /**
@@ -402,11 +1850,58 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          * @param lowOp		Low operator (GT/GTE)
          * @param highVal	High value of range, pointer to integer / double / char string
          * @param highOp	High operator (LT/LTE)
+         * @param order	ASCENDING starts at the low value, DESCENDING starts at the high value and returns the entries in reverse order
          * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
          * @throws  BadScanrangeException If lowVal > highval
            * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
           **/
-        const void startScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp);
+        const void startScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp,
+                             const ScanOrder order = ASCENDING);
+
+
+        /**
+           * Begin a filtered scan of the index that is independent of startScan and of every other open scan.
+           * The scan is set up as in startScan and its state is kept in the returned cursor, which has to be deleted by the caller.
+         * @param lowVal	Low value of range, pointer to integer / double / char string
+         * @param lowOp		Low operator (GT/GTE)
+         * @param highVal	High value of range, pointer to integer / double / char string
+         * @param highOp	High operator (LT/LTE)
+         * @param order	ASCENDING or DESCENDING, as in startScan
+         * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+         * @throws  BadScanrangeException If lowVal > highval
+          **/
+        BTreeScanCursor *openScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp,
+                                  const ScanOrder order = ASCENDING);
+
+
+        /**
+           * Scan a range on several threads. The range is split into one part per sink. With IndexOptions::subtreeCounts
+           * the parts have about the same number of entries each, at keys found through the entry counts of the non-leaf
+           * nodes. Without them the parts start at keys of the non-leaf nodes, and their sizes may differ. All entries
+           * with the same key are in the same part. Every part is scanned by its own thread with its own cursor into its sink, the parts
+           * in key order go to sinks[0], sinks[1], ... The call returns once all parts are scanned.
+           * The index must not be changed, and its buffer manager must not be used by other threads, until then.
+         * @param lowVal	Low value of range, pointer to integer / double / char string
+         * @param lowOp		Low operator (GT/GTE)
+         * @param highVal	High value of range, pointer to integer / double / char string
+         * @param highOp	High operator (LT/LTE)
+         * @param sinks		One sink per thread
+         * @return Number of entries in the range.
+         * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+         * @throws  BadScanrangeException If lowVal > highval
+          **/
+        int parallelScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp,
+                         const std::vector<ScanSink *> &sinks);
+
+
+        /**
+           * Scan a range on numThreads threads as above, and return the record ids of all entries in key order.
+           * The parts are in key order one after the other, so their results are simply put one after the other.
+         * @param outRids	Filled with the record ids of the entries in the range
+         * @return Number of entries in the range.
+          **/
+        int parallelScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp,
+                         int numThreads, std::vector<RecordId> &outRids);
 
 
         /**
@@ -419,6 +1914,52 @@ at this level are just above the leaf nodes. Otherwise set to 0.
         const void scanNext(RecordId &outRid);  // returned record id
 
 
+        /**
+           * Fetch the record ids of the next index entries that match the scan, as many as fit in outRids.
+           * See BTreeScanCursor::scanNextBatch.
+         * @param outRids	Array of at least maxCount record ids, filled with the record ids found
+         * @param maxCount	Maximum number of record ids to fetch
+         * @param outKeys	If not NULL, array of at least maxCount keys filled with the keys found
+         * @param outPayloads	If not NULL, maxCount times payloadSize bytes filled with the included attributes of the entries found
+         * @return Number of record ids fetched. It is less than maxCount only if no more records are left to be scanned.
+           * @throws ScanNotInitializedException If no scan has been initialized.
+          **/
+        int scanNextBatch(RecordId *outRids, int maxCount, void *outKeys = NULL, void *outPayloads = NULL);
+
+
+        /**
+           * Number of buffer manager lookups, each with a pin and an unpin, that descents saved
+           * by finding a non-leaf node among the resident ones, see IndexOptions::residentNonLeafPages.
+          **/
+        long long bufferLookupsSaved() const;
+
+
+        /**
+           * Number of inserts that went straight to the right-most leaf, without searching the non-leaf nodes.
+           * Inserts of keys above all keys in the index do, as long as they do not split the leaf.
+          **/
+        long long rightmostLeafInserts() const;
+
+
+        /**
+           * Number of leaves range scans read into the buffer pool before they reached them,
+           * see IndexOptions::readAheadLeaves, by the scans that have ended.
+          **/
+        long long leavesReadAhead() const;
+
+
+        /**
+           * Insert the entries collected by insertEntry, see IndexOptions::insertBufferSize.
+          **/
+        void flushInserts();
+
+
+        /**
+           * Number of entries collected by insertEntry and not in the tree yet.
+          **/
+        int pendingInserts() const;
+
+
         /**
            * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
            * @throws ScanNotInitializedException If no scan has been initialized.
@@ -5,6 +5,7 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <cstdint>
 #include <memory>
 #include <iostream>
 #include "buffer.h"
@@ -17,9 +18,9 @@ namespace badgerdb {
 
 int BufHashTbl::hash(const File* file, const PageId pageNo)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  // unsigned arithmetic, a pointer truncated to a signed int can make the bucket index negative
+  std::uintptr_t tmp = (std::uintptr_t)file;  // cast of pointer to the file object to an integer
+  int value = (int) ((tmp + pageNo) % HTSIZE);
   return value;
 }
 
@@ -5,7 +5,9 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <cstdlib>
 #include <memory>
+#include <new>
 #include <iostream>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
@@ -30,7 +32,16 @@ BufMgr::BufMgr(std::uint32_t bufs)
   	bufDescTable[i].valid = false;
   }
 
-  bufPool = new Page[bufs];
+  //Frames start on a cache line, so the cache line blocks of B+ tree nodes match the lines of the CPU
+  void *frames = NULL;
+  if (posix_memalign(&frames, 64, bufs * sizeof(Page)) != 0) {
+    throw std::bad_alloc();
+  }
+  bufPool = static_cast<Page *>(frames);
+  for (FrameId i = 0; i < bufs; i++)
+  {
+    new (&bufPool[i]) Page();
+  }
 
   int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
@@ -51,7 +62,11 @@ BufMgr::~BufMgr() {
   }
 
   delete [] bufDescTable;
-  delete [] bufPool;
+  for (std::uint32_t i = 0; i < numBufs; i++)
+  {
+    bufPool[i].~Page();
+  }
+  free(bufPool);
 }
 
 void BufMgr::allocBuf(FrameId & frame) 
@@ -119,6 +134,7 @@ void BufMgr::allocBuf(FrameId & frame)
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
+  std::lock_guard<std::mutex> guard(poolMutex);
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
@@ -154,6 +170,7 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 void BufMgr::unPinPage(File* file, const PageId pageNo, 
 			     const bool dirty) 
 {
+  std::lock_guard<std::mutex> guard(poolMutex);
   // lookup in hashtable
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
@@ -170,6 +187,7 @@ void BufMgr::unPinPage(File* file, const PageId pageNo,
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::lock_guard<std::mutex> guard(poolMutex);
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
@@ -195,6 +213,7 @@ void BufMgr::flushFile(const File* file)
 
 void BufMgr::disposePage(File* file, const PageId pageNo) 
 {
+  std::lock_guard<std::mutex> guard(poolMutex);
 	//Deallocate from file altogether
   //See if it is in the buffer pool
   FrameId frameNo = 0;
@@ -212,6 +231,7 @@ void BufMgr::disposePage(File* file, const PageId pageNo)
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
+  std::lock_guard<std::mutex> guard(poolMutex);
   FrameId frameNo;
 
   // alloc a new frame
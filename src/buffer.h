@@ -10,6 +10,7 @@
 #include "file.h"
 #include "bufHashTbl.h"
 #include <iostream>
+#include <mutex>
 
 namespace badgerdb {
 
@@ -156,7 +157,8 @@ struct BufStats
 
 
 /**
-* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file.
+* The methods that pin, unpin, allocate, flush and dispose pages can be called from several threads at once.
 */
 class BufMgr 
 {
@@ -187,6 +189,13 @@ class BufMgr
   BufStats bufStats;
 
 	/**
+   * Held by readPage, unPinPage, allocPage, flushFile and disposePage, so several threads can read and
+   * unpin pages at the same time. The content of a pinned page is not protected, it stays in its frame
+   * until it is unpinned.
+	 */
+  std::mutex poolMutex;
+
+	/**
 	 * Allocate a free frame.  
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
@@ -6,6 +6,8 @@
  */
 
 #include <vector>
+#include <fstream>
+#include <algorithm>
 #include "btree.h"
 #include "page.h"
 #include "filescan.h"
@@ -19,6 +21,7 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
 
 #define checkPassFail(a, b)                                                                                \
 {                                                                                                                                        \
@@ -45,6 +48,8 @@ const std::string relationName = "relA";
 const int relationSize = 5000;
 const int relationSizeBig = 750000;
 std::string intIndexName, doubleIndexName, stringIndexName;
+//Build options used by the int tests when they create an index
+IndexOptions buildOptions;
 
 // This is the structure for tuples in the base relation
 
@@ -74,20 +79,98 @@ void createRelationBackward();
 void createRelationRandom();
 void createRelationRandomBig();
 void createRelationNegative();
+void createRelationEmpty();
 
 void intTests();
 void intTestsEven();
 void intTestsBig();
 void intTestsNegative();
 void intTestsComplex();
+void intTestsExtremeKeys();
+void intTestsDelete(int numTuples);
+void intTestsCursors();
+void intTestsBatch();
+void intTestsDescending();
+void intTestsLookup();
+void intTestsCounts();
+void intTestsCountsBig(int numTuples);
+void intTestsSmallPool();
+void intTestsResident();
+void intTestsInsertBatch();
+void intTestsAppend();
+void intTestsLeafRids();
+void intTestsDuplicateScans();
+void intTestsIndexOnly();
+void intTestsInsertBuffer();
+void intTestsReadAhead();
+void intTestsParallelScan();
+void intTestsParallelBuild();
+void intTestsKeyExtractor();
+void intTestsBuildErrors();
+void intTestsOddSplit();
+void stringTestsSplits();
+void intTestsLineDirectory();
+void doubleTestsLineDirectory(int numTuples);
+void intTestsIncludes(int numTuples);
+void stringTestsIncludes(int numTuples);
+void intTestsPackedLeaves();
+void intTestsPostingLists();
 
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intBatchScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int batchSize);
+int intDescendingScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int limit, int batchSize);
+int cursorCount(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanOrder order, int batchSize);
+int parallelCount(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int numThreads);
+int includedCount(BTreeScanCursor *cursor, Datatype keyType);
+
+void doubleTests();
+void doubleTestsNegative();
+
+int doubleScan(BTreeIndex *index, double lowVal, Operator lowOp, double highVal, Operator highOp);
+
+void stringTests();
+void stringTestsDelete(int numTuples);
+
+int changeEntries(BTreeIndex *index, int attrByteOffset, int modulus, int remainder, bool insert);
+
+int stringScan(BTreeIndex *index, const std::string &lowVal, Operator lowOp, const std::string &highVal, Operator highOp);
 
 void indexTests();
 void indexTestsEven();
 void indexTestsBig();
 void indexTestsNegative();
 void indexTestsComplex();
+void indexTestsExtremeKeys();
+void indexTestsDouble();
+void indexTestsDoubleNegative();
+void indexTestsString();
+void indexTestsDelete(int numTuples);
+void indexTestsCursors();
+void indexTestsBatch();
+void indexTestsDescending();
+void indexTestsLookup();
+void indexTestsCounts();
+void indexTestsCountsBig(int numTuples);
+void indexTestsSmallPool();
+void indexTestsResident();
+void indexTestsInsertBatch();
+void indexTestsAppend();
+void indexTestsLeafRids();
+void indexTestsDuplicateScans();
+void indexTestsIndexOnly();
+void indexTestsInsertBuffer();
+void indexTestsReadAhead();
+void indexTestsParallelScan();
+void indexTestsParallelBuild();
+void indexTestsKeyExtractor();
+void indexTestsBuildErrors();
+void indexTestsOddSplit();
+void indexTestsStringSplits();
+void indexTestsLineDirectory();
+void indexTestsLineDirectoryDouble(int numTuples);
+void indexTestsIncludes(int numTuples);
+void indexTestsPackedLeaves();
+void indexTestsPostingLists();
 void indexExistsTest();
 
 void test1();
@@ -101,6 +184,43 @@ void test6();
 void test7();
 void test8();
 void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+
+void test31();
+
+void test32();
+
+void test33();
+
+void test34();
+
+void test35();
+
+void test36();
+void test37();
+void test38();
+void test39();
+void test40();
 
 void errorTests();
 
@@ -168,6 +288,37 @@ int main(int argc, char **argv) {
     test7();
     test8();
     test9();
+    test10();
+    test11();
+    test12();
+    test13();
+    test14();
+    test15();
+    test16();
+    test17();
+    test18();
+    test19();
+    test20();
+    test21();
+    test22();
+    test23();
+    test24();
+    test25();
+    test26();
+    test27();
+    test28();
+    test29();
+    test30();
+    test31();
+    test32();
+    test33();
+    test34();
+    test35();
+    test36();
+    test37();
+    test38();
+    test39();
+    test40();
     errorTests();
     try {
         File::remove(intIndexName);
@@ -273,6 +424,466 @@ void test9() {
     indexTests();
     deleteRelation();
 }
+
+void test10() {
+    // Build the index by inserting tuples one by one instead of bulk loading, on relations in forward,
+    // random and big forward order, and perform index tests on attributes of type int
+    std::cout << "--------------------" << std::endl;
+    std::cout << "insertEntry build" << std::endl;
+    buildOptions.bulkLoad = false;
+    createRelationForward();
+    indexTests();
+    deleteRelation();
+    createRelationRandom();
+    indexTestsComplex();
+    deleteRelation();
+    createRelationForwardBig();
+    indexTestsBig();
+    deleteRelation();
+    buildOptions = IndexOptions();
+}
+
+void test11() {
+    // Bulk load half full nodes, so the tree gets deeper, on an even valued and a big relation
+    // and perform index tests on attributes of type int
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bulk load with fill factor 0.5" << std::endl;
+    buildOptions.fillFactor = 0.5;
+    createRelationForwardEven();
+    indexTestsEven();
+    deleteRelation();
+    createRelationForwardBig();
+    indexTestsBig();
+    deleteRelation();
+    buildOptions = IndexOptions();
+}
+
+void test12() {
+    // Create a relation with tuples valued 0 to relationSize, insert the smallest and the largest int
+    // as keys and perform index tests on attributes of type int, for a bulk loaded and an inserted index
+    std::cout << "--------------------" << std::endl;
+    std::cout << "extreme int keys" << std::endl;
+    createRelationForward();
+    indexTestsExtremeKeys();
+    buildOptions.bulkLoad = false;
+    indexTestsExtremeKeys();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test13() {
+    // Create relations with tuples valued 0 to relationSize, in forward and random order, and with tuples
+    // valued 0.01 to relationSize / 100, and perform index tests on attributes of type double,
+    // for bulk loaded and inserted indexes
+    std::cout << "--------------------" << std::endl;
+    std::cout << "double keys" << std::endl;
+    createRelationForward();
+    indexTestsDouble();
+    buildOptions.bulkLoad = false;
+    indexTestsDouble();
+    deleteRelation();
+    createRelationRandom();
+    indexTestsDouble();
+    buildOptions = IndexOptions();
+    indexTestsDouble();
+    deleteRelation();
+    createRelationNegative();
+    indexTestsDoubleNegative();
+    deleteRelation();
+}
+
+void test14() {
+    // Create relations with tuples valued 0 to relationSize, in forward and random order, and perform
+    // index tests on the string attribute, for bulk loaded and inserted indexes
+    std::cout << "--------------------" << std::endl;
+    std::cout << "string keys" << std::endl;
+    createRelationForward();
+    indexTestsString();
+    buildOptions.bulkLoad = false;
+    indexTestsString();
+    deleteRelation();
+    createRelationRandom();
+    indexTestsString();
+    buildOptions = IndexOptions();
+    indexTestsString();
+    deleteRelation();
+}
+
+void test15() {
+    // Delete half and then all of the entries of int and string indexes and insert them again,
+    // for bulk loaded and inserted indexes, on a small relation and on one whose trees have several non-leaf levels
+    std::cout << "--------------------" << std::endl;
+    std::cout << "delete entries" << std::endl;
+    createRelationForward();
+    indexTestsDelete(relationSize);
+    buildOptions.bulkLoad = false;
+    indexTestsDelete(relationSize);
+    deleteRelation();
+    createRelationForwardBig();
+    indexTestsDelete(relationSizeBig);
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test16() {
+    // Create a relation with tuples valued 0 to relationSize and run overlapping scans through
+    // cursors of the same index, for a bulk loaded and an inserted index
+    std::cout << "--------------------" << std::endl;
+    std::cout << "scan cursors" << std::endl;
+    createRelationForward();
+    indexTestsCursors();
+    buildOptions.bulkLoad = false;
+    indexTestsCursors();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test17() {
+    // Create relations with tuples valued 0 to relationSize, in forward and random order, and fetch
+    // the record ids of int index scans in batches, for bulk loaded and inserted indexes
+    std::cout << "--------------------" << std::endl;
+    std::cout << "batched scans" << std::endl;
+    createRelationForward();
+    indexTestsBatch();
+    deleteRelation();
+    createRelationRandom();
+    buildOptions.bulkLoad = false;
+    indexTestsBatch();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test18() {
+    // Create relations with tuples valued 0 to relationSize, in forward and random order, and scan
+    // int indexes from the high bound down, for bulk loaded and inserted indexes
+    std::cout << "--------------------" << std::endl;
+    std::cout << "descending scans" << std::endl;
+    createRelationForward();
+    indexTestsDescending();
+    deleteRelation();
+    createRelationRandom();
+    buildOptions.bulkLoad = false;
+    indexTestsDescending();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test19() {
+    // Create a relation with tuples valued 0 to relationSize and look up single keys, present, missing
+    // and duplicated over several leaves, for a bulk loaded and an inserted index
+    std::cout << "--------------------" << std::endl;
+    std::cout << "point lookups" << std::endl;
+    createRelationForward();
+    indexTestsLookup();
+    buildOptions.bulkLoad = false;
+    indexTestsLookup();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test20() {
+    // Create relations with tuples valued 0 to relationSize, in forward and random order, and answer range
+    // counts, ranks and positions from the entry counts, before and after deleting half of the entries,
+    // then from the leaves of an index without entry counts
+    std::cout << "--------------------" << std::endl;
+    std::cout << "range counts, rank and select" << std::endl;
+    buildOptions.subtreeCounts = true;
+    createRelationForward();
+    indexTestsCounts();
+    indexTestsString();
+    deleteRelation();
+    createRelationRandom();
+    buildOptions.bulkLoad = false;
+    indexTestsCounts();
+    indexTestsString();
+    buildOptions.subtreeCounts = false;
+    indexTestsCounts();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test21() {
+    // Create a relation with tuples valued 0 to relationSize in random order and insert them one by one
+    // into an index whose buffer pool has only a few frames
+    std::cout << "--------------------" << std::endl;
+    std::cout << "inserts through a small buffer pool" << std::endl;
+    createRelationRandom();
+    indexTestsSmallPool();
+    deleteRelation();
+}
+
+void test22() {
+    // Create a relation with tuples valued 0 to relationSize and keep the upper non-leaf nodes of its index
+    // resident, with sparse nodes so the tree has more than one non-leaf level
+    std::cout << "--------------------" << std::endl;
+    std::cout << "resident non-leaf nodes" << std::endl;
+    createRelationForward();
+    buildOptions.fillFactor = 0.1;
+    buildOptions.residentNonLeafPages = 2;
+    indexTestsResident();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test23() {
+    // Create a relation with tuples valued 0 to relationSize in random order and insert them into the index
+    // in batches
+    std::cout << "--------------------" << std::endl;
+    std::cout << "batched inserts" << std::endl;
+    createRelationRandom();
+    indexTestsInsertBatch();
+    deleteRelation();
+}
+
+void test24() {
+    // Create a relation with tuples valued 0 to relationSize and insert them one by one in increasing order,
+    // splitting evenly and then with append splits
+    std::cout << "--------------------" << std::endl;
+    std::cout << "append splits" << std::endl;
+    createRelationForward();
+    buildOptions.bulkLoad = false;
+    indexTestsAppend();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test25() {
+    // Create a relation with tuples valued 0 to relationSize and store record ids with large page numbers
+    // in the leaves of its index
+    std::cout << "--------------------" << std::endl;
+    std::cout << "leaf record ids" << std::endl;
+    createRelationForward();
+    indexTestsLeafRids();
+    deleteRelation();
+}
+
+void test26() {
+    // Create a relation with tuples valued 0 to relationSize and scan a key with duplicates spanning several leaves
+    std::cout << "--------------------" << std::endl;
+    std::cout << "duplicate key scans" << std::endl;
+    createRelationForward();
+    indexTestsDuplicateScans();
+    deleteRelation();
+}
+
+void test27() {
+    // Create a relation with tuples valued 0 to relationSize and answer queries on the indexed attribute
+    // from the index alone
+    std::cout << "--------------------" << std::endl;
+    std::cout << "index-only scans" << std::endl;
+    createRelationForward();
+    indexTestsIndexOnly();
+    deleteRelation();
+}
+
+void test28() {
+    // Create a relation with tuples valued 0 to relationSize in random order and collect inserts in memory
+    // before they go into the index
+    std::cout << "--------------------" << std::endl;
+    std::cout << "collected inserts" << std::endl;
+    createRelationRandom();
+    buildOptions.insertBufferSize = 768;
+    indexTestsInsertBuffer();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test29() {
+    // Create a relation with tuples valued 0 to relationSize and check that range scans over several leaves
+    // read the leaves ahead, but not past the end of the range
+    std::cout << "--------------------" << std::endl;
+    std::cout << "scan read-ahead" << std::endl;
+    createRelationForward();
+    indexTestsReadAhead();
+    deleteRelation();
+}
+
+void test30() {
+    // Create a relation with tuples valued 0 to relationSize in random order and scan ranges of the index
+    // on several threads
+    std::cout << "--------------------" << std::endl;
+    std::cout << "parallel scans" << std::endl;
+    createRelationRandom();
+    indexTestsParallelScan();
+    buildOptions.subtreeCounts = true;
+    indexTestsParallelScan();
+    buildOptions = IndexOptions();
+    deleteRelation();
+}
+
+void test31() {
+    // Bulk load on several threads, on a relation in random order and a big relation in random order,
+    // and perform index tests on attributes of type int, double and string
+    std::cout << "--------------------" << std::endl;
+    std::cout << "parallel bulk load" << std::endl;
+    buildOptions.buildThreads = 4;
+    createRelationRandom();
+    indexTests();
+    indexTestsDouble();
+    indexTestsString();
+    indexTestsParallelBuild();
+    deleteRelation();
+    createRelationRandomBig();
+    indexTestsBig();
+    deleteRelation();
+    buildOptions = IndexOptions();
+}
+
+void test32() {
+    // Create a relation with tuples valued 0 to relationSize and build indexes on keys read from the records
+    // by a key extractor, bulk loaded, on several threads and inserted
+    std::cout << "--------------------" << std::endl;
+    std::cout << "key extractors" << std::endl;
+    createRelationForward();
+    indexTestsKeyExtractor();
+    deleteRelation();
+}
+
+void test33() {
+    // Create a relation with tuples valued 0 to relationSize, open an existing index with build options that
+    // are out of range and build indexes that fail part way
+    std::cout << "--------------------" << std::endl;
+    std::cout << "index build errors" << std::endl;
+    createRelationForward();
+    indexTestsBuildErrors();
+    deleteRelation();
+}
+
+void test34() {
+    // Start from an empty relation, fill a leaf of the integer index and insert the key that goes
+    // in the middle of it, so the leaf splits at its midpoint
+    std::cout << "--------------------" << std::endl;
+    std::cout << "leaf split at the midpoint" << std::endl;
+    createRelationEmpty();
+    indexTestsOddSplit();
+    deleteRelation();
+}
+
+void test35() {
+    // Start from an empty relation and insert, then delete, enough random STRING keys of 0 to 64 bytes
+    // to split many leaves at an odd number of keys
+    std::cout << "--------------------" << std::endl;
+    std::cout << "string leaf splits" << std::endl;
+    createRelationEmpty();
+    indexTestsStringSplits();
+    deleteRelation();
+}
+
+void test36() {
+    // Build int and double indexes whose non-leaf nodes have a line directory, bulk loaded and inserted,
+    // delete from a big one, and reopen one without the option
+    std::cout << "--------------------" << std::endl;
+    std::cout << "line directory non-leaf nodes" << std::endl;
+    buildOptions.lineDirectory = true;
+    createRelationForward();
+    indexTests();
+    indexTestsDouble();
+    indexTestsLineDirectory();
+    deleteRelation();
+    createRelationRandom();
+    buildOptions.bulkLoad = false;
+    indexTestsComplex();
+    indexTestsDouble();
+    deleteRelation();
+    buildOptions.bulkLoad = true;
+    createRelationForwardBig();
+    indexTestsDelete(relationSizeBig);
+    indexTestsLineDirectoryDouble(relationSizeBig);
+    deleteRelation();
+    buildOptions = IndexOptions();
+}
+
+void test37() {
+    // Keep entry counts in the non-leaf nodes of int and string indexes on a big relation while half of
+    // the entries are deleted and inserted again, and scan a range in parts split at non-leaf keys
+    std::cout << "--------------------" << std::endl;
+    std::cout << "subtree counts" << std::endl;
+    buildOptions.subtreeCounts = true;
+    createRelationForwardBig();
+    indexTestsCountsBig(relationSizeBig);
+    indexTestsDelete(relationSizeBig);
+    buildOptions.subtreeCounts = false;
+    indexTestsCountsBig(relationSizeBig);
+    deleteRelation();
+    buildOptions = IndexOptions();
+}
+
+void test38() {
+    // Store the double field and a prefix of the string field in the leaves of int and string indexes,
+    // bulk loaded and inserted, and check the values scans return while entries are deleted and inserted again
+    std::cout << "--------------------" << std::endl;
+    std::cout << "included attributes" << std::endl;
+    IncludedAttribute d = {(int) offsetof(tuple, d), (int) sizeof(double)};
+    IncludedAttribute prefix = {(int) offsetof(tuple, s), 5};
+    buildOptions.includes.push_back(d);
+    buildOptions.includes.push_back(prefix);
+    buildOptions.buildThreads = 4;
+    createRelationForward();
+    indexTestsIncludes(relationSize);
+    deleteRelation();
+    buildOptions.buildThreads = 1;
+    buildOptions.bulkLoad = false;
+    createRelationRandom();
+    indexTestsIncludes(relationSize);
+    buildOptions.insertBufferSize = 100;
+    indexTestsIncludes(relationSize);
+    deleteRelation();
+    buildOptions = IndexOptions();
+}
+
+void test39() {
+    // Build int indexes with packed leaves, bulk loaded and inserted, insert a far rid into one with subtree counts,
+    // and delete from a big one
+    std::cout << "--------------------" << std::endl;
+    std::cout << "packed leaves" << std::endl;
+    buildOptions.packedLeaves = true;
+    createRelationForward();
+    indexTests();
+    indexTestsExtremeKeys();
+    buildOptions.subtreeCounts = true;
+    indexTestsPackedLeaves();
+    buildOptions.subtreeCounts = false;
+    deleteRelation();
+    createRelationRandom();
+    buildOptions.bulkLoad = false;
+    indexTestsComplex();
+    indexTestsDescending();
+    deleteRelation();
+    buildOptions.bulkLoad = true;
+    buildOptions.subtreeCounts = true;
+    createRelationForwardBig();
+    indexTestsDelete(relationSizeBig);
+    indexTestsCountsBig(relationSizeBig);
+    deleteRelation();
+    buildOptions = IndexOptions();
+}
+
+void test40() {
+    // Build int indexes with posting lists, with unique keys and with keys whose lists move to overflow pages,
+    // bulk loaded and inserted, and delete from a big one
+    std::cout << "--------------------" << std::endl;
+    std::cout << "posting lists" << std::endl;
+    buildOptions.postingLists = true;
+    createRelationForward();
+    indexTests();
+    indexTestsDuplicateScans();
+    buildOptions.subtreeCounts = true;
+    indexTestsPostingLists();
+    buildOptions.subtreeCounts = false;
+    deleteRelation();
+    createRelationRandom();
+    buildOptions.bulkLoad = false;
+    indexTestsComplex();
+    indexTestsDescending();
+    deleteRelation();
+    buildOptions.bulkLoad = true;
+    buildOptions.subtreeCounts = true;
+    createRelationForwardBig();
+    indexTestsDelete(relationSizeBig);
+    deleteRelation();
+    buildOptions = IndexOptions();
+}
+
 // -----------------------------------------------------------------------------
 // createRelationForward
 // -----------------------------------------------------------------------------
@@ -538,6 +1149,21 @@ void createRelationRandom() {
     file1->writePage(new_page_number, new_page);
 }
 
+// -----------------------------------------------------------------------------
+// createRelationEmpty
+// -----------------------------------------------------------------------------
+
+void createRelationEmpty() {
+    // destroy any old copies of relation file
+    try {
+        File::remove(relationName);
+    }
+    catch (FileNotFoundException e) {
+    }
+
+    file1 = new PageFile(relationName, true);
+}
+
 // -----------------------------------------------------------------------------
 // createRelationRandomBig
 // -----------------------------------------------------------------------------
@@ -669,101 +1295,1864 @@ void indexTestsComplex() {
         }
     }
 }
-void indexExistsTest() {
+void indexTestsExtremeKeys() {
     if (testNum == 1) {
-        intTests();
+        intTestsExtremeKeys();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
     }
 }
-// -----------------------------------------------------------------------------
-// intTests
-// -----------------------------------------------------------------------------
 
-void intTests() {
-    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+void indexTestsDouble() {
+    if (testNum == 1) {
+        doubleTests();
+        try {
+            File::remove(doubleIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
 
-    // run some tests
-    checkPassFail(intScan(&index, 1, GT, 19, LT), 17)
-    checkPassFail(intScan(&index, 20, GTE, 35, LTE), 16)
-    checkPassFail(intScan(&index, -3, GT, 3, LT), 3)
-    checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
-    checkPassFail(intScan(&index, 0, GT, 1, LT), 0)
-    checkPassFail(intScan(&index, 300, GT, 400, LT), 99)
-    checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 1000)
+void indexTestsDoubleNegative() {
+    if (testNum == 1) {
+        doubleTestsNegative();
+        try {
+            File::remove(doubleIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
 }
 
-// -----------------------------------------------------------------------------
-// intTests
+void indexTestsString() {
+    if (testNum == 1) {
+        stringTests();
+        try {
+            File::remove(stringIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsDelete(int numTuples) {
+    if (testNum == 1) {
+        intTestsDelete(numTuples);
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+        stringTestsDelete(numTuples);
+        try {
+            File::remove(stringIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsCursors() {
+    if (testNum == 1) {
+        intTestsCursors();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsBatch() {
+    if (testNum == 1) {
+        intTestsBatch();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsDescending() {
+    if (testNum == 1) {
+        intTestsDescending();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsLookup() {
+    if (testNum == 1) {
+        intTestsLookup();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsCounts() {
+    if (testNum == 1) {
+        intTestsCounts();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsCountsBig(int numTuples) {
+    if (testNum == 1) {
+        intTestsCountsBig(numTuples);
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsSmallPool() {
+    if (testNum == 1) {
+        intTestsSmallPool();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsResident() {
+    if (testNum == 1) {
+        intTestsResident();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsInsertBatch() {
+    if (testNum == 1) {
+        intTestsInsertBatch();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsAppend() {
+    if (testNum == 1) {
+        intTestsAppend();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsLeafRids() {
+    if (testNum == 1) {
+        intTestsLeafRids();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsDuplicateScans() {
+    if (testNum == 1) {
+        intTestsDuplicateScans();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsIndexOnly() {
+    if (testNum == 1) {
+        intTestsIndexOnly();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsInsertBuffer() {
+    if (testNum == 1) {
+        intTestsInsertBuffer();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsReadAhead() {
+    if (testNum == 1) {
+        intTestsReadAhead();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsParallelScan() {
+    if (testNum == 1) {
+        intTestsParallelScan();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsParallelBuild() {
+    if (testNum == 1) {
+        intTestsParallelBuild();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsKeyExtractor() {
+    if (testNum == 1) {
+        intTestsKeyExtractor();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsBuildErrors() {
+    if (testNum == 1) {
+        intTestsBuildErrors();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsOddSplit() {
+    if (testNum == 1) {
+        intTestsOddSplit();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsStringSplits() {
+    if (testNum == 1) {
+        stringTestsSplits();
+        try {
+            File::remove(stringIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsLineDirectory() {
+    if (testNum == 1) {
+        intTestsLineDirectory();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsPackedLeaves() {
+    if (testNum == 1) {
+        intTestsPackedLeaves();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsPostingLists() {
+    if (testNum == 1) {
+        intTestsPostingLists();
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsLineDirectoryDouble(int numTuples) {
+    if (testNum == 1) {
+        doubleTestsLineDirectory(numTuples);
+        try {
+            File::remove(doubleIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexTestsIncludes(int numTuples) {
+    if (testNum == 1) {
+        intTestsIncludes(numTuples);
+        try {
+            File::remove(intIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+        stringTestsIncludes(numTuples);
+        try {
+            File::remove(stringIndexName);
+        }
+        catch (FileNotFoundException e) {
+        }
+    }
+}
+
+void indexExistsTest() {
+    if (testNum == 1) {
+        intTests();
+    }
+}
+// -----------------------------------------------------------------------------
+// intTests
+// -----------------------------------------------------------------------------
+
+void intTests() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // run some tests
+    checkPassFail(intScan(&index, 1, GT, 19, LT), 17)
+    checkPassFail(intScan(&index, 20, GTE, 35, LTE), 16)
+    checkPassFail(intScan(&index, -3, GT, 3, LT), 3)
+    checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
+    checkPassFail(intScan(&index, 0, GT, 1, LT), 0)
+    checkPassFail(intScan(&index, 300, GT, 400, LT), 99)
+    checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 1000)
+}
+
+// -----------------------------------------------------------------------------
+// intTests
+// -----------------------------------------------------------------------------
+
+void intTestsEven() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // run some tests
+    checkPassFail(intScan(&index, 1, GT, 19, LT), 9)
+    checkPassFail(intScan(&index, 20, GTE, 35, LTE), 8)
+    checkPassFail(intScan(&index, -3, GT, 3, LT), 2)
+    checkPassFail(intScan(&index, 996, GT, 1001, LT), 2)
+    checkPassFail(intScan(&index, 0, GT, 1, LT), 0)
+    checkPassFail(intScan(&index, 300, GT, 400, LT), 49)
+    checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 500)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsBig
+// -----------------------------------------------------------------------------
+
+void intTestsBig() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // run some tests
+    checkPassFail(intScan(&index, 1, GT, 19, LT), 17)
+    checkPassFail(intScan(&index, 20, GTE, 35, LTE), 16)
+    checkPassFail(intScan(&index, -3, GT, 3, LT), 3)
+    checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
+    checkPassFail(intScan(&index, 0, GT, 1, LT), 0)
+    checkPassFail(intScan(&index, 300, GT, 400, LT), 99)
+    checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 1000)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsNegative
+// -----------------------------------------------------------------------------
+
+void intTestsNegative() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // run some tests
+    checkPassFail(intScan(&index, -19, GT, -1, LT), 17)
+    checkPassFail(intScan(&index, -35, GTE, -20, LTE), 16)
+    checkPassFail(intScan(&index, -4, GT, 3, LT), 3)
+    checkPassFail(intScan(&index, -1001, GT, -996, LT), 4)
+    checkPassFail(intScan(&index, 0, GT, 1, LT), 0)
+    checkPassFail(intScan(&index, -400, GT, -300, LT), 99)
+    checkPassFail(intScan(&index, -4000, GTE, -3000, LT), 1000)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsComplex
+// -----------------------------------------------------------------------------
+
+void intTestsComplex() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // run some tests
+    checkPassFail(intScan(&index, 1, GT, 1, LTE), 0)
+    checkPassFail(intScan(&index, 1, GTE, 1, LT), 0)
+    checkPassFail(intScan(&index, 5000, GTE, 50001, LTE), 0)
+    checkPassFail(intScan(&index, 4999, GTE, 5000, LTE), 1)
+    checkPassFail(intScan(&index, 4999, GT, 5000, LTE), 0)
+    checkPassFail(intScan(&index, 4999, GT, 5000, LT), 0)
+    checkPassFail(intScan(&index, 0, GT, 2, LT), 1)
+    checkPassFail(intScan(&index, 0, GT, 2, LTE), 2)
+    checkPassFail(intScan(&index, -1, GT, 2, LTE), 3)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsExtremeKeys
+// -----------------------------------------------------------------------------
+
+void intTestsExtremeKeys() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // Index the record of key 0 a second time, under the smallest and the largest int
+    RecordId keyRid;
+    int zero = 0;
+    index.startScan(&zero, GTE, &zero, LTE);
+    index.scanNext(keyRid);
+    index.endScan();
+    int minKey = INT32_MIN;
+    int maxKey = INT32_MAX;
+    index.insertEntry(&minKey, keyRid);
+    index.insertEntry(&maxKey, keyRid);
+
+    // run some tests
+    checkPassFail(intScan(&index, INT32_MAX - 1, GT, INT32_MAX, LTE), 1)
+    checkPassFail(intScan(&index, INT32_MAX, GTE, INT32_MAX, LTE), 1)
+    checkPassFail(intScan(&index, 4990, GT, INT32_MAX, LT), 9)
+    checkPassFail(intScan(&index, 4990, GT, INT32_MAX, LTE), 10)
+    checkPassFail(intScan(&index, INT32_MIN, GTE, 0, LT), 1)
+    checkPassFail(intScan(&index, INT32_MIN, GT, 0, LTE), 1)
+    checkPassFail(intScan(&index, INT32_MIN, GTE, INT32_MAX, LTE), relationSize + 2)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsDelete
+// -----------------------------------------------------------------------------
+
+void intTestsDelete(int numTuples) {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // delete the even keys, then entries that are not in the index any more or never were
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, false), numTuples / 2)
+    checkPassFail(intScan(&index, 25, GT, 40, LT), 7)
+    checkPassFail(intScan(&index, 0, GTE, numTuples, LT), numTuples / 2)
+    int missingDeletes = 0;
+    int zero = 0;
+    int one = 1;
+    RecordId wrongRid = {1, 1};
+    try {
+        index.deleteEntry(&zero, wrongRid);
+    }
+    catch (NoSuchKeyFoundException e) {
+        missingDeletes++;
+    }
+    try {
+        // key 1 is in the index, but it belongs to a different record
+        index.deleteEntry(&one, wrongRid);
+    }
+    catch (NoSuchKeyFoundException e) {
+        missingDeletes++;
+    }
+    checkPassFail(missingDeletes, 2)
+
+    // delete the rest, which empties the tree, and fill it again
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 1, false), numTuples / 2)
+    checkPassFail(intScan(&index, 0, GTE, numTuples, LT), 0)
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 1, 0, true), numTuples)
+    checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+    checkPassFail(intScan(&index, 0, GTE, numTuples, LT), numTuples)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsCursors
+// -----------------------------------------------------------------------------
+
+void intTestsCursors() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // open 20 cursors on [50 * k, 50 * k + 100) and advance them in turns, each one record at a time
+    const int numCursors = 20;
+    std::vector<BTreeScanCursor *> cursors;
+    std::vector<int> numResults(numCursors, 0);
+    for (int k = 0; k < numCursors; k++) {
+        int lowVal = 50 * k;
+        int highVal = lowVal + 100;
+        cursors.push_back(index.openScan(&lowVal, GTE, &highVal, LT));
+    }
+    int numOpen = numCursors;
+    std::vector<bool> completed(numCursors, false);
+    while (numOpen > 0) {
+        for (int k = 0; k < numCursors; k++) {
+            if (completed[k]) {
+                continue;
+            }
+            try {
+                RecordId scanRid;
+                cursors[k]->scanNext(scanRid);
+                numResults[k]++;
+            }
+            catch (IndexScanCompletedException e) {
+                completed[k] = true;
+                numOpen--;
+            }
+        }
+    }
+    int numFull = 0;
+    for (int k = 0; k < numCursors; k++) {
+        if (numResults[k] == 100) {
+            numFull++;
+        }
+    }
+    checkPassFail(numFull, numCursors)
+
+    // the scan of startScan runs next to the open cursors
+    checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+    for (int k = 0; k < numCursors; k++) {
+        delete cursors[k];
+    }
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsBatch
+// -----------------------------------------------------------------------------
+
+void intTestsBatch() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // run some tests, with batches smaller and larger than a leaf
+    checkPassFail(intBatchScan(&index, 25, GT, 40, LT, 100), 14)
+    checkPassFail(intBatchScan(&index, 20, GTE, 35, LTE, 1), 16)
+    checkPassFail(intBatchScan(&index, 996, GT, 1001, LT, 3), 4)
+    checkPassFail(intBatchScan(&index, 3000, GTE, 4000, LT, 64), 1000)
+    checkPassFail(intBatchScan(&index, 0, GTE, relationSize, LT, 1000), relationSize)
+    checkPassFail(intBatchScan(&index, 0, GT, 1, LT, 10), 0)
+    checkPassFail(intBatchScan(&index, 5000, GTE, 5010, LT, 10), 0)
+}
+
+// Scan through scanNextBatch, returns the number of record ids, or -1 if the keys are not consecutive
+int intBatchScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int batchSize) {
+    std::cout << "Batch scan for ";
+    if (lowOp == GT) { std::cout << "("; } else { std::cout << "["; }
+    std::cout << lowVal << "," << highVal;
+    if (highOp == LT) { std::cout << ")"; } else { std::cout << "]"; }
+    std::cout << " in batches of " << batchSize << std::endl;
+
+    std::vector<RecordId> rids(batchSize);
+    std::vector<int> keys(batchSize);
+    int expectedKey = lowOp == GT ? lowVal + 1 : lowVal;
+    int numResults = 0;
+    index->startScan(&lowVal, lowOp, &highVal, highOp);
+    while (1) {
+        int count = index->scanNextBatch(&rids[0], batchSize, &keys[0]);
+        for (int i = 0; i < count; i++) {
+            if (keys[i] != expectedKey) {
+                std::cout << "Key " << keys[i] << " found, expected " << expectedKey << std::endl;
+                index->endScan();
+                return -1;
+            }
+            expectedKey++;
+        }
+        numResults += count;
+        if (count < batchSize) {
+            break;
+        }
+    }
+    index->endScan();
+
+    std::cout << "Number of results: " << numResults << std::endl << std::endl;
+    return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// intTestsLookup
+// -----------------------------------------------------------------------------
+
+void intTestsLookup() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // every key once, with the record id of its tuple
+    int numFound = 0;
+    for (int key = 0; key < relationSize; key++) {
+        std::vector<RecordId> rids;
+        if (index.lookup(&key, rids) != 1 || rids.size() != 1) {
+            continue;
+        }
+        Page *curPage;
+        bufMgr->readPage(file1, rids[0].page_number, curPage);
+        RECORD myRec = *(reinterpret_cast<const RECORD *>(curPage->getRecord(rids[0]).data()));
+        bufMgr->unPinPage(file1, rids[0].page_number, false);
+        if (myRec.i == key) {
+            numFound++;
+        }
+    }
+    checkPassFail(numFound, relationSize)
+
+    // missing keys
+    std::vector<RecordId> rids;
+    int below = -1;
+    int above = relationSize;
+    checkPassFail(index.lookup(&below, rids) + index.lookup(&above, rids), 0)
+    int zero = 0;
+    checkPassFail((index.contains(&zero) && !index.contains(&above)), true)
+
+    // duplicates of a key spread over more than one leaf
+    int dupKey = 100;
+    int numDuplicates = 1000;
+    for (int k = 0; k < numDuplicates; k++) {
+        RecordId rid = {1, (SlotId) k};
+        index.insertEntry(&dupKey, rid);
+    }
+    checkPassFail(index.lookup(&dupKey, rids), numDuplicates + 1)
+    int before = dupKey - 1;
+    int after = dupKey + 1;
+    checkPassFail(index.lookup(&before, rids) + index.lookup(&after, rids), 2)
+    checkPassFail((int) rids.size(), numDuplicates + 3)
+    checkPassFail(index.contains(&dupKey), true)
+    // a scan is not disturbed by lookups
+    checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsCounts
+// -----------------------------------------------------------------------------
+
+void intTestsCounts() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    int low = 25;
+    int high = 40;
+    checkPassFail(index.countRange(&low, GT, &high, LT), 14)
+    checkPassFail(index.countRange(&low, GTE, &high, LTE), 16)
+    low = 0;
+    high = relationSize;
+    checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize)
+    low = -100;
+    checkPassFail(index.countRange(&low, GT, &high, LTE), relationSize)
+    low = 5000;
+    high = 5010;
+    checkPassFail(index.countRange(&low, GTE, &high, LT), 0)
+    low = 1000;
+    high = 1000;
+    checkPassFail(index.countRange(&low, GT, &high, LT), 0)
+
+    // key k is at position k
+    int numRight = 0;
+    for (int key = 0; key < relationSize; key += 7) {
+        RecordId rid;
+        int foundKey;
+        index.selectNth(key, rid, &foundKey);
+        if (index.rank(&key) == key && foundKey == key) {
+            numRight++;
+        }
+    }
+    checkPassFail(numRight, (relationSize + 6) / 7)
+    int missing = 0;
+    try {
+        RecordId rid;
+        index.selectNth(relationSize, rid);
+    }
+    catch (NoSuchKeyFoundException e) {
+        missing++;
+    }
+    checkPassFail(missing, 1)
+
+    // the counts follow deletes, which merge nodes
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, false), relationSize / 2)
+    low = 25;
+    high = 40;
+    checkPassFail(index.countRange(&low, GT, &high, LT), 7)
+    low = 0;
+    high = relationSize;
+    checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize / 2)
+    int key = 1001;
+    checkPassFail(index.rank(&key), 500)
+    RecordId rid;
+    int foundKey;
+    index.selectNth(500, rid, &foundKey);
+    checkPassFail(foundKey, 1001)
+
+    // and inserts, which split them
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, true), relationSize / 2)
+    checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize)
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+}
+
+void intTestsCountsBig(int numTuples) {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    int low = 0;
+    int high = numTuples;
+    checkPassFail(index.countRange(&low, GTE, &high, LT), numTuples)
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, false), numTuples / 2)
+    checkPassFail(index.countRange(&low, GTE, &high, LT), numTuples / 2)
+    low = 100000;
+    high = 300000;
+    checkPassFail(index.countRange(&low, GT, &high, LTE), 100000)
+    int key = 100001;
+    checkPassFail(index.rank(&key), 50000)
+    RecordId rid;
+    int foundKey;
+    index.selectNth(numTuples / 2 - 1, rid, &foundKey);
+    checkPassFail(foundKey, numTuples - 1)
+    // the parts start at keys of many non-leaf nodes
+    checkPassFail(parallelCount(&index, 0, GTE, numTuples, LT, 8), numTuples / 2)
+    checkPassFail(parallelCount(&index, 100000, GT, 300000, LTE, 3), 100000)
+
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, true), numTuples / 2)
+    low = 0;
+    high = numTuples;
+    checkPassFail(index.countRange(&low, GTE, &high, LT), numTuples)
+    checkPassFail(parallelCount(&index, 0, GTE, numTuples, LT, 8), numTuples)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsSmallPool
+// -----------------------------------------------------------------------------
+
+void intTestsSmallPool() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    // the metapage and the root stay pinned, an insert pins its leaf, the new leaf, the right sibling of the
+    // leaf and the non-leaf nodes a split can reach
+    BufMgr smallBufMgr(6);
+    IndexOptions options;
+    options.bulkLoad = false;
+    {
+        BTreeIndex index(relationName, intIndexName, &smallBufMgr, offsetof(tuple, i), INTEGER, options);
+        checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+        checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+        int low = 0;
+        int high = relationSize;
+        checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize)
+    }
+
+    // the index file is read again through the shared buffer pool
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, options);
+    checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsResident
+// -----------------------------------------------------------------------------
+
+void intTestsResident() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+        checkPassFail(index.bufferLookupsSaved(), 0)
+        checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+        checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
+        std::vector<RecordId> rids;
+        int key = 3000;
+        checkPassFail(index.lookup(&key, rids), 1)
+        // every descent after the first finds the root resident
+        checkPassFail((index.bufferLookupsSaved() >= 2), true)
+
+        // nodes change and are freed while resident
+        checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, false), relationSize / 2)
+        checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, true), relationSize / 2)
+        checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+    }
+
+    // the changes of the resident nodes were written when the index was closed
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, IndexOptions());
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+    int low = 0;
+    int high = relationSize;
+    checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize)
+    checkPassFail(index.bufferLookupsSaved(), 0)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsInsertBatch
+// -----------------------------------------------------------------------------
+
+void intTestsInsertBatch() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 1, 0, false), relationSize)
+
+    // put the entries back 1000 at a time, in the random order of the relation
+    const int batchSize = 1000;
+    std::vector<int> keys;
+    std::vector<RecordId> rids;
+    FileScan fscan(relationName, bufMgr);
+    try {
+        RecordId scanRid;
+        while (1) {
+            fscan.scanNext(scanRid);
+            std::string recordStr = fscan.getRecord();
+            keys.push_back(reinterpret_cast<const RECORD *>(recordStr.c_str())->i);
+            rids.push_back(scanRid);
+            if ((int) keys.size() == batchSize) {
+                index.insertBatch(&keys[0], &rids[0], batchSize);
+                keys.clear();
+                rids.clear();
+            }
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    if (!keys.empty()) {
+        index.insertBatch(&keys[0], &rids[0], (int) keys.size());
+    }
+
+    checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+    checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+    int low = 0;
+    int high = relationSize;
+    checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize)
+
+    // a batch of duplicates splits the leaf of its key several times
+    std::vector<int> dupKeys(batchSize, 100);
+    RecordId dupRid;
+    index.selectNth(0, dupRid);
+    std::vector<RecordId> dupRids(batchSize, dupRid);
+    index.insertBatch(&dupKeys[0], &dupRids[0], batchSize);
+    std::vector<RecordId> found;
+    checkPassFail(index.lookup(&dupKeys[0], found), batchSize + 1)
+    checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize + batchSize)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsAppend
+// -----------------------------------------------------------------------------
+
+// Size in bytes of the index file, which must not be open
+long indexFileSize() {
+    std::ifstream indexFile(intIndexName.c_str(), std::ios::binary | std::ios::ate);
+    return (long) indexFile.tellg();
+}
+
+void intTestsAppend() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+        checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+        // only the inserts that split a leaf go down the tree
+        checkPassFail((index.rightmostLeafInserts() > relationSize / 2), true)
+    }
+    long evenSize = indexFileSize();
+    File::remove(intIndexName);
+
+    buildOptions.splitPolicy = SPLIT_APPEND;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+        checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+        checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
+        checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+        int low = 0;
+        int high = relationSize;
+        checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize)
+    }
+    // the full leaves take about half the pages of the evenly split ones
+    checkPassFail((indexFileSize() < evenSize), true)
+
+    // inserts in the middle of the index still split evenly
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, false), relationSize / 2)
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, true), relationSize / 2)
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+    int low = 0;
+    int high = relationSize;
+    checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsLeafRids
+// -----------------------------------------------------------------------------
+
+void intTestsLeafRids() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // page numbers use both halves of the leaf record id
+    int key = relationSize + 1;
+    RecordId bigRid;
+    bigRid.page_number = 0x12345678;
+    bigRid.slot_number = 0xfedc;
+    index.insertEntry(&key, bigRid);
+    std::vector<RecordId> rids;
+    checkPassFail(index.lookup(&key, rids), 1)
+    checkPassFail((rids[0] == bigRid), true)
+    RecordId foundRid;
+    int low = key;
+    index.startScan(&low, GTE, &key, LTE);
+    checkPassFail(index.scanNextBatch(&foundRid, 1), 1)
+    index.endScan();
+    checkPassFail((foundRid == bigRid), true)
+    index.deleteEntry(&key, bigRid);
+
+    checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsDuplicateScans
+// -----------------------------------------------------------------------------
+
+// Number of record ids of a scan through a cursor, through scanNext if batchSize is 0 and through scanNextBatch otherwise
+int cursorCount(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanOrder order, int batchSize) {
+    BTreeScanCursor *cursor = index->openScan(&lowVal, lowOp, &highVal, highOp, order);
+    int numResults = 0;
+    if (batchSize == 0) {
+        try {
+            while (1) {
+                RecordId scanRid;
+                cursor->scanNext(scanRid);
+                numResults++;
+            }
+        }
+        catch (IndexScanCompletedException e) {
+        }
+    }
+    else {
+        std::vector<RecordId> rids(batchSize);
+        int n;
+        while ((n = cursor->scanNextBatch(&rids[0], batchSize)) > 0) {
+            numResults += n;
+        }
+    }
+    delete cursor;
+    return numResults;
+}
+
+void intTestsDuplicateScans() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    const int numDuplicates = 2000;
+    std::vector<int> keys(numDuplicates, 100);
+    RecordId rid;
+    index.selectNth(100, rid);
+    std::vector<RecordId> rids(numDuplicates, rid);
+    index.insertBatch(&keys[0], &rids[0], numDuplicates);
+
+    checkPassFail(cursorCount(&index, 100, GTE, 100, LTE, ASCENDING, 0), numDuplicates + 1)
+    checkPassFail(cursorCount(&index, 100, GTE, 100, LTE, ASCENDING, 300), numDuplicates + 1)
+    checkPassFail(cursorCount(&index, 100, GTE, 100, LTE, DESCENDING, 0), numDuplicates + 1)
+    checkPassFail(cursorCount(&index, 100, GTE, 100, LTE, DESCENDING, 300), numDuplicates + 1)
+    checkPassFail(cursorCount(&index, 99, GTE, 101, LTE, ASCENDING, 0), numDuplicates + 3)
+    checkPassFail(cursorCount(&index, 100, GT, 101, LTE, ASCENDING, 0), 1)
+    checkPassFail(cursorCount(&index, 99, GTE, 100, LT, DESCENDING, 0), 1)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsIndexOnly
+// -----------------------------------------------------------------------------
+
+void intTestsIndexOnly() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // sum of the keys in [1000, 3000), the relation is not read
+    const int batchSize = 256;
+    std::vector<RecordId> rids(batchSize);
+    std::vector<int> keys(batchSize);
+    long long sum = 0;
+    int low = 1000;
+    int high = 3000;
+    bufMgr->clearBufStats();
+    index.startScan(&low, GTE, &high, LT);
+    int n;
+    while ((n = index.scanNextBatch(&rids[0], batchSize, &keys[0])) > 0) {
+        for (int j = 0; j < n; j++) {
+            sum += keys[j];
+        }
+    }
+    index.endScan();
+    checkPassFail(sum, (long long) (1000 + 2999) * 2000 / 2)
+    // the root and a few leaves, instead of one record read per key
+    checkPassFail((bufMgr->getBufStats().accesses < 10), true)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsInsertBuffer
+// -----------------------------------------------------------------------------
+
+void intTestsInsertBuffer() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    int newKey = relationSize;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+        checkPassFail(index.pendingInserts(), 0)
+        checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, false), relationSize / 2)
+        checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, true), relationSize / 2)
+        // the inserts since the last full buffer are still collected
+        checkPassFail(index.pendingInserts(), (relationSize / 2) % buildOptions.insertBufferSize)
+        checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+        checkPassFail(index.pendingInserts(), 0)
+        checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+
+        RecordId rid;
+        index.selectNth(0, rid);
+        index.insertEntry(&newKey, rid);
+        checkPassFail(index.pendingInserts(), 1)
+        int low = 0;
+        checkPassFail(index.countRange(&low, GTE, &newKey, LTE), relationSize + 1)
+        index.insertEntry(&newKey, rid);
+    }
+
+    // the collected insert went into the index when it was closed
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, IndexOptions());
+    std::vector<RecordId> rids;
+    checkPassFail(index.lookup(&newKey, rids), 2)
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LTE), relationSize + 2)
+}
+
+void intTestsReadAhead() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    // the bulk load fills every leaf but the last one
+    int leaves = (relationSize + INTARRAYLEAFSIZE - 1) / INTARRAYLEAFSIZE;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+        // a scan inside one leaf does not read ahead
+        checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+        checkPassFail(index.leavesReadAhead(), 0)
+        // a scan over all leaves starts reading ahead when it moves on to the second leaf,
+        // and reads each leaf after that one ahead once
+        checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+        checkPassFail(index.leavesReadAhead(), leaves - 2)
+        checkPassFail(intDescendingScan(&index, 0, GTE, relationSize, LT, relationSize, 100), relationSize)
+        checkPassFail(index.leavesReadAhead(), 2 * (leaves - 2))
+        // the range ends in the fourth leaf, the leaves after it are not read
+        int high = 3 * INTARRAYLEAFSIZE + 10;
+        checkPassFail(intBatchScan(&index, 0, GTE, high, LT, 100), high)
+        checkPassFail(index.leavesReadAhead(), 2 * (leaves - 2) + 2)
+        checkPassFail(cursorCount(&index, 0, GTE, high, LT, ASCENDING, 0), high)
+        checkPassFail(index.leavesReadAhead(), 2 * (leaves - 2) + 4)
+    }
+
+    IndexOptions options;
+    options.readAheadLeaves = 0;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, options);
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+    checkPassFail(cursorCount(&index, 0, GTE, relationSize, LT, DESCENDING, 100), relationSize)
+    checkPassFail(index.leavesReadAhead(), 0)
+}
+
+/*
+ * Sink of a parallel scan on the integer field. Keeps the number of entries and the smallest and largest key,
+ * and whether the keys came in ascending order.
+ */
+class IntRangeSink : public ScanSink {
+public:
+    int count;
+    int minKey;
+    int maxKey;
+    bool ordered;
+
+    IntRangeSink() : count(0), minKey(0), maxKey(0), ordered(true) {}
+
+    void consume(const RecordId *, const void *keys, int n) {
+        const int *intKeys = (const int *) keys;
+        for (int i = 0; i < n; i++) {
+            if (count == 0) {
+                minKey = intKeys[i];
+            }
+            else if (intKeys[i] < maxKey) {
+                ordered = false;
+            }
+            maxKey = intKeys[i];
+            count++;
+        }
+    }
+};
+
+/*
+ * Scan the range on numThreads threads. Returns the number of entries, or -1 if a part is out of key order
+ * or overlaps the part before it
+ */
+int parallelCount(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int numThreads) {
+    std::vector<IntRangeSink> parts(numThreads);
+    std::vector<ScanSink *> sinks;
+    for (int i = 0; i < numThreads; i++) {
+        sinks.push_back(&parts[i]);
+    }
+    int count = index->parallelScan(&lowVal, lowOp, &highVal, highOp, sinks);
+    int total = 0;
+    int lastKey = INT32_MIN;
+    for (int i = 0; i < numThreads; i++) {
+        if (!parts[i].ordered || (parts[i].count > 0 && parts[i].minKey <= lastKey)) {
+            return -1;
+        }
+        if (parts[i].count > 0) {
+            lastKey = parts[i].maxKey;
+        }
+        total += parts[i].count;
+    }
+    return total == count ? count : -1;
+}
+
+void intTestsParallelScan() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    const int threadCounts[] = {1, 2, 3, 8};
+    for (int t = 0; t < 4; t++) {
+        checkPassFail(parallelCount(&index, 0, GTE, relationSize, LT, threadCounts[t]), relationSize)
+        checkPassFail(parallelCount(&index, 25, GT, 40, LT, threadCounts[t]), 14)
+        checkPassFail(parallelCount(&index, 996, GT, 1001, LT, threadCounts[t]), 4)
+        checkPassFail(parallelCount(&index, 5000, GTE, 5010, LT, threadCounts[t]), 0)
+    }
+    // more threads than entries, some parts are empty
+    checkPassFail(parallelCount(&index, 20, GTE, 22, LTE, 8), 3)
+
+    // the record ids in key order are the ones of a single cursor
+    int low = 100;
+    int high = 4000;
+    std::vector<RecordId> expected(relationSize);
+    BTreeScanCursor *cursor = index.openScan(&low, GTE, &high, LTE);
+    expected.resize(cursor->scanNextBatch(&expected[0], relationSize));
+    delete cursor;
+    std::vector<RecordId> rids;
+    checkPassFail(index.parallelScan(&low, GTE, &high, LTE, 4, rids), (int) expected.size())
+    bool same = rids.size() == expected.size();
+    for (size_t i = 0; same && i < rids.size(); i++) {
+        same = rids[i].page_number == expected[i].page_number && rids[i].slot_number == expected[i].slot_number;
+    }
+    checkPassFail(same, true)
+
+    int badRanges = 0;
+    try {
+        index.parallelScan(&high, GTE, &low, LTE, 4, rids);
+    }
+    catch (BadScanrangeException e) {
+        badRanges++;
+    }
+    checkPassFail(badRanges, 1)
+}
+
+/*
+ * Bulk load the integer index on buildThreads threads and return the record ids of all entries in key order
+ */
+std::vector<RecordId> parallelBuildRids(int buildThreads) {
+    try {
+        File::remove(intIndexName);
+    }
+    catch (FileNotFoundException e) {
+    }
+    IndexOptions options;
+    options.buildThreads = buildThreads;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, options);
+    int low = 0;
+    int high = relationSize;
+    std::vector<RecordId> rids(relationSize + 1);
+    BTreeScanCursor *cursor = index.openScan(&low, GTE, &high, LT);
+    rids.resize(cursor->scanNextBatch(&rids[0], relationSize + 1));
+    delete cursor;
+    return rids;
+}
+
+void intTestsParallelBuild() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    std::vector<RecordId> expected = parallelBuildRids(1);
+    checkPassFail((int) expected.size(), relationSize)
+
+    // the threads take the pages in any order, the merged runs are in key order all the same.
+    // With 64 threads some of them get no page
+    const int threadCounts[] = {2, 3, 64};
+    for (int t = 0; t < 3; t++) {
+        std::vector<RecordId> rids = parallelBuildRids(threadCounts[t]);
+        bool same = rids.size() == expected.size();
+        for (size_t i = 0; same && i < rids.size(); i++) {
+            same = rids[i].page_number == expected[i].page_number && rids[i].slot_number == expected[i].slot_number;
+        }
+        checkPassFail(same, true)
+    }
+}
+
+/*
+ * Key extractor that reads the integer field of a tuple and negates it
+ */
+class NegatedIntKeys : public KeyExtractor {
+public:
+    void extractKey(const char *record, std::size_t, void *key) const {
+        int value;
+        memcpy(&value, record + offsetof(tuple, i), sizeof(int));
+        *(int *) key = -value;
+    }
+};
+
+/*
+ * Build an index on the negated integer field and return the value of the integer field of the record
+ * with key -value, or -1 if there is no such entry
+ */
+int negatedKeyRecord(IndexOptions options, int value) {
+    try {
+        File::remove(intIndexName);
+    }
+    catch (FileNotFoundException e) {
+    }
+    NegatedIntKeys negated;
+    options.keyExtractor = &negated;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, options);
+    checkPassFail(intScan(&index, -100, GTE, -50, LT), 50)
+
+    int key = -value;
+    RecordId rid;
+    BTreeScanCursor *cursor = index.openScan(&key, GTE, &key, LTE);
+    int found = cursor->scanNextBatch(&rid, 1);
+    delete cursor;
+    if (found == 0) {
+        return -1;
+    }
+    Page *page;
+    bufMgr->readPage(file1, rid.page_number, page);
+    RECORD rec = *(reinterpret_cast<const RECORD *>(page->getRecord(rid).data()));
+    bufMgr->unPinPage(file1, rid.page_number, false);
+    return rec.i;
+}
+
+void intTestsKeyExtractor() {
+    std::cout << "Create a B+ Tree index on the negated integer field" << std::endl;
+    IndexOptions options;
+    checkPassFail(negatedKeyRecord(options, 10), 10)
+    options.buildThreads = 3;
+    checkPassFail(negatedKeyRecord(options, 4321), 4321)
+    options.bulkLoad = false;
+    checkPassFail(negatedKeyRecord(options, 777), 777)
+
+    // the attribute extractor pads a string attribute that ends with the record, and refuses a number that does not fit
+    const char record[] = {'a', 'b', 'c', 'd', 'e', 'f'};
+    char stringKey[STRINGKEYMAXSIZE];
+    AttributeKeyExtractor(2, STRING).extractKey(record, sizeof(record), stringKey);
+    checkPassFail(std::string(stringKey), std::string("cdef"))
+    int shortRecords = 0;
+    int intKey;
+    try {
+        AttributeKeyExtractor(4, INTEGER).extractKey(record, sizeof(record), &intKey);
+    }
+    catch (BadIndexInfoException e) {
+        shortRecords++;
+    }
+    checkPassFail(shortRecords, 1)
+}
+
+/*
+ * Key extractor that reads the integer field of a tuple and fails on the tuple with value failAt
+ */
+class FailingIntKeys : public KeyExtractor {
+public:
+    int failAt;
+
+    FailingIntKeys(int failAt) : failAt(failAt) {}
+
+    void extractKey(const char *record, std::size_t, void *key) const {
+        memcpy(key, record + offsetof(tuple, i), sizeof(int));
+        if (*(int *) key == failAt) {
+            throw BadIndexInfoException("Failing key extractor\n");
+        }
+    }
+};
+
+/*
+ * Build the integer index with the given options, returns 1 if the build failed with BadIndexInfoException
+ */
+int failedBuilds(const IndexOptions &options) {
+    try {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, options);
+    }
+    catch (BadIndexInfoException e) {
+        return 1;
+    }
+    return 0;
+}
+
+void intTestsBuildErrors() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    IndexOptions badFill;
+    badFill.fillFactor = 2;
+    // a fill factor out of range fails a new index and leaves no file behind
+    checkPassFail(failedBuilds(badFill), 1)
+    checkPassFail(File::exists(intIndexName), false)
+
+    // the build options of an existing index are ignored
+    checkPassFail(failedBuilds(IndexOptions()), 0)
+    checkPassFail(failedBuilds(badFill), 0)
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, badFill);
+        checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+    }
+    File::remove(intIndexName);
+
+    // a build that fails part way, bulk loaded or inserted, releases its pages and removes the file
+    FailingIntKeys failing(3000);
+    IndexOptions options;
+    options.keyExtractor = &failing;
+    checkPassFail(failedBuilds(options), 1)
+    checkPassFail(File::exists(intIndexName), false)
+    options.bulkLoad = false;
+    checkPassFail(failedBuilds(options), 1)
+    checkPassFail(File::exists(intIndexName), false)
+
+    // every page was unpinned, a new index of the relation builds and flushes
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, IndexOptions());
+    checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+}
+
+/*
+ * Keys of all entries of the integer index, in scan order
+ */
+std::vector<int> allIntKeys(BTreeIndex *index) {
+    int low = INT32_MIN;
+    int high = INT32_MAX;
+    std::vector<int> keys;
+    RecordId rids[100];
+    int batch[100];
+    BTreeScanCursor *cursor = index->openScan(&low, GTE, &high, LTE);
+    int n;
+    while ((n = cursor->scanNextBatch(rids, 100, batch)) > 0) {
+        keys.insert(keys.end(), batch, batch + n);
+    }
+    delete cursor;
+    return keys;
+}
+
+void intTestsOddSplit() {
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, IndexOptions());
+
+    // fill the only leaf with the keys 0, 2, 4, ...
+    RecordId rid;
+    rid.slot_number = 1;
+    for (int j = 0; j < INTARRAYLEAFSIZE; j++) {
+        int key = 2 * j;
+        rid.page_number = j + 1;
+        index.insertEntry(&key, rid);
+    }
+    // the new key goes to position INTARRAYLEAFSIZE / 2, which is left of the middle key when the size is odd
+    int middle = 2 * (INTARRAYLEAFSIZE / 2) - 1;
+    rid.page_number = INTARRAYLEAFSIZE + 1;
+    index.insertEntry(&middle, rid);
+
+    std::vector<int> keys = allIntKeys(&index);
+    checkPassFail((int) keys.size(), INTARRAYLEAFSIZE + 1)
+    checkPassFail(std::is_sorted(keys.begin(), keys.end()), true)
+    checkPassFail(cursorCount(&index, middle, GTE, middle, LTE, ASCENDING, 0), 1)
+    checkPassFail(cursorCount(&index, middle - 1, GTE, middle + 1, LTE, ASCENDING, 0), 3)
+}
+
+/*
+ * Number of entries of the STRING index, or -1 if a scan over all of them returns them out of key order
+ */
+int orderedStringCount(BTreeIndex *index) {
+    std::string low = "";
+    std::string high(STRINGKEYMAXSIZE, '~');
+    RecordId rids[100];
+    char keys[100 * STRINGKEYMAXSIZE];
+    std::string previous;
+    int count = 0;
+    BTreeScanCursor *cursor = index->openScan(low.c_str(), GTE, high.c_str(), LTE);
+    int n;
+    while ((n = cursor->scanNextBatch(rids, 100, keys)) > 0) {
+        for (int i = 0; i < n; i++) {
+            const char *key = keys + i * STRINGKEYMAXSIZE;
+            std::string current(key, strnlen(key, STRINGKEYMAXSIZE));
+            if (count > 0 && current < previous) {
+                delete cursor;
+                return -1;
+            }
+            previous = current;
+            count++;
+        }
+    }
+    delete cursor;
+    return count;
+}
+
+void stringTestsSplits() {
+    std::cout << "Create a B+ Tree index on the string field" << std::endl;
+    BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple, s), STRING, IndexOptions());
+
+    // keys of random length, so leaves hold and split at any number of keys
+    const int numKeys = 110000;
+    std::vector<std::string> keys;
+    srand(7);
+    RecordId rid;
+    for (int i = 0; i < numKeys; i++) {
+        char key[STRINGKEYMAXSIZE + 1];
+        int length = rand() % (STRINGKEYMAXSIZE + 1);
+        for (int j = 0; j < length; j++) {
+            key[j] = 'a' + rand() % 26;
+        }
+        key[length] = 0;
+        keys.push_back(key);
+        rid.page_number = i / 100 + 1;
+        rid.slot_number = i % 100;
+        index.insertEntry(key, rid);
+    }
+    checkPassFail(orderedStringCount(&index), numKeys)
+
+    // every inserted entry is found again by deleteEntry
+    int notFound = 0;
+    for (int i = 0; i < numKeys; i += 3) {
+        rid.page_number = i / 100 + 1;
+        rid.slot_number = i % 100;
+        try {
+            index.deleteEntry(keys[i].c_str(), rid);
+        }
+        catch (NoSuchKeyFoundException e) {
+            notFound++;
+        }
+    }
+    checkPassFail(notFound, 0)
+    checkPassFail(orderedStringCount(&index), numKeys - (numKeys + 2) / 3)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsLineDirectory
 // -----------------------------------------------------------------------------
 
-void intTestsEven() {
+void intTestsLineDirectory() {
     std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+    {
+        // sparse nodes, so the tree has several non-leaf levels
+        IndexOptions options = buildOptions;
+        options.fillFactor = 0.02;
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, options);
+        checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+        checkPassFail(changeEntries(&index, offsetof(tuple, i), 3, 0, false), (relationSize + 2) / 3)
+        checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize - (relationSize + 2) / 3)
+    }
 
-    // run some tests
-    checkPassFail(intScan(&index, 1, GT, 19, LT), 9)
-    checkPassFail(intScan(&index, 20, GTE, 35, LTE), 8)
-    checkPassFail(intScan(&index, -3, GT, 3, LT), 2)
-    checkPassFail(intScan(&index, 996, GT, 1001, LT), 2)
-    checkPassFail(intScan(&index, 0, GT, 1, LT), 0)
-    checkPassFail(intScan(&index, 300, GT, 400, LT), 49)
-    checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 500)
+    // the format of the nodes comes from the index file, not from the options it is opened with
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, IndexOptions());
+    checkPassFail(changeEntries(&index, offsetof(tuple, i), 3, 0, true), (relationSize + 2) / 3)
+    checkPassFail(intScan(&index, 0, GTE, relationSize, LT), relationSize)
+    checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
+}
+
+void doubleTestsLineDirectory(int numTuples) {
+    std::cout << "Create a B+ Tree index on the double field" << std::endl;
+    // full double nodes hold more than 384 keys, so their group maxima spill past the first cache line
+    BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple, d), DOUBLE, buildOptions);
+    checkPassFail(doubleScan(&index, 25, GT, 40, LT), 14)
+    checkPassFail(doubleScan(&index, numTuples - 300, GTE, numTuples, LT), 300)
+    checkPassFail(changeEntries(&index, offsetof(tuple, d), 2, 1, false), numTuples / 2)
+    checkPassFail(doubleScan(&index, 0, GTE, numTuples, LT), numTuples - numTuples / 2)
+    checkPassFail(changeEntries(&index, offsetof(tuple, d), 2, 1, true), numTuples / 2)
+    checkPassFail(doubleScan(&index, 0, GTE, numTuples, LT), numTuples)
 }
 
 // -----------------------------------------------------------------------------
-// intTestsBig
+// intTestsPackedLeaves
 // -----------------------------------------------------------------------------
 
-void intTestsBig() {
+void intTestsPackedLeaves() {
     std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+    {
+        // packed leaves do not store included attributes
+        IndexOptions options = buildOptions;
+        IncludedAttribute d = {(int) offsetof(tuple, d), (int) sizeof(double)};
+        options.includes.push_back(d);
+        int failed = 0;
+        try {
+            BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, options);
+        }
+        catch (BadIndexInfoException e) {
+            failed = 1;
+        }
+        checkPassFail(failed, 1)
+    }
 
-    // run some tests
-    checkPassFail(intScan(&index, 1, GT, 19, LT), 17)
-    checkPassFail(intScan(&index, 20, GTE, 35, LTE), 16)
-    checkPassFail(intScan(&index, -3, GT, 3, LT), 3)
-    checkPassFail(intScan(&index, 996, GT, 1001, LT), 4)
-    checkPassFail(intScan(&index, 0, GT, 1, LT), 0)
-    checkPassFail(intScan(&index, 300, GT, 400, LT), 99)
-    checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 1000)
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+    // consecutive keys of records on few pages take 24 bits an entry, the relation fits into 2 leaves instead of 7,
+    // so a scan over all of them has no leaf to read ahead, see intTestsReadAhead
+    checkPassFail(intBatchScan(&index, 0, GTE, relationSize, LT, 1000), relationSize)
+    checkPassFail(index.leavesReadAhead(), 0)
+
+    // a rid on a far page needs 80 bit entries, the leaf it goes into splits until its half with the rid fits
+    RecordId farRid;
+    farRid.page_number = 1u << 31;
+    farRid.slot_number = 65535;
+    int key = 1000;
+    index.insertEntry(&key, farRid);
+    int low = 995;
+    int high = 1005;
+    checkPassFail(index.countRange(&low, GT, &high, LT), 10)
+    checkPassFail(intBatchScan(&index, 1001, GTE, relationSize, LT, 1000), relationSize - 1001)
+    checkPassFail(index.countRange(&key, GTE, &key, LTE), 2)
+    checkPassFail(index.rank(&key), 1000)
+    std::vector<RecordId> rids;
+    checkPassFail(index.lookup(&key, rids), 2)
+    checkPassFail((rids[0].page_number == farRid.page_number || rids[1].page_number == farRid.page_number), true)
+
+    index.deleteEntry(&key, farRid);
+    checkPassFail(index.countRange(&key, GTE, &key, LTE), 1)
+    checkPassFail(intBatchScan(&index, 0, GTE, relationSize, LT, 1000), relationSize)
 }
 
 // -----------------------------------------------------------------------------
-// intTestsNegative
+// intTestsPostingLists
 // -----------------------------------------------------------------------------
 
-void intTestsNegative() {
+/*
+ * Key extractor that reads the integer field of a tuple modulo 4, each key has a quarter of the records
+ */
+class QuarterIntKeys : public KeyExtractor {
+public:
+    void extractKey(const char *record, std::size_t, void *key) const {
+        int value;
+        memcpy(&value, record + offsetof(tuple, i), sizeof(int));
+        *(int *) key = value % 4;
+    }
+};
+
+// Record ids of the entries with the given key, in the order a cursor returns them through scanNextBatch.
+// Returns the number of them whose returned key is not the given key
+int keyRids(BTreeIndex *index, int key, ScanOrder order, int batchSize, std::vector<RecordId> &outRids) {
+    BTreeScanCursor *cursor = index->openScan(&key, GTE, &key, LTE, order);
+    std::vector<RecordId> rids(batchSize);
+    std::vector<int> keys(batchSize);
+    int numWrongKeys = 0;
+    int n;
+    while ((n = cursor->scanNextBatch(&rids[0], batchSize, &keys[0])) > 0) {
+        for (int j = 0; j < n; j++) {
+            outRids.push_back(rids[j]);
+            numWrongKeys += keys[j] != key;
+        }
+    }
+    delete cursor;
+    return numWrongKeys;
+}
+
+// True if the record ids are sorted by page number and then by slot number, as a posting list keeps them
+bool ridsSorted(const std::vector<RecordId> &rids) {
+    for (size_t j = 1; j < rids.size(); j++) {
+        if (rids[j].page_number < rids[j - 1].page_number
+            || (rids[j].page_number == rids[j - 1].page_number && rids[j].slot_number < rids[j - 1].slot_number)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Build an index on the integer field modulo 4, whose lists do not fit into the leaves, and check its lookups,
+// scans and counts while the entries of one key are deleted and inserted again
+void postingListChecks(IndexOptions options) {
+    try {
+        File::remove(intIndexName);
+    }
+    catch (FileNotFoundException e) {
+    }
+    QuarterIntKeys quarters;
+    options.keyExtractor = &quarters;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, options);
+    const int perKey = relationSize / 4;
+    int low = 0;
+    int high = 3;
+    int key = 2;
+    checkPassFail(index.countRange(&low, GTE, &high, LTE), relationSize)
+    checkPassFail(index.countRange(&key, GTE, &key, LTE), perKey)
+    std::vector<RecordId> rids;
+    checkPassFail(index.lookup(&key, rids), perKey)
+    checkPassFail(ridsSorted(rids), true)
+
+    // scans return the list in order, and in reverse order from its last overflow page
+    std::vector<RecordId> ascending;
+    checkPassFail(keyRids(&index, key, ASCENDING, 300, ascending), 0)
+    checkPassFail((ascending == rids), true)
+    std::vector<RecordId> descending;
+    checkPassFail(keyRids(&index, key, DESCENDING, 7, descending), 0)
+    std::reverse(descending.begin(), descending.end());
+    checkPassFail((descending == rids), true)
+    checkPassFail(cursorCount(&index, key, GTE, key, LTE, ASCENDING, 0), perKey)
+    checkPassFail(cursorCount(&index, key, GTE, key, LTE, DESCENDING, 0), perKey)
+    checkPassFail(cursorCount(&index, 0, GT, 3, LT, DESCENDING, 0), 2 * perKey)
+    checkPassFail(cursorCount(&index, 0, GTE, 3, LTE, ASCENDING, 1000), relationSize)
+
+    checkPassFail(index.rank(&key), 2 * perKey)
+    RecordId nthRid;
+    int nthKey;
+    index.selectNth(2 * perKey + 500, nthRid, &nthKey);
+    checkPassFail(nthKey, key)
+    checkPassFail((nthRid == rids[500]), true)
+
+    // every other entry of the key is deleted, the first one in the leaf and ones in the overflow pages
+    for (size_t j = 0; j < rids.size(); j += 2) {
+        index.deleteEntry(&key, rids[j]);
+    }
+    checkPassFail(index.countRange(&key, GTE, &key, LTE), perKey / 2)
+    std::vector<RecordId> left;
+    checkPassFail(index.lookup(&key, left), perKey / 2)
+    checkPassFail((left[0] == rids[1]), true)
+    checkPassFail(cursorCount(&index, key, GTE, key, LTE, DESCENDING, 0), perKey / 2)
+    // a record id the list does not hold is not found
+    int failed = 0;
+    try {
+        index.deleteEntry(&key, rids[0]);
+    }
+    catch (NoSuchKeyFoundException e) {
+        failed = 1;
+    }
+    checkPassFail(failed, 1)
+    checkPassFail(index.countRange(&low, GTE, &high, LTE), relationSize - perKey / 2)
+
+    // the list is emptied and built again from its greatest record id down, it moves to overflow pages again
+    for (size_t j = 1; j < rids.size(); j += 2) {
+        index.deleteEntry(&key, rids[j]);
+    }
+    checkPassFail(index.countRange(&key, GTE, &key, LTE), 0)
+    checkPassFail(cursorCount(&index, 1, GTE, 3, LTE, ASCENDING, 0), 2 * perKey)
+    for (size_t j = rids.size(); j-- > 0;) {
+        index.insertEntry(&key, rids[j]);
+    }
+    std::vector<RecordId> inserted;
+    checkPassFail(index.lookup(&key, inserted), perKey)
+    checkPassFail((inserted == rids), true)
+    checkPassFail(cursorCount(&index, key, GTE, key, LTE, DESCENDING, 300), perKey)
+    checkPassFail(index.countRange(&low, GTE, &high, LTE), relationSize)
+    checkPassFail(index.rank(&high), 3 * perKey)
+}
+
+void intTestsPostingLists() {
+    std::cout << "Create a B+ Tree index on the integer field modulo 4" << std::endl;
+    // posting lists are not packed and do not store included attributes
+    IndexOptions options = buildOptions;
+    options.packedLeaves = true;
+    checkPassFail(failedBuilds(options), 1)
+    options.packedLeaves = false;
+    IncludedAttribute d = {(int) offsetof(tuple, d), (int) sizeof(double)};
+    options.includes.push_back(d);
+    checkPassFail(failedBuilds(options), 1)
+    checkPassFail(File::exists(intIndexName), false)
+
+    options.includes.clear();
+    postingListChecks(options);
+    options.bulkLoad = false;
+    postingListChecks(options);
+    options.subtreeCounts = !options.subtreeCounts;
+    postingListChecks(options);
+}
+
+// -----------------------------------------------------------------------------
+// intTestsIncludes
+// -----------------------------------------------------------------------------
+
+void intTestsIncludes(int numTuples) {
     std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+    int low = 0;
+    int high = 1000;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+        checkPassFail(index.payloadSize(), (int) sizeof(double) + 5)
+        checkPassFail(includedCount(index.openScan(&low, GTE, &numTuples, LT), INTEGER), numTuples)
+        checkPassFail(includedCount(index.openScan(&high, GTE, &numTuples, LT, DESCENDING), INTEGER), numTuples - high)
+
+        // leaves merge and split again, the included attributes move with their entries
+        checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, false), numTuples / 2)
+        checkPassFail(includedCount(index.openScan(&low, GTE, &numTuples, LT), INTEGER), numTuples - numTuples / 2)
+        checkPassFail(changeEntries(&index, offsetof(tuple, i), 2, 0, true), numTuples / 2)
+        checkPassFail(includedCount(index.openScan(&low, GTE, &numTuples, LT), INTEGER), numTuples)
+
+        // an insert into an index with included attributes needs them
+        RecordId rid;
+        index.selectNth(0, rid);
+        int failed = 0;
+        try {
+            index.insertEntry(&numTuples, rid);
+        }
+        catch (BadIndexInfoException e) {
+            failed = 1;
+        }
+        checkPassFail(failed, 1)
+    }
 
-    // run some tests
-    checkPassFail(intScan(&index, -19, GT, -1, LT), 17)
-    checkPassFail(intScan(&index, -35, GTE, -20, LTE), 16)
-    checkPassFail(intScan(&index, -4, GT, 3, LT), 3)
-    checkPassFail(intScan(&index, -1001, GT, -996, LT), 4)
-    checkPassFail(intScan(&index, 0, GT, 1, LT), 0)
-    checkPassFail(intScan(&index, -400, GT, -300, LT), 99)
-    checkPassFail(intScan(&index, -4000, GTE, -3000, LT), 1000)
+    // the included attributes of an existing index come from its metapage
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, IndexOptions());
+        checkPassFail(index.payloadSize(), (int) sizeof(double) + 5)
+        checkPassFail(includedCount(index.openScan(&low, GTE, &high, LT, DESCENDING), INTEGER), high)
+    }
+    File::remove(intIndexName);
+
+    // too many bytes, or an attribute past the end of the records, fail a new index
+    IndexOptions badIncludes;
+    IncludedAttribute large = {0, MAXPAYLOADSIZE + 1};
+    badIncludes.includes.push_back(large);
+    checkPassFail(failedBuilds(badIncludes), 1)
+    badIncludes.includes[0].length = 8;
+    badIncludes.includes[0].offset = sizeof(RECORD);
+    checkPassFail(failedBuilds(badIncludes), 1)
+    checkPassFail(File::exists(intIndexName), false)
+}
+
+void stringTestsIncludes(int numTuples) {
+    std::cout << "Create a B+ Tree index on the string field" << std::endl;
+    BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple, s), STRING, buildOptions);
+    checkPassFail(includedCount(index.openScan("0", GTE, "9", LT), STRING), numTuples)
+    checkPassFail(includedCount(index.openScan("01000", GTE, "03000", LT, DESCENDING), STRING), 2000)
+    checkPassFail(changeEntries(&index, offsetof(tuple, s), 2, 1, false), numTuples / 2)
+    checkPassFail(includedCount(index.openScan("0", GTE, "9", LT, DESCENDING), STRING), numTuples - numTuples / 2)
+    checkPassFail(changeEntries(&index, offsetof(tuple, s), 2, 1, true), numTuples / 2)
+    checkPassFail(includedCount(index.openScan("0", GTE, "9", LT), STRING), numTuples)
+}
+
+// Number of entries a cursor returns through scanNextBatch whose included attributes, the double field and the
+// first 5 bytes of the string field, are those of the record of their key. Deletes the cursor
+int includedCount(BTreeScanCursor *cursor, Datatype keyType) {
+    const int batchSize = 100;
+    const int payloadSize = sizeof(double) + 5;
+    std::vector<RecordId> rids(batchSize);
+    std::vector<char> keys(batchSize * STRINGKEYMAXSIZE);
+    std::vector<char> payloads(batchSize * payloadSize);
+    int numMatching = 0;
+    int n;
+    while ((n = cursor->scanNextBatch(&rids[0], batchSize, &keys[0], &payloads[0])) > 0) {
+        for (int j = 0; j < n; j++) {
+            int key = keyType == INTEGER ? ((int *) &keys[0])[j] : atoi(&keys[j * STRINGKEYMAXSIZE]);
+            char s[64];
+            sprintf(s, "%05d string record", key);
+            double d;
+            memcpy(&d, &payloads[j * payloadSize], sizeof(double));
+            if (d == key && memcmp(&payloads[j * payloadSize + sizeof(double)], s, 5) == 0) {
+                numMatching++;
+            }
+        }
+    }
+    delete cursor;
+    return numMatching;
 }
 
 // -----------------------------------------------------------------------------
-// intTestsComplex
+// intTestsDescending
 // -----------------------------------------------------------------------------
 
-void intTestsComplex() {
+void intTestsDescending() {
     std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
+
+    // run some tests through scanNext and scanNextBatch
+    checkPassFail(intDescendingScan(&index, 25, GT, 40, LT, relationSize, 0), 14)
+    checkPassFail(intDescendingScan(&index, 20, GTE, 35, LTE, relationSize, 0), 16)
+    checkPassFail(intDescendingScan(&index, 996, GT, 1001, LT, relationSize, 3), 4)
+    checkPassFail(intDescendingScan(&index, 0, GTE, relationSize, LT, relationSize, 0), relationSize)
+    checkPassFail(intDescendingScan(&index, 0, GTE, relationSize, LT, relationSize, 1000), relationSize)
+    checkPassFail(intDescendingScan(&index, 0, GT, 1, LT, relationSize, 0), 0)
+    checkPassFail(intDescendingScan(&index, 5000, GTE, 5010, LT, relationSize, 10), 0)
+    // the latest 10 keys, stopping the scan early
+    checkPassFail(intDescendingScan(&index, 0, GTE, relationSize, LT, 10, 0), 10)
+    checkPassFail(intDescendingScan(&index, 0, GTE, relationSize, LT, 10, 10), 10)
+}
 
-    // run some tests
-    checkPassFail(intScan(&index, 1, GT, 1, LTE), 0)
-    checkPassFail(intScan(&index, 1, GTE, 1, LT), 0)
-    checkPassFail(intScan(&index, 5000, GTE, 50001, LTE), 0)
-    checkPassFail(intScan(&index, 4999, GTE, 5000, LTE), 1)
-    checkPassFail(intScan(&index, 4999, GT, 5000, LTE), 0)
-    checkPassFail(intScan(&index, 4999, GT, 5000, LT), 0)
-    checkPassFail(intScan(&index, 0, GT, 2, LT), 1)
-    checkPassFail(intScan(&index, 0, GT, 2, LTE), 2)
-    checkPassFail(intScan(&index, -1, GT, 2, LTE), 3)
+/*
+ * Scan from the high bound down, through scanNext if batchSize is 0 and through scanNextBatch otherwise.
+ * Stops after limit record ids. Returns the number of record ids, or -1 if the keys are not consecutive
+ * and descending
+ */
+int intDescendingScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int limit, int batchSize) {
+    std::cout << "Descending scan for ";
+    if (lowOp == GT) { std::cout << "("; } else { std::cout << "["; }
+    std::cout << lowVal << "," << highVal;
+    if (highOp == LT) { std::cout << ")"; } else { std::cout << "]"; }
+    std::cout << " limit " << limit << std::endl;
+
+    int expectedKey = highOp == LT ? highVal - 1 : highVal;
+    int numResults = 0;
+    index->startScan(&lowVal, lowOp, &highVal, highOp, DESCENDING);
+    if (batchSize == 0) {
+        while (numResults < limit) {
+            RecordId scanRid;
+            Page *curPage;
+            try {
+                index->scanNext(scanRid);
+            }
+            catch (IndexScanCompletedException e) {
+                break;
+            }
+            bufMgr->readPage(file1, scanRid.page_number, curPage);
+            RECORD myRec = *(reinterpret_cast<const RECORD *>(curPage->getRecord(scanRid).data()));
+            bufMgr->unPinPage(file1, scanRid.page_number, false);
+            if (myRec.i != expectedKey) {
+                std::cout << "Key " << myRec.i << " found, expected " << expectedKey << std::endl;
+                index->endScan();
+                return -1;
+            }
+            expectedKey--;
+            numResults++;
+        }
+    }
+    else {
+        std::vector<RecordId> rids(batchSize);
+        std::vector<int> keys(batchSize);
+        while (numResults < limit) {
+            int count = index->scanNextBatch(&rids[0], std::min(batchSize, limit - numResults), &keys[0]);
+            for (int i = 0; i < count; i++) {
+                if (keys[i] != expectedKey) {
+                    std::cout << "Key " << keys[i] << " found, expected " << expectedKey << std::endl;
+                    index->endScan();
+                    return -1;
+                }
+                expectedKey--;
+            }
+            numResults += count;
+            if (count < batchSize) {
+                break;
+            }
+        }
+    }
+    index->endScan();
+
+    std::cout << "Number of results: " << numResults << std::endl << std::endl;
+    return numResults;
 }
 
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp) {
@@ -818,6 +3207,213 @@ int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator
 }
 
 
+// -----------------------------------------------------------------------------
+// doubleTests
+// -----------------------------------------------------------------------------
+
+void doubleTests() {
+    std::cout << "Create a B+ Tree index on the double field" << std::endl;
+    BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple, d), DOUBLE, buildOptions);
+
+    // run some tests
+    checkPassFail(doubleScan(&index, 1, GT, 19, LT), 17)
+    checkPassFail(doubleScan(&index, 20, GTE, 35, LTE), 16)
+    checkPassFail(doubleScan(&index, -3, GT, 3, LT), 3)
+    checkPassFail(doubleScan(&index, 996, GT, 1001, LT), 4)
+    checkPassFail(doubleScan(&index, 0, GT, 1, LT), 0)
+    checkPassFail(doubleScan(&index, 300, GT, 400, LT), 99)
+    checkPassFail(doubleScan(&index, 3000, GTE, 4000, LT), 1000)
+    checkPassFail(doubleScan(&index, 0.5, GT, 2.5, LT), 2)
+    checkPassFail(doubleScan(&index, 4998.5, GTE, 10000, LTE), 1)
+}
+
+// -----------------------------------------------------------------------------
+// doubleTestsNegative
+// -----------------------------------------------------------------------------
+
+void doubleTestsNegative() {
+    std::cout << "Create a B+ Tree index on the double field" << std::endl;
+    BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple, d), DOUBLE, buildOptions);
+
+    // run some tests, the keys are 0.01 to 50.00 in steps of 0.01
+    checkPassFail(doubleScan(&index, 0.505, GT, 1.005, LT), 50)
+    checkPassFail(doubleScan(&index, 0.0, GT, 0.015, LTE), 1)
+    checkPassFail(doubleScan(&index, 0.0, GTE, 50.5, LTE), 5000)
+    checkPassFail(doubleScan(&index, 50.005, GT, 60, LT), 0)
+}
+
+int doubleScan(BTreeIndex *index, double lowVal, Operator lowOp, double highVal, Operator highOp) {
+    RecordId scanRid;
+    Page *curPage;
+
+    std::cout << "Scan for ";
+    if (lowOp == GT) { std::cout << "("; } else { std::cout << "["; }
+    std::cout << lowVal << "," << highVal;
+    if (highOp == LT) { std::cout << ")"; } else { std::cout << "]"; }
+    std::cout << std::endl;
+
+    int numResults = 0;
+
+    try {
+        index->startScan(&lowVal, lowOp, &highVal, highOp);
+    }
+    catch (NoSuchKeyFoundException e) {
+        std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+        return 0;
+    }
+
+    while (1) {
+        try {
+            index->scanNext(scanRid);
+            bufMgr->readPage(file1, scanRid.page_number, curPage);
+            RECORD myRec = *(reinterpret_cast<const RECORD *>(curPage->getRecord(scanRid).data()));
+            bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+            if (numResults < 5) {
+                std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+                std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" << std::endl;
+            }
+            else if (numResults == 5) {
+                std::cout << "..." << std::endl;
+            }
+        }
+        catch (IndexScanCompletedException e) {
+            break;
+        }
+
+        numResults++;
+    }
+
+    if (numResults >= 5) {
+        std::cout << "Number of results: " << numResults << std::endl;
+    }
+    index->endScan();
+    std::cout << std::endl;
+
+    return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// stringTests
+// -----------------------------------------------------------------------------
+
+void stringTests() {
+    std::cout << "Create a B+ Tree index on the string field" << std::endl;
+    BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple, s), STRING, buildOptions);
+
+    // run some tests, the keys are "00000 string record" to "04999 string record"
+    checkPassFail(stringScan(&index, "00010", GT, "00020", LT), 10)
+    checkPassFail(stringScan(&index, "00020 string record", GTE, "00035 string record", LTE), 16)
+    checkPassFail(stringScan(&index, "00020 string record", GT, "00035 string record", LT), 14)
+    checkPassFail(stringScan(&index, "00996", GT, "01001", LT), 5)
+    checkPassFail(stringScan(&index, "03000", GTE, "04000", LT), 1000)
+    checkPassFail(stringScan(&index, "", GTE, "~", LTE), 5000)
+    checkPassFail(stringScan(&index, "04999 string record", GT, "~", LT), 0)
+    checkPassFail(stringScan(&index, "1", GTE, "2", LT), 0)
+}
+
+// -----------------------------------------------------------------------------
+// stringTestsDelete
+// -----------------------------------------------------------------------------
+
+void stringTestsDelete(int numTuples) {
+    std::cout << "Create a B+ Tree index on the string field" << std::endl;
+    BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple, s), STRING, buildOptions);
+
+    checkPassFail(changeEntries(&index, offsetof(tuple, s), 2, 0, false), numTuples / 2)
+    checkPassFail(stringScan(&index, "00010", GT, "00020", LT), 5)
+    checkPassFail(stringScan(&index, "", GTE, "~", LTE), numTuples / 2)
+    checkPassFail(changeEntries(&index, offsetof(tuple, s), 2, 1, false), numTuples / 2)
+    checkPassFail(stringScan(&index, "", GTE, "~", LTE), 0)
+    checkPassFail(changeEntries(&index, offsetof(tuple, s), 1, 0, true), numTuples)
+    checkPassFail(stringScan(&index, "00010", GT, "00020", LT), 10)
+    checkPassFail(stringScan(&index, "", GTE, "~", LTE), numTuples)
+}
+
+// -----------------------------------------------------------------------------
+// changeEntries
+// -----------------------------------------------------------------------------
+
+// Delete or insert the entries of the tuples with i % modulus == remainder, returns their number
+int changeEntries(BTreeIndex *index, int attrByteOffset, int modulus, int remainder, bool insert) {
+    int numChanged = 0;
+    // the included attributes of the records, if the index has any
+    std::vector<char> payload(index->payloadSize() + 1);
+    FileScan fscan(relationName, bufMgr);
+    try {
+        RecordId scanRid;
+        while (1) {
+            fscan.scanNext(scanRid);
+            std::string recordStr = fscan.getRecord();
+            const char *record = recordStr.c_str();
+            if (reinterpret_cast<const RECORD *>(record)->i % modulus == remainder) {
+                if (insert) {
+                    index->extractPayload(record, recordStr.size(), &payload[0]);
+                    index->insertEntry(record + attrByteOffset, scanRid, &payload[0]);
+                }
+                else {
+                    index->deleteEntry(record + attrByteOffset, scanRid);
+                }
+                numChanged++;
+            }
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    return numChanged;
+}
+
+int stringScan(BTreeIndex *index, const std::string &lowVal, Operator lowOp, const std::string &highVal, Operator highOp) {
+    RecordId scanRid;
+    Page *curPage;
+
+    std::cout << "Scan for ";
+    if (lowOp == GT) { std::cout << "("; } else { std::cout << "["; }
+    std::cout << lowVal << "," << highVal;
+    if (highOp == LT) { std::cout << ")"; } else { std::cout << "]"; }
+    std::cout << std::endl;
+
+    int numResults = 0;
+
+    try {
+        index->startScan(lowVal.c_str(), lowOp, highVal.c_str(), highOp);
+    }
+    catch (NoSuchKeyFoundException e) {
+        std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+        return 0;
+    }
+
+    while (1) {
+        try {
+            index->scanNext(scanRid);
+            bufMgr->readPage(file1, scanRid.page_number, curPage);
+            RECORD myRec = *(reinterpret_cast<const RECORD *>(curPage->getRecord(scanRid).data()));
+            bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+            if (numResults < 5) {
+                std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+                std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" << std::endl;
+            }
+            else if (numResults == 5) {
+                std::cout << "..." << std::endl;
+            }
+        }
+        catch (IndexScanCompletedException e) {
+            break;
+        }
+
+        numResults++;
+    }
+
+    if (numResults >= 5) {
+        std::cout << "Number of results: " << numResults << std::endl;
+    }
+    index->endScan();
+    std::cout << std::endl;
+
+    return numResults;
+}
+
 // -----------------------------------------------------------------------------
 // errorTests
 // -----------------------------------------------------------------------------
@@ -861,7 +3457,7 @@ void errorTests() {
 
     file1->writePage(new_page_number, new_page);
 
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, buildOptions);
 
     int int2 = 2;
     int int5 = 5;
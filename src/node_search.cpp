@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "node_search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NODE_SEARCH_X86
+#endif
+
+namespace badgerdb {
+
+    namespace {
+
+        typedef int (*LowerBoundKernel)(const int *, int, int);
+
+        int scalarLowerBound(const int *keyArray, int count, int key) {
+            return searchKeyArray<false>(keyArray, count, key);
+        }
+
+#ifdef NODE_SEARCH_X86
+        //Binary search narrows the range down to at most this many vectors, which are then compared at once
+        const int SIMD_WINDOW_VECTORS = 2;
+
+        /*
+         * The keys are sorted, so the position of the first key >= key inside the window is simply the
+         * number of window keys < key. Counting them with a popcount of the compare masks keeps the last
+         * few steps of the search free of branches as well. The narrowing step adds the half as a
+         * product rather than picking a pointer, which gcc otherwise compiles to a branch here.
+         */
+        __attribute__((target("avx2,popcnt")))
+        int avx2LowerBound(const int *keyArray, int count, int key) {
+            const int *base = keyArray;
+            int n = count;
+            while (n > SIMD_WINDOW_VECTORS * 8) {
+                int half = n / 2;
+                base += (base[half - 1] < key) * half;
+                n -= half;
+            }
+            //8 keys per compare, lanes past n are not loaded so the window never reads past the occupied slots
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            __m256i searched = _mm256_set1_epi32(key);
+            int below = 0;
+            for (int i = 0; i < SIMD_WINDOW_VECTORS * 8; i += 8) {
+                __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), lanes);
+                __m256i keys = _mm256_maskload_epi32(base + i, valid);
+                __m256i less = _mm256_and_si256(valid, _mm256_cmpgt_epi32(searched, keys));
+                below += __builtin_popcount((unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(less)));
+            }
+            return (int) (base - keyArray) + below;
+        }
+
+        __attribute__((target("avx512f,popcnt")))
+        int avx512LowerBound(const int *keyArray, int count, int key) {
+            const int *base = keyArray;
+            int n = count;
+            while (n > SIMD_WINDOW_VECTORS * 16) {
+                int half = n / 2;
+                base += (base[half - 1] < key) * half;
+                n -= half;
+            }
+            //16 keys per compare, the lanes past n are masked off the load and the compare
+            __m512i searched = _mm512_set1_epi32(key);
+            int below = 0;
+            for (int i = 0; i < SIMD_WINDOW_VECTORS * 16; i += 16) {
+                int left = n - i;
+                __mmask16 valid = left >= 16 ? (__mmask16) 0xFFFF : (__mmask16) (left > 0 ? (1u << left) - 1 : 0);
+                __m512i keys = _mm512_maskz_loadu_epi32(valid, base + i);
+                below += __builtin_popcount((unsigned) _mm512_mask_cmplt_epi32_mask(valid, keys, searched));
+            }
+            return (int) (base - keyArray) + below;
+        }
+#endif
+
+        bool kernelSupported(SearchKernel kernel) {
+            switch (kernel) {
+                case SCALAR_SEARCH:
+                    return true;
+#ifdef NODE_SEARCH_X86
+                case AVX2_SEARCH:
+                    return __builtin_cpu_supports("avx2");
+                case AVX512_SEARCH:
+                    return __builtin_cpu_supports("avx512f");
+#endif
+                default:
+                    return false;
+            }
+        }
+
+        LowerBoundKernel kernelFunction(SearchKernel kernel) {
+            switch (kernel) {
+#ifdef NODE_SEARCH_X86
+                case AVX2_SEARCH:
+                    return avx2LowerBound;
+                case AVX512_SEARCH:
+                    return avx512LowerBound;
+#endif
+                default:
+                    return scalarLowerBound;
+            }
+        }
+
+        SearchKernel bestKernel() {
+#ifdef NODE_SEARCH_X86
+            __builtin_cpu_init();
+#endif
+            if (kernelSupported(AVX512_SEARCH)) {
+                return AVX512_SEARCH;
+            }
+            if (kernelSupported(AVX2_SEARCH)) {
+                return AVX2_SEARCH;
+            }
+            return SCALAR_SEARCH;
+        }
+
+        SearchKernel activeKernel = bestKernel();
+        LowerBoundKernel activeLowerBound = kernelFunction(activeKernel);
+    }
+
+    int keyLowerBound(const int *keyArray, int count, int key) {
+        return activeLowerBound(keyArray, count, key);
+    }
+
+    int keyUpperBound(const int *keyArray, int count, int key) {
+        //For integers the first key > key is the first key >= key + 1
+        if (key == INT32_MAX) {
+            return count;
+        }
+        return activeLowerBound(keyArray, count, key + 1);
+    }
+
+    SearchKernel getSearchKernel() {
+        return activeKernel;
+    }
+
+    bool setSearchKernel(SearchKernel kernel) {
+        if (!kernelSupported(kernel)) {
+            return false;
+        }
+        activeKernel = kernel;
+        activeLowerBound = kernelFunction(kernel);
+        return true;
+    }
+
+    const char *searchKernelName(SearchKernel kernel) {
+        switch (kernel) {
+            case AVX2_SEARCH:
+                return "avx2";
+            case AVX512_SEARCH:
+                return "avx512";
+            default:
+                return "scalar";
+        }
+    }
+
+}
@@ -0,0 +1,185 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <climits>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief Binary search over the first count entries of a sorted key array, written without data
+ * dependent branches: the loop runs a fixed ceil(log2(count)) times and the comparison only picks
+ * the next base with a conditional move, so the search never pays for a mispredicted branch.
+ *
+ * @param keyArray	Sorted keys of a leaf or non-leaf node
+ * @param count		Number of occupied slots at the start of keyArray
+ * @param key		Key to search for
+ * @return	Lowest index i in [0, count] such that keyArray[i] >= key (Upper = false)
+ * 			or keyArray[i] > key (Upper = true). count if there is no such slot.
+ */
+    template<bool Upper, class T>
+    inline int searchKeyArray(const T *keyArray, int count, T key) {
+        if (count <= 0) {
+            return 0;
+        }
+        const T *base = keyArray;
+        int n = count;
+        while (n > 1) {
+            int half = n / 2;
+            bool right = Upper ? base[half] <= key : base[half] < key;
+            base = right ? base + half : base;
+            n -= half;
+        }
+        bool last = Upper ? *base <= key : *base < key;
+        return (int) (base - keyArray) + last;
+    }
+
+/**
+ * @brief Size of a CPU cache line in bytes. The non-leaf nodes are laid out in blocks of this size.
+ */
+    const int CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Number of keys of type T in one cache line.
+ */
+    template<class T>
+    struct KeyLines {
+        static const int KEYS_PER_LINE = CACHE_LINE_SIZE / sizeof(T);
+    };
+
+/**
+ * @brief Update the line directory of a sorted key array after the keys from line firstLine on changed.
+ * Line l of keyArray is the block of keys [l * B, l * B + B), B keys per cache line. lineMax[l] is the largest
+ * key of line l, and groupMax[g] the largest key of the B lines [g * B, g * B + B), so the two directory
+ * levels plus one line of keys cover B * B * B keys.
+ *
+ * @param keyArray	Sorted keys, starting on a cache line
+ * @param count		Number of occupied slots at the start of keyArray
+ * @param lineMax	Largest key of each line of keyArray, starting on a cache line
+ * @param groupMax	Largest key of each group of B lines
+ * @param firstLine	First line whose keys changed
+ */
+    template<class T>
+    inline void updateLineDirectory(const T *keyArray, int count, T *lineMax, T *groupMax, int firstLine) {
+        const int B = KeyLines<T>::KEYS_PER_LINE;
+        int lines = (count + B - 1) / B;
+        for (int l = firstLine; l < lines; l++) {
+            lineMax[l] = keyArray[(l + 1 < lines ? l * B + B : count) - 1];
+        }
+        for (int g = firstLine / B; g * B < lines; g++) {
+            groupMax[g] = lineMax[(g * B + B < lines ? g * B + B : lines) - 1];
+        }
+    }
+
+/**
+ * @brief Number of keys < key (Upper = false) or <= key (Upper = true) among the first n keys of a
+ * cache line. Compares the whole line and masks the result, a fixed loop the compiler turns into SIMD
+ * compares. The slots past n must be readable, their content is ignored.
+ */
+    template<bool Upper, class T>
+    inline int countInLine(const T *line, int n, T key) {
+        int below = 0;
+        for (int j = 0; j < KeyLines<T>::KEYS_PER_LINE; j++) {
+            below += (j < n) & (Upper ? line[j] <= key : line[j] < key);
+        }
+        return below;
+    }
+
+/**
+ * @brief Line of a key array holding the lower (Upper = false) or upper (Upper = true) bound of key,
+ * found through the line directory of updateLineDirectory. Reads groupMax and one line of lineMax.
+ *
+ * @return	Line l such that the bound is in [l * B, l * B + B), the number of lines if the bound is count
+ */
+    template<bool Upper, class T>
+    inline int searchLineDirectory(const T *lineMax, const T *groupMax, int count, T key) {
+        const int B = KeyLines<T>::KEYS_PER_LINE;
+        int lines = (count + B - 1) / B;
+        int groups = (lines + B - 1) / B;
+        int g = 0;
+        for (int i = 0; i < groups; i++) {
+            g += Upper ? groupMax[i] <= key : groupMax[i] < key;
+        }
+        if (g == groups) {
+            return lines;
+        }
+        int groupLines = lines - g * B < B ? lines - g * B : B;
+        return g * B + countInLine<Upper>(lineMax + g * B, groupLines, key);
+    }
+
+/**
+ * @brief Same result as searchKeyArray, for a key array with a line directory. Touches the cache line of
+ * groupMax, one line of lineMax and one line of keys, where the binary search touches about log2(count / B)
+ * lines of keys before it reaches the last one.
+ */
+    template<bool Upper, class T>
+    inline int searchKeyLines(const T *keyArray, const T *lineMax, const T *groupMax, int count, T key) {
+        const int B = KeyLines<T>::KEYS_PER_LINE;
+        int line = searchLineDirectory<Upper>(lineMax, groupMax, count, key);
+        if (line * B >= count) {
+            return count;
+        }
+        int lineKeys = count - line * B < B ? count - line * B : B;
+        return line * B + countInLine<Upper>(keyArray + line * B, lineKeys, key);
+    }
+
+/**
+ * @brief Implementations of the in-node key search. The best one supported by the CPU is picked
+ * through CPUID when the program starts.
+ */
+    enum SearchKernel {
+        SCALAR_SEARCH = 0, /* Branchless binary search, searchKeyArray */
+                AVX2_SEARCH = 1, /* Binary search down to a few vectors, then 8 keys per compare */
+                AVX512_SEARCH = 2  /* Binary search down to a few vectors, then 16 keys per compare */
+    };
+
+/**
+ * @brief Position of the first key >= key among the first count slots of keyArray, count if there is none.
+ * Runs the active search kernel.
+ */
+    int keyLowerBound(const int *keyArray, int count, int key);
+
+/**
+ * @brief Position of the first key > key among the first count slots of keyArray, count if there is none.
+ * Runs the active search kernel.
+ */
+    int keyUpperBound(const int *keyArray, int count, int key);
+
+/**
+ * @brief Position of the first key >= key among the first count slots of a DOUBLE key array.
+ * Always the scalar search, the SIMD kernels only handle int keys.
+ */
+    inline int keyLowerBound(const double *keyArray, int count, double key) {
+        return searchKeyArray<false>(keyArray, count, key);
+    }
+
+/**
+ * @brief Position of the first key > key among the first count slots of a DOUBLE key array.
+ */
+    inline int keyUpperBound(const double *keyArray, int count, double key) {
+        return searchKeyArray<true>(keyArray, count, key);
+    }
+
+/**
+ * @brief Kernel used by keyLowerBound and keyUpperBound.
+ */
+    SearchKernel getSearchKernel();
+
+/**
+ * @brief Switch the kernel used by keyLowerBound and keyUpperBound, e.g. to compare kernels in a benchmark.
+ * @return	false, and the active kernel is kept, if the CPU does not support the requested kernel
+ */
+    bool setSearchKernel(SearchKernel kernel);
+
+/**
+ * @brief Printable name of a kernel.
+ */
+    const char *searchKernelName(SearchKernel kernel);
+
+}
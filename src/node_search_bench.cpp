@@ -0,0 +1,241 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "btree.h"
+#include "node_search.h"
+
+// Microbenchmark of the search inside a single B+ tree node.
+// Compares the original linear scan, which stops at the first key >= the searched key or at an
+// INT32_MAX sentinel, with every search kernel of node_search.h the CPU supports, for point lookups and inserts.
+// Then compares descents through a set of non-leaf nodes too large for the CPU caches, in the NONLEAF_SORTED
+// format searched by binary search of the keys and in the NONLEAF_LINE_DIRECTORY format searched through
+// the cache line directory of the node, with the same keys in both.
+
+using namespace badgerdb;
+
+typedef std::chrono::steady_clock Clock;
+
+// The search loop the node code used before node_search.h
+static int linearSearch(const int *keyArray, int, int key) {
+    int i = 0;
+    while (keyArray[i] < key) {
+        i++;
+    }
+    return i;
+}
+
+static int kernelSearch(const int *keyArray, int count, int key) {
+    return keyLowerBound(keyArray, count, key);
+}
+
+const SearchKernel kernels[] = {SCALAR_SEARCH, AVX2_SEARCH, AVX512_SEARCH};
+const int numKernels = 3;
+
+typedef int (*SearchFn)(const int *, int, int);
+
+// Fill the first count slots with even keys, the rest with the empty slot sentinel
+static void fillNode(std::vector<int> &keys, int count) {
+    for (int i = 0; i < (int) keys.size(); i++) {
+        keys[i] = i < count ? 2 * i : INT32_MAX;
+    }
+}
+
+static double benchLookup(SearchFn search, const std::vector<int> &keys, int count,
+                          const std::vector<int> &probes, long &checksum) {
+    Clock::time_point start = Clock::now();
+    for (size_t p = 0; p < probes.size(); p++) {
+        checksum += search(&keys[0], count, probes[p]);
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / probes.size();
+}
+
+// Insert keys into an empty node until it is full, shifting the tail like shiftAndInsert does
+static double benchInsert(SearchFn search, int size, const std::vector<int> &probes, int rounds, long &checksum) {
+    std::vector<int> keys(size + 1);
+    std::vector<RecordId> rids(size + 1);
+    long inserts = 0;
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        fillNode(keys, 0);
+        for (int count = 0; count < size; count++) {
+            int key = probes[(r * size + count) % probes.size()];
+            int i = search(&keys[0], count, key);
+            for (int k = count; k > i; k--) {
+                keys[k] = keys[k - 1];
+                rids[k] = rids[k - 1];
+            }
+            keys[i] = key;
+            rids[i].page_number = count;
+            inserts++;
+        }
+        checksum += keys[size / 2];
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / inserts;
+}
+
+// Search of a NONLEAF_SORTED non-leaf, like nonLeafBound in btree.cpp
+static int arraySearch(const NonLeafNodeInt *node, int key) {
+    return keyLowerBound(node->keys(), node->header.keyCount, key);
+}
+
+// Search of a NONLEAF_LINE_DIRECTORY non-leaf, with the prefetch of nonLeafBound in btree.cpp
+static int lineSearch(const NonLeafNodeInt *node, int key) {
+    const int B = KeyLines<int>::KEYS_PER_LINE;
+    int count = node->header.keyCount;
+    int line = searchLineDirectory<false>(node->lineMax(), node->groupMax(), count, key);
+    if (line * B >= count) {
+        return count;
+    }
+    __builtin_prefetch(&node->pageNos()[line * B]);
+    int lineKeys = count - line * B < B ? count - line * B : B;
+    return line * B + countInLine<false>(&node->keys()[line * B], lineKeys, key);
+}
+
+typedef int (*NodeSearchFn)(const NonLeafNodeInt *, int);
+
+// Descend depth levels from a node picked by the probe, each level follows the child the key falls in
+static double benchDescent(NodeSearchFn search, const char *pages, int numNodes, int depth,
+                           const std::vector<int> &probes, long &checksum) {
+    Clock::time_point start = Clock::now();
+    for (size_t p = 0; p < probes.size(); p++) {
+        PageId nodeNo = (PageId) (p * 7919 % numNodes);
+        for (int level = 0; level < depth; level++) {
+            const NonLeafNodeInt *node = (const NonLeafNodeInt *) (pages + (size_t) nodeNo * Page::SIZE);
+            int i = search(node, probes[p]);
+            checksum += i;
+            nodeNo = node->pageNos()[i];
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / probes.size();
+}
+
+int main(int argc, char **argv) {
+    const int numProbes = 1 << 20;
+    std::vector<int> probes(numProbes);
+    srandom(564);
+    for (int i = 0; i < numProbes; i++) {
+        probes[i] = random() % (2 * INTARRAYLEAFSIZE);
+    }
+
+    const int directorySize = NonLeafLayouts<int>::FORMATS[NONLEAF_LINE_DIRECTORY].size;
+    std::cout << "leaf size:" << INTARRAYLEAFSIZE << " non-leaf size:" << INTARRAYNONLEAFSIZE
+              << " line directory non-leaf size:" << directorySize
+              << " default kernel:" << searchKernelName(getSearchKernel()) << std::endl;
+    SearchKernel defaultKernel = getSearchKernel();
+
+    // Point lookups, the probed key lands anywhere in the occupied prefix
+    const int sizes[] = {INTARRAYLEAFSIZE, INTARRAYNONLEAFSIZE};
+    for (int s = 0; s < 2; s++) {
+        int size = sizes[s];
+        std::vector<int> keys(size + 1);
+        for (int fill = 50; fill <= 100; fill += 50) {
+            int count = size * fill / 100;
+            fillNode(keys, count);
+            keys[size] = INT32_MAX;
+            long linearSum = 0;
+            double linearNs = benchLookup(linearSearch, keys, count, probes, linearSum);
+            std::cout << "lookup size:" << size << " fill:" << fill << "%" << " linear:" << linearNs << "ns";
+            for (int k = 0; k < numKernels; k++) {
+                if (!setSearchKernel(kernels[k])) {
+                    continue;
+                }
+                long kernelSum = 0;
+                double kernelNs = benchLookup(kernelSearch, keys, count, probes, kernelSum);
+                if (linearSum != kernelSum) {
+                    std::cout << std::endl << searchKernelName(kernels[k]) << " lookup results differ" << std::endl;
+                    return 1;
+                }
+                std::cout << " " << searchKernelName(kernels[k]) << ":" << kernelNs << "ns";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    // Inserts into a leaf, from empty to full
+    long linearSum = 0;
+    double linearNs = benchInsert(linearSearch, INTARRAYLEAFSIZE, probes, 200, linearSum);
+    std::cout << "insert size:" << INTARRAYLEAFSIZE << " linear:" << linearNs << "ns";
+    for (int k = 0; k < numKernels; k++) {
+        if (!setSearchKernel(kernels[k])) {
+            continue;
+        }
+        long kernelSum = 0;
+        double kernelNs = benchInsert(kernelSearch, INTARRAYLEAFSIZE, probes, 200, kernelSum);
+        if (linearSum != kernelSum) {
+            std::cout << std::endl << searchKernelName(kernels[k]) << " insert results differ" << std::endl;
+            return 1;
+        }
+        std::cout << " " << searchKernelName(kernels[k]) << ":" << kernelNs << "ns";
+    }
+    std::cout << std::endl;
+    setSearchKernel(defaultKernel);
+
+    // Descents through 4096 non-leaf nodes of each format, 32MB of cache line aligned pages like the buffer pool
+    // frames. Both formats hold the same keys, up to the size of the line directory format
+    const int numNodes = 4096;
+    const int depth = 3;
+    void *sortedPool = NULL;
+    void *directoryPool = NULL;
+    if (posix_memalign(&sortedPool, CACHE_LINE_SIZE, (size_t) numNodes * Page::SIZE) != 0
+        || posix_memalign(&directoryPool, CACHE_LINE_SIZE, (size_t) numNodes * Page::SIZE) != 0) {
+        return 1;
+    }
+    char *sortedPages = (char *) sortedPool;
+    char *directoryPages = (char *) directoryPool;
+    const int descentProbes = 1 << 18;
+    std::vector<int> nodeProbes(probes.begin(), probes.begin() + descentProbes);
+    for (int fill = 50; fill <= 100; fill += 50) {
+        int count = directorySize * fill / 100;
+        for (int n = 0; n < numNodes; n++) {
+            NonLeafNodeInt *sorted = (NonLeafNodeInt *) (sortedPages + (size_t) n * Page::SIZE);
+            NonLeafNodeInt *directory = (NonLeafNodeInt *) (directoryPages + (size_t) n * Page::SIZE);
+            memset(sorted, 0, Page::SIZE);
+            memset(directory, 0, Page::SIZE);
+            sorted->header.nodeType = NON_LEAF_NODE;
+            sorted->header.format = NONLEAF_SORTED;
+            sorted->header.keyCount = count;
+            directory->header.nodeType = NON_LEAF_NODE;
+            directory->header.format = NONLEAF_LINE_DIRECTORY;
+            directory->header.keyCount = count;
+            for (int i = 0; i < count; i++) {
+                sorted->keys()[i] = directory->keys()[i] = (2 * INTARRAYLEAFSIZE) * (i + 1) / (count + 1);
+            }
+            for (int i = 0; i <= count; i++) {
+                sorted->pageNos()[i] = directory->pageNos()[i] = random() % numNodes;
+            }
+            updateLineDirectory(directory->keys(), count, directory->lineMax(), directory->groupMax(), 0);
+        }
+        std::cout << "descent depth:" << depth << " keys:" << count << " sorted";
+        long lineSum = 0;
+        double lineNs = benchDescent(lineSearch, directoryPages, numNodes, depth, nodeProbes, lineSum);
+        for (int k = 0; k < numKernels; k++) {
+            if (!setSearchKernel(kernels[k])) {
+                continue;
+            }
+            long arraySum = 0;
+            double arrayNs = benchDescent(arraySearch, sortedPages, numNodes, depth, nodeProbes, arraySum);
+            if (arraySum != lineSum) {
+                std::cout << std::endl << "line directory descent results differ" << std::endl;
+                return 1;
+            }
+            std::cout << " " << searchKernelName(kernels[k]) << ":" << arrayNs << "ns";
+        }
+        std::cout << " line directory:" << lineNs << "ns" << std::endl;
+    }
+    setSearchKernel(defaultKernel);
+    free(sortedPool);
+    free(directoryPool);
+    return 0;
+}
@@ -46,11 +46,19 @@ RecordId Page::insertRecord(const std::string& record_data) {
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-	std::string retStr = std::string(data_, DATA_SIZE).substr(slot.item_offset, slot.item_length);
+	std::string retStr = std::string(data_ + slot.item_offset, slot.item_length);
 
 	return retStr;
 }
 
+const char* Page::getRecordBytes(const RecordId& record_id,
+                                 std::size_t& length) const {
+  validateRecordId(record_id);
+  const PageSlot& slot = getSlot(record_id.slot_number);
+  length = slot.item_length;
+  return data_ + slot.item_offset;
+}
+
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
   validateRecordId(record_id);